@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <time.h>
+
+// Compute-bound kernels for comparing clang-interpreter -O levels.  The
+// program prints its own run time, so that the rest of the wall clock time
+// of a run is compilation.
+
+#define N 256
+
+static double A[N][N], B[N][N], C[N][N];
+
+static void matmul(void) {
+  for (int i = 0; i < N; ++i)
+    for (int j = 0; j < N; ++j) {
+      double Sum = 0;
+      for (int k = 0; k < N; ++k)
+        Sum += A[i][k] * B[k][j];
+      C[i][j] = Sum;
+    }
+}
+
+static inline unsigned collatz_length(unsigned long n) {
+  unsigned Length = 1;
+  while (n != 1) {
+    n = (n & 1) ? 3 * n + 1 : n / 2;
+    ++Length;
+  }
+  return Length;
+}
+
+static unsigned longest_collatz(unsigned Limit) {
+  unsigned Best = 0, BestStart = 0;
+  for (unsigned i = 1; i < Limit; ++i) {
+    unsigned Length = collatz_length(i);
+    if (Length > Best) {
+      Best = Length;
+      BestStart = i;
+    }
+  }
+  return BestStart;
+}
+
+int main(int argc, char **argv) {
+  for (int i = 0; i < N; ++i)
+    for (int j = 0; j < N; ++j) {
+      A[i][j] = i + j;
+      B[i][j] = i - j;
+    }
+
+  clock_t Start = clock();
+  matmul();
+  unsigned Collatz = longest_collatz(1000000);
+  double Seconds = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+  printf("checksum %f %u\n", C[N / 2][N / 3], Collatz);
+  printf("run time %.3fs\n", Seconds);
+  return 0;
+}
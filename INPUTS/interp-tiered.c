@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// A short-lived script with one hot function and many that run once, for
+// tuning clang-interpreter -interp-tier-threshold.
+
+static unsigned long hash(unsigned long x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdUL;
+  x ^= x >> 33;
+  return x;
+}
+
+#define ONCE(n) static int once##n(int x) { return x * n + (x >> (n % 7)); }
+ONCE(1) ONCE(2) ONCE(3) ONCE(4) ONCE(5) ONCE(6) ONCE(7) ONCE(8)
+ONCE(9) ONCE(10) ONCE(11) ONCE(12) ONCE(13) ONCE(14) ONCE(15) ONCE(16)
+
+int main(int argc, char **argv) {
+  int setup = once1(1) + once2(2) + once3(3) + once4(4) + once5(5) +
+              once6(6) + once7(7) + once8(8) + once9(9) + once10(10) +
+              once11(11) + once12(12) + once13(13) + once14(14) +
+              once15(15) + once16(16);
+
+  unsigned long acc = setup;
+  for (unsigned long i = 0; i < 2000000; ++i)
+    acc += hash(i);
+  printf("%lu\n", acc);
+  return 0;
+}
@@ -0,0 +1,47 @@
+#import <Foundation/Foundation.h>
+#include <stdio.h>
+
+// Four classes with 900 methods each, to measure method registration in
+// .objc_jit_init.
+
+#define METHOD(n) - (int)method##n { return n; }
+#define TEN(n) METHOD(n##0) METHOD(n##1) METHOD(n##2) METHOD(n##3) \
+               METHOD(n##4) METHOD(n##5) METHOD(n##6) METHOD(n##7) \
+               METHOD(n##8) METHOD(n##9)
+#define HUNDRED(n) TEN(n##0) TEN(n##1) TEN(n##2) TEN(n##3) TEN(n##4) \
+                   TEN(n##5) TEN(n##6) TEN(n##7) TEN(n##8) TEN(n##9)
+#define METHODS HUNDRED(1) HUNDRED(2) HUNDRED(3) HUNDRED(4) HUNDRED(5) \
+                HUNDRED(6) HUNDRED(7) HUNDRED(8) HUNDRED(9)
+
+@interface Many1 : NSObject
+@end
+@implementation Many1
+METHODS
+@end
+
+@interface Many2 : NSObject
+@end
+@implementation Many2
+METHODS
+@end
+
+@interface Many3 : NSObject
+@end
+@implementation Many3
+METHODS
+@end
+
+@interface Many4 : NSObject
+@end
+@implementation Many4
+METHODS
+@end
+
+int main(int argc, char **argv) {
+  NSAutoreleasePool *Pool = [[NSAutoreleasePool alloc] init];
+  Many4 *M = [[Many4 alloc] init];
+  printf("%d\n", [M method999]);
+  [M release];
+  [Pool drain];
+  return 0;
+}
@@ -0,0 +1,64 @@
+// Message send throughput for the host (JIT) Objective-C runtime.  Run with
+// clang-interpreter, with and without -Xclang -fobjc-jit-inline-caches.
+
+#import <Foundation/Foundation.h>
+#include <stdio.h>
+#include <time.h>
+
+@interface Counter : NSObject {
+  unsigned long count;
+}
+- (void)increment;
+- (unsigned long)count;
+@end
+
+@implementation Counter
+- (void)increment { ++count; }
+- (unsigned long)count { return count; }
+@end
+
+@interface OtherCounter : Counter
+@end
+
+@implementation OtherCounter
+- (void)increment { count += 2; }
+@end
+
+static double now(void) {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static void report(const char *name, unsigned long sends, double start) {
+  double elapsed = now() - start;
+  printf("%-14s %10lu sends  %8.3f s  %8.2f Msends/s\n", name, sends, elapsed,
+         sends / elapsed / 1e6);
+}
+
+int main(int argc, char **argv) {
+  enum { N = 50000000 };
+  Counter *counters[2];
+  counters[0] = [[Counter alloc] init];
+  counters[1] = [[OtherCounter alloc] init];
+  unsigned long i;
+  double start;
+
+  // One receiver class per site: the monomorphic case.
+  start = now();
+  for (i = 0; i != N; ++i)
+    [counters[0] increment];
+  report("monomorphic", N, start);
+
+  // Alternating receiver classes: the polymorphic case.
+  start = now();
+  for (i = 0; i != N; ++i)
+    [counters[i & 1] increment];
+  report("polymorphic", N, start);
+
+  // Class messages.
+  start = now();
+  for (i = 0; i != N / 10; ++i)
+    [Counter class];
+  report("class", N / 10, start);
+
+  return [counters[0] count] == 0;
+}
@@ -0,0 +1,17 @@
+#import <Foundation/Foundation.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A short script behind a large preamble: nearly all of its startup time is
+// spent parsing the headers above.
+
+int main(int argc, char **argv) {
+  NSAutoreleasePool *Pool = [[NSAutoreleasePool alloc] init];
+  NSMutableArray *Words = [NSMutableArray array];
+  for (int i = 0; i < 10; ++i)
+    [Words addObject:[NSString stringWithFormat:@"word%d", i]];
+  printf("%s\n", [[Words componentsJoinedByString:@" "] UTF8String]);
+  [Pool drain];
+  return 0;
+}
@@ -0,0 +1,192 @@
+//===-- examples/clang-interpreter/DiskObjectCache.cpp --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DiskObjectCache.h"
+#include "clang/Basic/Version.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+#ifdef LLVM_ON_UNIX
+#include <utime.h>
+#endif
+
+using namespace clang;
+
+DiskObjectCache::DiskObjectCache(StringRef CacheDir, StringRef Triple,
+                                 llvm::CodeGenOpt::Level OptLevel,
+                                 uint64_t MaxSize, uint64_t MaxAge)
+  : CacheDir(CacheDir), Triple(Triple), OptLevel(OptLevel), MaxSize(MaxSize),
+    MaxAge(MaxAge), NumHits(0), NumMisses(0) {}
+
+/// The text an entry is looked up by: everything that goes into the object
+/// code of \p M.
+std::string DiskObjectCache::getKey(const llvm::Module *M) {
+  // The JIT generates code for the host CPU when none is given.
+  std::string Key;
+  llvm::raw_string_ostream OS(Key);
+  OS << getClangFullVersion() << '\0' << Triple << '\0'
+     << llvm::sys::getHostCPUName() << '\0' << unsigned(OptLevel) << '\0';
+  M->print(OS, 0);
+  OS.flush();
+  return Key;
+}
+
+/// The file name of the entry for \p Key.  It has to come out the same in
+/// every run, which llvm::hash_code does not promise, so use 64-bit FNV-1a.
+static std::string getEntryName(StringRef Key) {
+  uint64_t Hash = 14695981039346656037ULL;
+  for (size_t i = 0, e = Key.size(); i != e; ++i) {
+    Hash ^= (unsigned char)Key[i];
+    Hash *= 1099511628211ULL;
+  }
+  return llvm::utohexstr(Hash) + ".entry";
+}
+
+/// An entry is the size of its key as a 64 bit little endian integer, the
+/// key, and the object code.  Sets \p Object to the object code of
+/// \p Contents if it is an entry for \p Key.
+static bool readEntry(StringRef Contents, StringRef Key, StringRef &Object) {
+  if (Contents.size() < 8)
+    return false;
+  uint64_t KeySize = 0;
+  for (unsigned i = 0; i != 8; ++i)
+    KeySize |= uint64_t((unsigned char)Contents[i]) << (8 * i);
+  Contents = Contents.substr(8);
+  if (KeySize != Key.size() || !Contents.startswith(Key))
+    return false;
+  Object = Contents.substr(KeySize);
+  return true;
+}
+
+llvm::MemoryBuffer *DiskObjectCache::getObject(const llvm::Module *M) {
+  EntryKey &Entry = EntryKeys[M];
+  Entry.Key = getKey(M);
+  Entry.Name = getEntryName(Entry.Key);
+
+  SmallString<128> Path(CacheDir);
+  llvm::sys::path::append(Path, Entry.Name);
+  OwningPtr<llvm::MemoryBuffer> Contents;
+  StringRef Object;
+  // A different module whose key has the same digest misses, and its object
+  // then replaces the entry.
+  if (llvm::MemoryBuffer::getFile(Path.str(), Contents) ||
+      !readEntry(Contents->getBuffer(), Entry.Key, Object)) {
+    ++NumMisses;
+    return 0;
+  }
+  ++NumHits;
+  EntryKeys.erase(M);
+#ifdef LLVM_ON_UNIX
+  // Entries are evicted oldest first, so keep the ones in use young.
+  utime(Path.c_str(), 0);
+#endif
+  return llvm::MemoryBuffer::getMemBufferCopy(Object, Path.str());
+}
+
+void DiskObjectCache::notifyObjectCompiled(const llvm::Module *M,
+                                           const llvm::MemoryBuffer *Obj) {
+  llvm::DenseMap<const llvm::Module *, EntryKey>::iterator I =
+    EntryKeys.find(M);
+  if (I == EntryKeys.end())
+    return;
+  EntryKey Entry = I->second;
+  EntryKeys.erase(I);
+
+  bool Existed;
+  if (llvm::sys::fs::create_directories(CacheDir, Existed))
+    return;
+
+  // Write under a temporary name and rename into place, so that concurrent
+  // runs never see a partial entry.
+  SmallString<128> Path(CacheDir);
+  llvm::sys::path::append(Path, Entry.Name);
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::unique_file(Path.str() + "-%%%%%%%%", FD, TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    uint64_t KeySize = Entry.Key.size();
+    for (unsigned i = 0; i != 8; ++i)
+      OS << char((KeySize >> (8 * i)) & 0xFF);
+    OS << Entry.Key << Obj->getBuffer();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath.str(), Path.str())) {
+    llvm::sys::fs::remove(TempPath.str(), Existed);
+    return;
+  }
+
+  prune();
+}
+
+namespace {
+struct CacheEntry {
+  std::string Path;
+  uint64_t Size;
+  uint64_t MTime;
+
+  bool operator<(const CacheEntry &RHS) const { return MTime < RHS.MTime; }
+};
+}
+
+/// Remove the entries older than MaxAge, then the oldest ones until the
+/// rest fit in MaxSize.
+void DiskObjectCache::prune() {
+  uint64_t Now = llvm::sys::TimeValue::now().toEpochTime();
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+
+  llvm::error_code EC;
+  for (llvm::sys::fs::directory_iterator Dir(CacheDir, EC), DirEnd;
+       Dir != DirEnd && !EC; Dir.increment(EC)) {
+    if (llvm::sys::path::extension(Dir->path()) != ".entry")
+      continue;
+    llvm::sys::fs::file_status Status;
+    if (Dir->status(Status) || !llvm::sys::fs::is_regular_file(Status))
+      continue;
+
+    CacheEntry Entry;
+    Entry.Path = Dir->path();
+    Entry.Size = Status.getSize();
+    Entry.MTime = Status.getLastModificationTime().toEpochTime();
+
+    bool Existed;
+    if (Entry.MTime + MaxAge < Now &&
+        !llvm::sys::fs::remove(Entry.Path, Existed))
+      continue;
+    TotalSize += Entry.Size;
+    Entries.push_back(Entry);
+  }
+
+  if (TotalSize <= MaxSize)
+    return;
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned i = 0, e = Entries.size(); i != e && TotalSize > MaxSize;
+       ++i) {
+    bool Existed;
+    if (!llvm::sys::fs::remove(Entries[i].Path, Existed))
+      TotalSize -= Entries[i].Size;
+  }
+}
@@ -0,0 +1,73 @@
+//===-- examples/clang-interpreter/DiskObjectCache.h ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A content-addressed directory of object files for MCJIT, so that running
+// the same script again skips native code generation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_DISKOBJECTCACHE_H
+#define CLANG_INTERPRETER_DISKOBJECTCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CodeGen.h"
+#include <string>
+
+namespace clang {
+
+/// \brief Stores the object code MCJIT generates for a module under a digest
+/// of the module's IR, the target and the optimization level, and hands it
+/// back for identical modules.
+///
+/// Each entry holds the text the digest was computed from ahead of the
+/// object code, and is only handed back if that text is the module's.
+///
+/// Modules compiled with the host Objective-C runtime have class, selector
+/// and string addresses of the compiling process baked into their IR, so
+/// they only hit when those addresses come out the same; anything else simply
+/// misses.  Entries are evicted least recently used first, once they are
+/// older than \c MaxAge or once the directory grows beyond \c MaxSize.
+class DiskObjectCache : public llvm::ObjectCache {
+  std::string CacheDir;
+  std::string Triple;
+  llvm::CodeGenOpt::Level OptLevel;
+  uint64_t MaxSize;
+  uint64_t MaxAge;
+
+  struct EntryKey {
+    std::string Name;
+    std::string Key;
+  };
+
+  /// The entry computed for each module before codegen; the module is not
+  /// necessarily unchanged by the time its object is handed back.
+  llvm::DenseMap<const llvm::Module *, EntryKey> EntryKeys;
+
+  std::string getKey(const llvm::Module *M);
+  void prune();
+
+public:
+  /// \param MaxSize the total size of the entries, in bytes.
+  /// \param MaxAge the age of the oldest entry kept, in seconds.
+  DiskObjectCache(StringRef CacheDir, StringRef Triple,
+                  llvm::CodeGenOpt::Level OptLevel, uint64_t MaxSize,
+                  uint64_t MaxAge);
+
+  virtual void notifyObjectCompiled(const llvm::Module *M,
+                                    const llvm::MemoryBuffer *Obj);
+  virtual llvm::MemoryBuffer *getObject(const llvm::Module *M);
+
+  unsigned NumHits, NumMisses;
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,339 @@
+//===-- examples/clang-interpreter/IncrementalInterpreter.cpp -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IncrementalInterpreter.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/ExternalASTSource.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/TargetInfo.h"
+#include "clang/CodeGen/BackendUtil.h"
+#include "clang/CodeGen/ModuleBuilder.h"
+#include "clang/CodeGen/ObjCJitRuntimeStats.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/Preprocessor.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Parse/Parser.h"
+#include "clang/Sema/Sema.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+IncrementalInterpreter::IncrementalInterpreter(CompilerInstance &CI,
+                                               llvm::LLVMContext &Context)
+  : CI(CI), Context(Context), CodeGen(0), ReclaimIR(false), NumInputs(0),
+    NumTentativeDefinitions(0) {}
+
+IncrementalInterpreter::~IncrementalInterpreter() {
+  // The parser refers to Sema, which the compiler instance owns.
+  P.reset();
+  // Constant strings are shared by every input's module; release them once
+  // none of that code can run any more.
+  EE.reset();
+  clearObjCJitConstantStrings();
+}
+
+bool IncrementalInterpreter::Initialize() {
+  // FIXME: This is copied from CompilerInstance::ExecuteAction and
+  // ASTFrontendAction; we can't use them because they end the translation
+  // unit.
+  CI.setTarget(TargetInfo::CreateTargetInfo(CI.getDiagnostics(),
+                                            &CI.getTargetOpts()));
+  if (!CI.hasTarget())
+    return false;
+  CI.getTarget().setForcedLangOptions(CI.getLangOpts());
+
+  CI.createFileManager();
+  CI.createSourceManager(CI.getFileManager());
+  if (!CI.InitializeSourceManager(CI.getFrontendOpts().Inputs[0]))
+    return false;
+
+  CI.createPreprocessor();
+  Preprocessor &PP = CI.getPreprocessor();
+  // Keep the main file's lexer around at its end, so that every input can be
+  // entered after it.
+  PP.enableIncrementalProcessing();
+
+  CI.createASTContext();
+  if (!CI.getPreprocessorOpts().ImplicitPCHInclude.empty()) {
+    CI.createPCHExternalASTSource(
+      CI.getPreprocessorOpts().ImplicitPCHInclude,
+      CI.getPreprocessorOpts().DisablePCHValidation,
+      CI.getPreprocessorOpts().AllowPCHWithCompilerErrors, 0);
+    if (!CI.getASTContext().getExternalSource())
+      return false;
+  } else {
+    // The builtins are in the PCH if there is one.
+    PP.getBuiltinInfo().InitializeBuiltins(PP.getIdentifierTable(),
+                                           PP.getLangOpts());
+  }
+
+  CodeGen = CreateLLVMCodeGen(CI.getDiagnostics(),
+                              CI.getFrontendOpts().Inputs[0].getFile(),
+                              CI.getCodeGenOpts(), CI.getTargetOpts(),
+                              Context);
+  CI.setASTConsumer(CodeGen);
+  CI.createSema(TU_Complete, 0);
+  if (ExternalASTSource *External = CI.getASTContext().getExternalSource())
+    External->StartTranslationUnit(CodeGen);
+  P.reset(new Parser(PP, CI.getSema(), /*SkipFunctionBodies=*/false));
+
+  CI.getDiagnosticClient().BeginSourceFile(CI.getLangOpts(), &PP);
+  PP.EnterMainSourceFile();
+  P->Initialize();
+
+  if (!ParseCurrentFile())
+    return false;
+  return EmitAndRun(std::string());
+}
+
+bool IncrementalInterpreter::Process(StringRef Input) {
+  std::string Source;
+  std::string EntryName;
+  if (isDeclaration(Input)) {
+    Source = Input.str();
+  } else {
+    // Give the wrapper C linkage, so that it can be looked up by name in the
+    // module whatever the language.
+    EntryName = "__clang_interpreter_input_" + llvm::utostr(NumInputs);
+    if (CI.getLangOpts().CPlusPlus)
+      Source = "extern \"C\" ";
+    Source += "void " + EntryName + "(void) {\n" + Input.str() + "\n}\n";
+  }
+
+  SourceManager &SM = CI.getSourceManager();
+  FileID FID =
+    SM.createFileIDForMemBuffer(llvm::MemoryBuffer::getMemBufferCopy(Source,
+                                                                 "<input>"));
+  CI.getPreprocessor().EnterSourceFile(FID, 0, SourceLocation());
+
+  // Errors discard the module; don't run anything from it.
+  if (!ParseCurrentFile())
+    EntryName.clear();
+  return EmitAndRun(EntryName);
+}
+
+/// Decide whether \p Input belongs at file scope.  Preprocessor directives,
+/// Objective-C containers and anything that starts with a type do; everything
+/// else is taken to be statements.
+bool IncrementalInterpreter::isDeclaration(StringRef Input) {
+  // The raw lexer needs a null terminated buffer.
+  std::string Buffer(Input);
+  Lexer RawLex(SourceLocation(), CI.getLangOpts(), Buffer.c_str(),
+               Buffer.c_str(), Buffer.c_str() + Buffer.size());
+  Token Tok;
+  RawLex.LexFromRawLexer(Tok);
+
+  if (Tok.is(tok::hash))
+    return true;
+
+  if (Tok.is(tok::at)) {
+    RawLex.LexFromRawLexer(Tok);
+    if (Tok.isNot(tok::raw_identifier))
+      return false;
+    return llvm::StringSwitch<bool>(StringRef(Tok.getRawIdentifierData(),
+                                              Tok.getLength()))
+      .Cases("interface", "implementation", "protocol", "class", true)
+      .Case("compatibility_alias", true)
+      .Default(false);
+  }
+
+  if (Tok.isNot(tok::raw_identifier))
+    return false;
+
+  IdentifierInfo *II = CI.getPreprocessor().LookUpIdentifierInfo(Tok);
+  switch (Tok.getKind()) {
+  case tok::identifier: {
+    Sema &S = CI.getSema();
+    return S.getTypeName(*II, SourceLocation(), S.getCurScope())
+             .getAsOpaquePtr() != 0;
+  }
+  case tok::kw_typedef:
+  case tok::kw_extern:
+  case tok::kw_static:
+  case tok::kw_inline:
+  case tok::kw_auto:
+  case tok::kw_struct:
+  case tok::kw_union:
+  case tok::kw_enum:
+  case tok::kw_class:
+  case tok::kw_template:
+  case tok::kw_namespace:
+  case tok::kw_using:
+  case tok::kw_const:
+  case tok::kw_volatile:
+  case tok::kw_void:
+  case tok::kw_char:
+  case tok::kw_short:
+  case tok::kw_int:
+  case tok::kw_long:
+  case tok::kw_float:
+  case tok::kw_double:
+  case tok::kw_signed:
+  case tok::kw_unsigned:
+  case tok::kw__Bool:
+  case tok::kw_bool:
+  case tok::kw_wchar_t:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Parse up to the end of the file on top of the include stack, handing every
+/// declaration to the code generator.  Returns false if there were errors.
+bool IncrementalInterpreter::ParseCurrentFile() {
+  Sema &S = CI.getSema();
+  DiagnosticErrorTrap Trap(CI.getDiagnostics());
+
+  Parser::DeclGroupPtrTy ADecl;
+  while (!P->ParseTopLevelDecl(ADecl))
+    if (ADecl)
+      CodeGen->HandleTopLevelDecl(ADecl.get());
+
+  // Sema only does the following at the end of the translation unit, which
+  // an incremental session never reaches.
+  S.PerformPendingInstantiations();
+
+  unsigned Index = 0;
+  for (Sema::TentativeDefinitionsType::iterator
+         T = S.TentativeDefinitions.begin(0, true),
+         TEnd = S.TentativeDefinitions.end(); T != TEnd; ++T, ++Index) {
+    if (Index < NumTentativeDefinitions)
+      continue;
+    VarDecl *VD = (*T)->getActingDefinition();
+    if (VD && !VD->isInvalidDecl())
+      CodeGen->CompleteTentativeDefinition(VD);
+  }
+  NumTentativeDefinitions = Index;
+
+  return !Trap.hasErrorOccurred();
+}
+
+/// Finish the current module, add it to the engine and run its initializers
+/// followed by \p EntryName, if given.
+bool IncrementalInterpreter::EmitAndRun(const std::string &EntryName) {
+  const llvm::Module *Generated = CodeGen->GetModule();
+  CodeGen->HandleTranslationUnit(CI.getASTContext());
+  llvm::Module *M = CodeGen->ReleaseModule();
+  CodeGen->StartModule("input-" + llvm::utostr(++NumInputs), Context);
+  Modules.push_back(M);
+  if (!M) {
+    // The module was discarded after errors; none of its code will run.
+    releaseObjCJitConstantStrings(Generated);
+    return false;
+  }
+
+  // Run the optimization pipeline a normal compile at this -O level would.
+  EmitBackendOutput(CI.getDiagnostics(), CI.getCodeGenOpts(),
+                    CI.getTargetOpts(), CI.getLangOpts(), M,
+                    Backend_EmitNothing, 0);
+
+  if (!EE) {
+    std::string Error;
+    llvm::CodeGenOpt::Level OptLevel = getCodeGenOptLevel(CI.getCodeGenOpts());
+    EE.reset(llvm::ExecutionEngine::createJIT(M, &Error, 0, OptLevel));
+    if (!EE) {
+      llvm::errs() << "unable to make execution engine: " << Error << "\n";
+      return false;
+    }
+    EE->RegisterJITEventListener(&Tracker);
+  } else {
+    EE->addModule(M);
+  }
+  LinkToEarlierModules(M);
+
+  // Methods must be registered before any constructor can send messages.
+  std::vector<llvm::GenericValue> NoArgs;
+  if (llvm::Function *InitFn = M->getFunction(".objc_jit_init"))
+    EE->runFunction(InitFn, NoArgs);
+  EE->runStaticConstructorsDestructors(M, false);
+
+  if (!EntryName.empty())
+    if (llvm::Function *EntryFn = M->getFunction(EntryName))
+      EE->runFunction(EntryFn, NoArgs);
+
+  // Nothing is being compiled now; everything compiled so far has its
+  // machine code.
+  if (ReclaimIR)
+    Tracker.reclaimIR();
+  return true;
+}
+
+bool IncrementalInterpreter::RetireInput(unsigned N) {
+  if (N >= Modules.size() || !Modules[N])
+    return false;
+  llvm::Module *M = Modules[N];
+
+  for (llvm::StringMap<llvm::GlobalValue*>::iterator I = Definitions.begin(),
+         E = Definitions.end(); I != E; ) {
+    llvm::StringMap<llvm::GlobalValue*>::iterator Cur = I++;
+    if (Cur->getValue()->getParent() == M)
+      Definitions.erase(Cur);
+  }
+
+  for (llvm::Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    EE->freeMachineCodeForFunction(F);
+  EE->clearGlobalMappingsFromModule(M);
+  EE->removeModule(M);
+  Tracker.forgetModule(M);
+  releaseObjCJitConstantStrings(M);
+  delete M;
+  Modules[N] = 0;
+  return true;
+}
+
+void IncrementalInterpreter::getMemoryUsage(JITMemoryUsage &Usage) const {
+  Usage = JITMemoryUsage();
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i) {
+    if (!Modules[i])
+      continue;
+    Usage.IRBytes += estimateIRBytes(*Modules[i]);
+    ++Usage.NumModules;
+  }
+  Usage.MachineCodeBytes = Tracker.getMachineCodeBytes();
+
+  ObjCJitStringPoolStats Strings;
+  getObjCJitStringPoolStats(Strings);
+  Usage.ObjCBytes = Strings.BytesRetained;
+}
+
+/// The JIT resolves declarations against the host process only, so point the
+/// declarations in \p M at definitions from earlier inputs ourselves.
+void IncrementalInterpreter::LinkToEarlierModules(llvm::Module *M) {
+  SmallVector<llvm::GlobalValue*, 64> Globals;
+  for (llvm::Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    Globals.push_back(I);
+  for (llvm::Module::global_iterator I = M->global_begin(),
+         E = M->global_end(); I != E; ++I)
+    Globals.push_back(I);
+
+  for (unsigned i = 0, e = Globals.size(); i != e; ++i) {
+    llvm::GlobalValue *GV = Globals[i];
+    if (GV->hasLocalLinkage() || !GV->hasName())
+      continue;
+
+    if (!GV->isDeclaration()) {
+      // Keep the first definition; later ones are copies of inline functions.
+      Definitions.GetOrCreateValue(GV->getName(), GV);
+      continue;
+    }
+
+    llvm::StringMap<llvm::GlobalValue*>::iterator Def =
+      Definitions.find(GV->getName());
+    if (Def != Definitions.end())
+      EE->addGlobalMapping(GV, EE->getPointerToGlobal(Def->second));
+  }
+}
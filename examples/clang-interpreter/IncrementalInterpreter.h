@@ -0,0 +1,94 @@
+//===-- examples/clang-interpreter/IncrementalInterpreter.h -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An interpreter session that keeps one CompilerInstance, ASTContext and Sema
+// alive and compiles each new input as a small module added to a single
+// long-lived execution engine.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_INCREMENTALINTERPRETER_H
+#define CLANG_INTERPRETER_INCREMENTALINTERPRETER_H
+
+#include "JITMemory.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace llvm {
+  class ExecutionEngine;
+  class GlobalValue;
+  class LLVMContext;
+  class Module;
+}
+
+namespace clang {
+class CodeGenerator;
+class CompilerInstance;
+class Parser;
+
+class IncrementalInterpreter {
+  CompilerInstance &CI;
+  llvm::LLVMContext &Context;
+
+  /// The code generator; owned by CI as its AST consumer.
+  CodeGenerator *CodeGen;
+  OwningPtr<Parser> P;
+  JITMemoryTracker Tracker;
+  OwningPtr<llvm::ExecutionEngine> EE;
+
+  /// The module of each input, starting with the main file, or null once it
+  /// has been retired or if it had errors.
+  SmallVector<llvm::Module*, 16> Modules;
+  bool ReclaimIR;
+
+  /// External definitions from modules already handed to the engine, so that
+  /// later modules can be pointed at them instead of at the host process.
+  llvm::StringMap<llvm::GlobalValue*> Definitions;
+
+  unsigned NumInputs;
+  unsigned NumTentativeDefinitions;
+
+  bool isDeclaration(StringRef Input);
+  bool ParseCurrentFile();
+  bool EmitAndRun(const std::string &EntryName);
+  void LinkToEarlierModules(llvm::Module *M);
+
+public:
+  IncrementalInterpreter(CompilerInstance &CI, llvm::LLVMContext &Context);
+  ~IncrementalInterpreter();
+
+  /// Parse the main file of the invocation, then compile and run its
+  /// .objc_jit_init.  Its main(), if any, is not called.
+  bool Initialize();
+
+  /// Compile and run one input.  Declarations are added to the translation
+  /// unit; anything else is run as the body of a function.  Returns false if
+  /// the input had errors; the session remains usable either way.
+  bool Process(StringRef Input);
+
+  /// Delete the IR of each function once it has been compiled.
+  void setReclaimIR(bool Reclaim) { ReclaimIR = Reclaim; }
+
+  /// Free the machine code and IR of input \p N, where input 0 is the main
+  /// file.  Later inputs are no longer linked against its definitions, and
+  /// code that still refers to them must not run again.  The storage of its
+  /// global variables is not freed.  Returns false if there is no such input.
+  bool RetireInput(unsigned N);
+
+  /// The memory held by the session.
+  void getMemoryUsage(JITMemoryUsage &Usage) const;
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,336 @@
+//===-- examples/clang-interpreter/InterpreterServer.cpp ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A request is a 32-bit payload size sent together with the client's
+// standard input, output and error (as SCM_RIGHTS), followed by the payload:
+// NUL-terminated strings giving the working directory, the number of
+// arguments, the arguments and then the environment.  The reply is the
+// script's exit status as a 32-bit integer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "InterpreterServer.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+#include <vector>
+
+#ifdef LLVM_ON_UNIX
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+using namespace clang;
+
+ScriptRunner::~ScriptRunner() {}
+
+#ifdef LLVM_ON_UNIX
+
+/// Standard input, output and error travel with each request.
+static const int NumStreams = 3;
+
+union StreamsControl {
+  cmsghdr Align;
+  char Buffer[CMSG_SPACE(sizeof(int) * NumStreams)];
+};
+
+static bool writeAll(int FD, const char *Data, size_t Size) {
+  while (Size) {
+    ssize_t N = ::write(FD, Data, Size);
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      return false;
+    Data += N;
+    Size -= N;
+  }
+  return true;
+}
+
+static bool readAll(int FD, char *Data, size_t Size) {
+  while (Size) {
+    ssize_t N = ::read(FD, Data, Size);
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      return false;
+    Data += N;
+    Size -= N;
+  }
+  return true;
+}
+
+static bool getSocketAddress(StringRef SocketPath, sockaddr_un &Addr) {
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sun_family = AF_UNIX;
+  if (SocketPath.size() >= sizeof(Addr.sun_path)) {
+    llvm::errs() << "socket path too long: " << SocketPath << "\n";
+    return false;
+  }
+  memcpy(Addr.sun_path, SocketPath.data(), SocketPath.size());
+  return true;
+}
+
+/// Retrieve the user at the other end of the connected socket \p Conn.
+static bool getPeerUser(int Conn, uid_t &Uid) {
+#if defined(SO_PEERCRED)
+  ucred Cred;
+  socklen_t Size = sizeof(Cred);
+  if (getsockopt(Conn, SOL_SOCKET, SO_PEERCRED, &Cred, &Size) < 0 ||
+      Size != sizeof(Cred))
+    return false;
+  Uid = Cred.uid;
+  return true;
+#else
+  gid_t Gid;
+  return getpeereid(Conn, &Uid, &Gid) == 0;
+#endif
+}
+
+static void appendString(std::string &Payload, StringRef S) {
+  Payload += S;
+  Payload += '\0';
+}
+
+int clang::RunInterpreterClient(StringRef SocketPath,
+                                ArrayRef<const char *> Args,
+                                char * const *envp) {
+  sockaddr_un Addr;
+  if (!getSocketAddress(SocketPath, Addr))
+    return 255;
+  int Sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (Sock < 0 || connect(Sock, (sockaddr *)&Addr, sizeof(Addr)) < 0) {
+    llvm::errs() << "unable to connect to " << SocketPath << ": "
+                 << strerror(errno) << "\n";
+    return 255;
+  }
+
+  char Cwd[PATH_MAX];
+  std::string Payload;
+  appendString(Payload, getcwd(Cwd, sizeof(Cwd)) ? Cwd : "/");
+  appendString(Payload, llvm::utostr(Args.size()));
+  for (unsigned i = 0, e = Args.size(); i != e; ++i)
+    appendString(Payload, Args[i]);
+  for (char * const *E = envp; *E; ++E)
+    appendString(Payload, *E);
+
+  uint32_t Size = Payload.size();
+  iovec IOV;
+  IOV.iov_base = &Size;
+  IOV.iov_len = sizeof(Size);
+
+  StreamsControl Control;
+  memset(&Control, 0, sizeof(Control));
+  msghdr Msg;
+  memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control.Buffer;
+  Msg.msg_controllen = sizeof(Control.Buffer);
+  cmsghdr *Header = CMSG_FIRSTHDR(&Msg);
+  Header->cmsg_level = SOL_SOCKET;
+  Header->cmsg_type = SCM_RIGHTS;
+  Header->cmsg_len = CMSG_LEN(sizeof(int) * NumStreams);
+  int Streams[NumStreams] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+  memcpy(CMSG_DATA(Header), Streams, sizeof(Streams));
+
+  int32_t Status;
+  bool Success = sendmsg(Sock, &Msg, 0) == ssize_t(sizeof(Size)) &&
+                 writeAll(Sock, Payload.data(), Payload.size()) &&
+                 readAll(Sock, (char *)&Status, sizeof(Status));
+  close(Sock);
+  if (!Success) {
+    llvm::errs() << "lost connection to the interpreter server\n";
+    return 255;
+  }
+  return Status;
+}
+
+/// Receive the client's standard streams and the request payload.
+static bool receiveRequest(int Conn, int *Streams, std::vector<char> &Payload) {
+  uint32_t Size;
+  iovec IOV;
+  IOV.iov_base = &Size;
+  IOV.iov_len = sizeof(Size);
+
+  StreamsControl Control;
+  msghdr Msg;
+  memset(&Msg, 0, sizeof(Msg));
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control.Buffer;
+  Msg.msg_controllen = sizeof(Control.Buffer);
+
+  ssize_t N;
+  do
+    N = recvmsg(Conn, &Msg, 0);
+  while (N < 0 && errno == EINTR);
+  if (N != ssize_t(sizeof(Size)))
+    return false;
+
+  cmsghdr *Header = CMSG_FIRSTHDR(&Msg);
+  if (!Header || Header->cmsg_level != SOL_SOCKET ||
+      Header->cmsg_type != SCM_RIGHTS ||
+      Header->cmsg_len != CMSG_LEN(sizeof(int) * NumStreams))
+    return false;
+  memcpy(Streams, CMSG_DATA(Header), sizeof(int) * NumStreams);
+
+  Payload.resize(Size);
+  return Size && readAll(Conn, &Payload[0], Size) && Payload.back() == '\0';
+}
+
+/// Runs in a child of the server: run the request on \p Conn in a further
+/// child and report how it exited.
+LLVM_ATTRIBUTE_NORETURN static void serveConnection(int Conn,
+                                                    ScriptRunner &Runner) {
+  int Streams[NumStreams];
+  std::vector<char> Payload;
+  if (!receiveRequest(Conn, Streams, Payload))
+    _exit(1);
+
+  SmallVector<char *, 64> Strings;
+  for (size_t i = 0, e = Payload.size(); i != e; i += strlen(&Payload[i]) + 1)
+    Strings.push_back(&Payload[i]);
+  unsigned Argc;
+  if (Strings.size() < 2 || StringRef(Strings[1]).getAsInteger(10, Argc) ||
+      Argc == 0 || Strings.size() - 2 < Argc)
+    _exit(1);
+
+  const char *Cwd = Strings[0];
+  SmallVector<const char *, 16> Args(Strings.begin() + 2,
+                                     Strings.begin() + 2 + Argc);
+  std::vector<char *> Env(Strings.begin() + 2 + Argc, Strings.end());
+  Env.push_back(0);
+
+  pid_t Worker = fork();
+  if (Worker == 0) {
+    close(Conn);
+    for (int i = 0; i != NumStreams; ++i) {
+      dup2(Streams[i], i);
+      if (Streams[i] != i)
+        close(Streams[i]);
+    }
+    signal(SIGPIPE, SIG_DFL);
+    if (chdir(Cwd) != 0) {
+      llvm::errs() << "unable to change directory to " << Cwd << ": "
+                   << strerror(errno) << "\n";
+      _exit(255);
+    }
+    environ = &Env[0];
+    // exit() rather than _exit(), so that the script's buffered output and
+    // atexit handlers are flushed and run as they would be standalone.
+    exit(Runner.run(Args, &Env[0]));
+  }
+  for (int i = 0; i != NumStreams; ++i)
+    close(Streams[i]);
+
+  int32_t Status = 255;
+  int WaitStatus;
+  if (Worker > 0) {
+    pid_t Res;
+    do
+      Res = waitpid(Worker, &WaitStatus, 0);
+    while (Res < 0 && errno == EINTR);
+    if (Res == Worker) {
+      if (WIFEXITED(WaitStatus))
+        Status = WEXITSTATUS(WaitStatus);
+      else if (WIFSIGNALED(WaitStatus))
+        Status = 128 + WTERMSIG(WaitStatus);
+    }
+  }
+  writeAll(Conn, (const char *)&Status, sizeof(Status));
+  _exit(0);
+}
+
+int clang::RunInterpreterServer(StringRef SocketPath, ScriptRunner &Runner) {
+  sockaddr_un Addr;
+  if (!getSocketAddress(SocketPath, Addr))
+    return 1;
+
+  int Sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  // Replace the socket of an earlier server that went away.
+  unlink(Addr.sun_path);
+  // The server runs whatever it is sent, so only its own user may connect;
+  // nobody can before listen(), so there is no window for others to do so.
+  if (Sock < 0 || bind(Sock, (sockaddr *)&Addr, sizeof(Addr)) < 0 ||
+      chmod(Addr.sun_path, S_IRUSR | S_IWUSR) < 0 ||
+      listen(Sock, SOMAXCONN) < 0) {
+    llvm::errs() << "unable to listen on " << SocketPath << ": "
+                 << strerror(errno) << "\n";
+    return 1;
+  }
+
+  // Nobody waits for the per-request children; let the system reap them.
+  signal(SIGCHLD, SIG_IGN);
+  // A client that hangs up must not take the server down with it.
+  signal(SIGPIPE, SIG_IGN);
+
+  llvm::errs() << "clang-interpreter: listening on " << SocketPath << "\n";
+  for (;;) {
+    int Conn = accept(Sock, 0, 0);
+    if (Conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      llvm::errs() << "accept failed: " << strerror(errno) << "\n";
+      return 1;
+    }
+
+    // Another user could otherwise run code as this one.
+    uid_t Peer;
+    if (!getPeerUser(Conn, Peer) || Peer != geteuid()) {
+      llvm::errs() << "rejected a connection from another user\n";
+      close(Conn);
+      continue;
+    }
+
+    // Children must not inherit output the server has not written yet.
+    fflush(stdout);
+    llvm::errs().flush();
+    pid_t Monitor = fork();
+    if (Monitor == 0) {
+      close(Sock);
+      signal(SIGCHLD, SIG_DFL);
+      serveConnection(Conn, Runner);
+    }
+    if (Monitor < 0)
+      llvm::errs() << "fork failed: " << strerror(errno) << "\n";
+    close(Conn);
+  }
+}
+
+#else
+
+int clang::RunInterpreterClient(StringRef SocketPath,
+                                ArrayRef<const char *> Args,
+                                char * const *envp) {
+  llvm::errs() << "the interpreter server is not supported on this host\n";
+  return 255;
+}
+
+int clang::RunInterpreterServer(StringRef SocketPath, ScriptRunner &Runner) {
+  llvm::errs() << "the interpreter server is not supported on this host\n";
+  return 1;
+}
+
+#endif
@@ -0,0 +1,59 @@
+//===-- examples/clang-interpreter/InterpreterServer.h ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A resident interpreter that takes scripts over a Unix domain socket, so
+// that the one-time setup (target initialization, the driver, the resource
+// directory and the preamble PCHs) is paid once instead of once per script.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_INTERPRETERSERVER_H
+#define CLANG_INTERPRETER_INTERPRETERSERVER_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clang {
+
+/// \brief Runs one script on behalf of the server.
+class ScriptRunner {
+public:
+  virtual ~ScriptRunner();
+
+  /// Run the script described by the command line \p Args, whose first
+  /// element is the interpreter's argv[0].  Called in a child process whose
+  /// standard streams, working directory and environment are the client's.
+  /// Returns the exit status.
+  virtual int run(SmallVectorImpl<const char *> &Args,
+                  char * const *envp) = 0;
+};
+
+/// \brief Accept scripts on the socket at \p SocketPath until killed.
+///
+/// Each request is run in a child forked from the server, so it starts from
+/// the server's warm state and cannot disturb it or other requests.  A second
+/// child waits for it and reports its exit status, or 128 plus the signal
+/// that killed it, back to the client.
+///
+/// \returns a nonzero exit code if the socket could not be set up.
+int RunInterpreterServer(StringRef SocketPath, ScriptRunner &Runner);
+
+/// \brief Have the server at \p SocketPath run \p Args with this process's
+/// standard streams, working directory and environment.
+///
+/// \returns the script's exit status, or 255 if the server could not be
+/// reached.
+int RunInterpreterClient(StringRef SocketPath, ArrayRef<const char *> Args,
+                         char * const *envp);
+
+} // end namespace clang
+
+#endif
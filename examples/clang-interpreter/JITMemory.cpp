@@ -0,0 +1,86 @@
+//===-- examples/clang-interpreter/JITMemory.cpp --------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JITMemory.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include <algorithm>
+using namespace clang;
+
+uint64_t clang::estimateIRBytes(const llvm::Module &M) {
+  uint64_t Bytes = sizeof(llvm::Module);
+  Bytes += M.getGlobalList().size() * sizeof(llvm::GlobalVariable);
+  for (llvm::Module::const_iterator F = M.begin(), FE = M.end(); F != FE;
+       ++F) {
+    Bytes += sizeof(llvm::Function) + F->arg_size() * sizeof(llvm::Argument);
+    for (llvm::Function::const_iterator BB = F->begin(), BE = F->end();
+         BB != BE; ++BB) {
+      Bytes += sizeof(llvm::BasicBlock);
+      for (llvm::BasicBlock::const_iterator I = BB->begin(), IE = BB->end();
+           I != IE; ++I)
+        Bytes += sizeof(llvm::Instruction) +
+                 I->getNumOperands() * sizeof(llvm::Use);
+    }
+  }
+  return Bytes;
+}
+
+void JITMemoryTracker::NotifyFunctionEmitted(
+    const llvm::Function &F, void *Code, size_t Size,
+    const EmittedFunctionDetails &Details) {
+  CodeSizes[Code] = Size;
+  CodeBytes += Size;
+  Compiled.push_back(const_cast<llvm::Function *>(&F));
+}
+
+void JITMemoryTracker::NotifyFreeingMachineCode(void *OldPtr) {
+  llvm::DenseMap<void *, size_t>::iterator I = CodeSizes.find(OldPtr);
+  if (I == CodeSizes.end())
+    return;
+  CodeBytes -= I->second;
+  CodeSizes.erase(I);
+}
+
+/// Whether the body of \p F has to stay, because a blockaddress refers to
+/// one of its blocks.
+static bool hasAddressTakenBlock(const llvm::Function &F) {
+  for (llvm::Function::const_iterator BB = F.begin(), E = F.end(); BB != E;
+       ++BB)
+    if (BB->hasAddressTaken())
+      return true;
+  return false;
+}
+
+unsigned JITMemoryTracker::reclaimIR() {
+  unsigned NumReclaimed = 0;
+  for (unsigned i = 0, e = Compiled.size(); i != e; ++i) {
+    llvm::Function *F = Compiled[i];
+    if (F->isDeclaration() || hasAddressTakenBlock(*F))
+      continue;
+    // The engine maps F to its machine code, so it is never looked up
+    // outside the session even though it is a declaration now.
+    F->deleteBody();
+    ++NumReclaimed;
+  }
+  Compiled.clear();
+  return NumReclaimed;
+}
+
+namespace {
+struct InModule {
+  const llvm::Module *M;
+  explicit InModule(const llvm::Module *M) : M(M) {}
+  bool operator()(const llvm::Function *F) const { return F->getParent() == M; }
+};
+}
+
+void JITMemoryTracker::forgetModule(const llvm::Module *M) {
+  Compiled.erase(std::remove_if(Compiled.begin(), Compiled.end(), InModule(M)),
+                 Compiled.end());
+}
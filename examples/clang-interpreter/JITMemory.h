@@ -0,0 +1,85 @@
+//===-- examples/clang-interpreter/JITMemory.h ------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Accounting for the memory a JIT session holds on to, and reclaiming the IR
+// of functions that have already been compiled.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_JITMEMORY_H
+#define CLANG_INTERPRETER_JITMEMORY_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/Support/DataTypes.h"
+#include <vector>
+
+namespace llvm {
+  class Function;
+  class Module;
+}
+
+namespace clang {
+
+/// \brief Memory held by a JIT session.
+struct JITMemoryUsage {
+  /// Estimated size of the IR of the session's modules.
+  uint64_t IRBytes;
+  /// Machine code emitted by the JIT and not freed since.
+  uint64_t MachineCodeBytes;
+  /// Objective-C runtime objects created for generated code, i.e. the pooled
+  /// constant strings, which every session in the process shares.
+  uint64_t ObjCBytes;
+  unsigned NumModules;
+
+  JITMemoryUsage()
+    : IRBytes(0), MachineCodeBytes(0), ObjCBytes(0), NumModules(0) {}
+
+  uint64_t getTotal() const { return IRBytes + MachineCodeBytes + ObjCBytes; }
+};
+
+/// \brief Estimate the memory taken up by the IR of \p M, from the number of
+/// functions, blocks, instructions and operands it has.  Constants, types
+/// and metadata live in the LLVMContext and are not counted.
+uint64_t estimateIRBytes(const llvm::Module &M);
+
+/// \brief Listens to the JIT, keeping track of the machine code it emits and
+/// of the functions whose IR is no longer needed.
+class JITMemoryTracker : public llvm::JITEventListener {
+  /// The size of each piece of machine code, by its start address.
+  llvm::DenseMap<void *, size_t> CodeSizes;
+  uint64_t CodeBytes;
+
+  /// Functions compiled since the last reclaimIR().
+  std::vector<llvm::Function *> Compiled;
+
+public:
+  JITMemoryTracker() : CodeBytes(0) {}
+
+  virtual void NotifyFunctionEmitted(const llvm::Function &F, void *Code,
+                                     size_t Size,
+                                     const EmittedFunctionDetails &Details);
+  virtual void NotifyFreeingMachineCode(void *OldPtr);
+
+  uint64_t getMachineCodeBytes() const { return CodeBytes; }
+
+  /// Delete the bodies of the functions compiled since the last call; the
+  /// engine goes on using their machine code.  Must not be called while the
+  /// JIT is compiling, e.g. from a listener.  Returns the number of bodies
+  /// deleted.
+  unsigned reclaimIR();
+
+  /// Stop tracking the functions of \p M, which is about to be deleted.
+  void forgetModule(const llvm::Module *M);
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,218 @@
+//===-- examples/clang-interpreter/ParallelFrontend.cpp -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ParallelFrontend.h"
+#include "clang/CodeGen/CodeGenAction.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/TextDiagnosticPrinter.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/config.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+#if HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+using namespace clang;
+
+namespace {
+/// One source file: how to compile it, and what compiling it produced.
+struct CompileUnit {
+  CompilerInvocation *Invocation;
+  std::string Diagnostics;
+  std::string Bitcode;
+  bool Success;
+};
+
+/// Units one thread compiles one after another.
+typedef SmallVector<unsigned, 4> CompileTask;
+
+struct CompileQueue {
+  std::vector<CompileUnit> Units;
+  std::vector<CompileTask> Tasks;
+  volatile llvm::sys::cas_flag NextTask;
+};
+}
+
+/// Threads compiling clang's deeply recursive parser and IR generator need
+/// as much stack as the main thread usually gets.
+static const size_t CompileThreadStackSize = 8 << 20;
+
+static void compileUnit(CompileUnit &Unit) {
+  // The context must outlive everything that refers to it, and the stream
+  // the compiler instance reports to.
+  llvm::LLVMContext Context;
+  llvm::raw_string_ostream DiagOS(Unit.Diagnostics);
+  CompilerInstance Clang;
+  Clang.setInvocation(Unit.Invocation);
+  Clang.createDiagnostics(
+    new TextDiagnosticPrinter(DiagOS, &Clang.getDiagnosticOpts()));
+
+  EmitLLVMOnlyAction Act(&Context);
+  Unit.Success = Clang.ExecuteAction(Act);
+  if (!Unit.Success)
+    return;
+
+  OwningPtr<llvm::Module> M(Act.takeModule());
+  if (!M) {
+    Unit.Success = false;
+    return;
+  }
+  // Modules cannot move between contexts; the bitcode can.
+  llvm::raw_string_ostream BitcodeOS(Unit.Bitcode);
+  llvm::WriteBitcodeToFile(M.get(), BitcodeOS);
+}
+
+static void *runCompileTasks(void *Arg) {
+  CompileQueue &Queue = *static_cast<CompileQueue *>(Arg);
+  for (;;) {
+    unsigned Task = llvm::sys::AtomicIncrement(&Queue.NextTask) - 1;
+    if (Task >= Queue.Tasks.size())
+      return 0;
+    for (unsigned i = 0, e = Queue.Tasks[Task].size(); i != e; ++i)
+      compileUnit(Queue.Units[Queue.Tasks[Task][i]]);
+  }
+}
+
+unsigned clang::getDefaultFrontendThreads() {
+#if HAVE_UNISTD_H && defined(_SC_NPROCESSORS_ONLN)
+  long NumCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+  if (NumCPUs > 0)
+    return NumCPUs;
+#endif
+  return 1;
+}
+
+llvm::Module *clang::CompileAndLink(ArrayRef<CompilerInvocation *> Invocations,
+                                    unsigned NumThreads,
+                                    llvm::LLVMContext &Context,
+                                    raw_ostream &DiagOS) {
+  CompileQueue Queue;
+  Queue.Units.resize(Invocations.size());
+  Queue.NextTask = 0;
+  CompileTask ObjCTask;
+  bool HasBackendOptions = false;
+  for (unsigned i = 0, e = Invocations.size(); i != e; ++i) {
+    CompileUnit &Unit = Queue.Units[i];
+    Unit.Invocation = Invocations[i];
+    Unit.Success = false;
+    if (!Unit.Invocation->getCodeGenOpts().BackendOptions.empty())
+      HasBackendOptions = true;
+    if (Unit.Invocation->getLangOpts()->ObjC1)
+      ObjCTask.push_back(i);
+    else
+      Queue.Tasks.push_back(CompileTask(1, i));
+  }
+  // The Objective-C files are likely the longest task; start them first.
+  if (!ObjCTask.empty())
+    Queue.Tasks.insert(Queue.Tasks.begin(), ObjCTask);
+
+  // Backend options are global LLVM options that every compile sets again;
+  // they are not safe to have in effect for one file while another one is
+  // being compiled.
+  if (HasBackendOptions)
+    NumThreads = 1;
+  NumThreads = std::max(1U, std::min<unsigned>(NumThreads,
+                                               Queue.Tasks.size()));
+#if HAVE_PTHREAD_H
+  std::vector<pthread_t> Threads;
+  if (NumThreads > 1) {
+    if (!llvm::llvm_is_multithreaded())
+      llvm::llvm_start_multithreaded();
+    pthread_attr_t Attr;
+    pthread_attr_init(&Attr);
+    pthread_attr_setstacksize(&Attr, CompileThreadStackSize);
+    // This thread is one of the workers.
+    for (unsigned i = 1; i != NumThreads; ++i) {
+      pthread_t Thread;
+      if (pthread_create(&Thread, &Attr, runCompileTasks, &Queue) == 0)
+        Threads.push_back(Thread);
+    }
+    pthread_attr_destroy(&Attr);
+  }
+  runCompileTasks(&Queue);
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    pthread_join(Threads[i], 0);
+#else
+  runCompileTasks(&Queue);
+#endif
+
+  OwningPtr<llvm::Module> Linked;
+  bool Success = true;
+  for (unsigned i = 0, e = Queue.Units.size(); i != e; ++i) {
+    CompileUnit &Unit = Queue.Units[i];
+    DiagOS << Unit.Diagnostics;
+    if (!Unit.Success)
+      Success = false;
+    // Keep going, to show the diagnostics of every file.
+    if (!Success)
+      continue;
+
+    std::string Error;
+    OwningPtr<llvm::MemoryBuffer> Buffer(
+      llvm::MemoryBuffer::getMemBuffer(Unit.Bitcode, "", false));
+    OwningPtr<llvm::Module> M(llvm::ParseBitcodeFile(Buffer.get(), Context,
+                                                     &Error));
+    Buffer.reset();
+    std::string().swap(Unit.Bitcode);
+    if (!M) {
+      DiagOS << "error: unable to read back a compiled module: " << Error
+             << "\n";
+      Success = false;
+      continue;
+    }
+
+    if (llvm::Function *InitFn = M->getFunction(".objc_jit_init"))
+      InitFn->setName(".objc_jit_init." + llvm::utostr(i));
+
+    if (!Linked) {
+      Linked.reset(M.take());
+    } else if (llvm::Linker::LinkModules(Linked.get(), M.get(),
+                                         llvm::Linker::DestroySource,
+                                         &Error)) {
+      DiagOS << "error: unable to link '" << M->getModuleIdentifier()
+             << "': " << Error << "\n";
+      Success = false;
+    }
+  }
+  if (!Success || !Linked)
+    return 0;
+
+  // The interpreter runs one .objc_jit_init; make it run every file's, in
+  // command line order.
+  llvm::FunctionType *InitTy =
+    llvm::FunctionType::get(llvm::Type::getVoidTy(Context), false);
+  llvm::Function *InitFn =
+    llvm::Function::Create(InitTy, llvm::GlobalValue::PrivateLinkage,
+                           ".objc_jit_init", Linked.get());
+  llvm::IRBuilder<> Builder(llvm::BasicBlock::Create(Context, "entry", InitFn));
+  for (unsigned i = 0, e = Queue.Units.size(); i != e; ++i)
+    if (llvm::Function *FileInitFn =
+          Linked->getFunction(".objc_jit_init." + llvm::utostr(i)))
+      Builder.CreateCall(FileInitFn);
+  Builder.CreateRetVoid();
+
+  return Linked.take();
+}
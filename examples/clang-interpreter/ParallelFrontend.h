@@ -0,0 +1,56 @@
+//===-- examples/clang-interpreter/ParallelFrontend.h -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Compiles the source files of a multi-file program on several threads and
+// links the results into a single module for the JIT.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_PARALLELFRONTEND_H
+#define CLANG_INTERPRETER_PARALLELFRONTEND_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+
+namespace llvm {
+  class LLVMContext;
+  class Module;
+}
+
+namespace clang {
+class CompilerInvocation;
+
+/// \brief Run EmitLLVMOnlyAction over each of \p Invocations, using up to
+/// \p NumThreads threads, and link the modules into one.
+///
+/// Each file is compiled with its own CompilerInstance and LLVMContext and
+/// handed back as bitcode, which is then read into \p Context and linked in
+/// command line order.  Diagnostics are printed to \p DiagOS once all files
+/// are done, grouped by file and in the same order.
+///
+/// The host Objective-C runtime gets classes and categories registered
+/// while their implementations are compiled, so Objective-C files are
+/// compiled one after another, in command line order, while other files
+/// are compiled alongside them.  If any file passes options to the LLVM
+/// backend (-backend-option), all of them are compiled on one thread.  Each
+/// file's .objc_jit_init is renamed, and the linked module gets a
+/// .objc_jit_init that calls them all in order.
+///
+/// Takes ownership of \p Invocations.  Returns null if any file failed to
+/// compile or the modules could not be linked.
+llvm::Module *CompileAndLink(ArrayRef<CompilerInvocation *> Invocations,
+                             unsigned NumThreads, llvm::LLVMContext &Context,
+                             raw_ostream &DiagOS);
+
+/// \brief The number of processors online, or 1 if that is not known.
+unsigned getDefaultFrontendThreads();
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,216 @@
+//===-- examples/clang-interpreter/PreambleCache.cpp ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PreambleCache.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+/// Hash everything that can change what the preamble means, beyond what the
+/// invocation's module hash already covers.
+static std::string GetPreambleKey(const CompilerInvocation &Invocation,
+                                  StringRef Preamble, bool AtStartOfLine) {
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+
+  llvm::hash_code Hash = llvm::hash_combine(Invocation.getModuleHash(),
+                                            Preamble, AtStartOfLine,
+                                            HSOpts.ResourceDir);
+  Hash = llvm::hash_combine(Hash, HSOpts.UseBuiltinIncludes,
+                            HSOpts.UseStandardSystemIncludes,
+                            HSOpts.UseStandardCXXIncludes);
+
+  // Quoted #includes are looked up next to the main file first, so the same
+  // preamble means something else in another directory.
+  const FileSystemOptions &FSOpts = Invocation.getFileSystemOpts();
+  SmallString<256> MainFile(Invocation.getFrontendOpts().Inputs[0].getFile());
+  if (!FSOpts.WorkingDir.empty() && !llvm::sys::path::is_absolute(MainFile)) {
+    SmallString<256> Path(FSOpts.WorkingDir);
+    llvm::sys::path::append(Path, MainFile.str());
+    MainFile = Path;
+  }
+  llvm::sys::fs::make_absolute(MainFile);
+  Hash = llvm::hash_combine(Hash, llvm::sys::path::parent_path(MainFile.str()));
+
+  for (unsigned i = 0, e = HSOpts.UserEntries.size(); i != e; ++i)
+    Hash = llvm::hash_combine(Hash, HSOpts.UserEntries[i].Path,
+                              HSOpts.UserEntries[i].Group,
+                              HSOpts.UserEntries[i].IsFramework);
+  for (unsigned i = 0, e = PPOpts.Includes.size(); i != e; ++i)
+    Hash = llvm::hash_combine(Hash, PPOpts.Includes[i]);
+  for (unsigned i = 0, e = PPOpts.MacroIncludes.size(); i != e; ++i)
+    Hash = llvm::hash_combine(Hash, PPOpts.MacroIncludes[i]);
+
+  return llvm::utohexstr(static_cast<uint64_t>(static_cast<size_t>(Hash)));
+}
+
+/// Check the "size mtime path" lines written by WriteDependencies against the
+/// file system.
+static bool DependenciesAreUpToDate(StringRef DepsPath) {
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (llvm::MemoryBuffer::getFile(DepsPath, Buffer))
+    return false;
+
+  StringRef Rest = Buffer->getBuffer();
+  if (!Rest.endswith("\n"))
+    return false;
+  while (!Rest.empty()) {
+    StringRef Line;
+    llvm::tie(Line, Rest) = Rest.split('\n');
+    StringRef Size, MTime, Path;
+    llvm::tie(Size, Line) = Line.split(' ');
+    llvm::tie(MTime, Path) = Line.split(' ');
+
+    uint64_t ExpectedSize, ExpectedMTime;
+    if (Size.getAsInteger(10, ExpectedSize) ||
+        MTime.getAsInteger(10, ExpectedMTime) || Path.empty())
+      return false;
+
+    llvm::sys::fs::file_status Status;
+    if (llvm::sys::fs::status(Path, Status) ||
+        Status.getSize() != ExpectedSize ||
+        Status.getLastModificationTime().toEpochTime() != ExpectedMTime)
+      return false;
+  }
+  return true;
+}
+
+/// Record every file \p Clang read except its main file.  The file is written
+/// under a temporary name and renamed into place, so a concurrent reader sees
+/// either all of it or none of it.
+static bool WriteDependencies(CompilerInstance &Clang, StringRef DepsPath) {
+  SmallVector<const FileEntry *, 64> Files;
+  Clang.getFileManager().GetUniqueIDMapping(Files);
+  const FileEntry *MainFile =
+    Clang.getSourceManager().getFileEntryForID(
+      Clang.getSourceManager().getMainFileID());
+
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::unique_file(DepsPath + "-%%%%%%%%", FD, TempPath))
+    return false;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+      if (!Files[i] || Files[i] == MainFile)
+        continue;
+      OS << static_cast<uint64_t>(Files[i]->getSize()) << ' '
+         << static_cast<uint64_t>(Files[i]->getModificationTime()) << ' '
+         << Files[i]->getName() << '\n';
+    }
+    if (OS.has_error()) {
+      OS.clear_error();
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+      return false;
+    }
+  }
+  return !llvm::sys::fs::rename(TempPath.str(), DepsPath);
+}
+
+/// Precompile the first \p PreambleSize bytes of the main file of
+/// \p Invocation into \p PCHPath.  Diagnostics are dropped; if the preamble
+/// has errors they are reported when the script itself is compiled.
+static bool BuildPreamblePCH(const CompilerInvocation &Invocation,
+                             const llvm::MemoryBuffer *MainBuffer,
+                             unsigned PreambleSize, StringRef PCHPath,
+                             StringRef DepsPath) {
+  CompilerInvocation *PCHInvocation = new CompilerInvocation(Invocation);
+  FrontendOptions &FrontendOpts = PCHInvocation->getFrontendOpts();
+  FrontendOpts.ProgramAction = frontend::GeneratePCH;
+  FrontendOpts.OutputFile = PCHPath.str();
+  FrontendOpts.ShowStats = false;
+  FrontendOpts.ShowTimers = false;
+  PCHInvocation->getDiagnosticOpts().ShowCarets = false;
+
+  // Compile only the preamble, under the name of the main file.
+  StringRef MainFile = FrontendOpts.Inputs[0].getFile();
+  PCHInvocation->getPreprocessorOpts().addRemappedFile(
+    MainFile,
+    llvm::MemoryBuffer::getMemBufferCopy(
+      MainBuffer->getBuffer().substr(0, PreambleSize), MainFile));
+
+  CompilerInstance Clang;
+  Clang.setInvocation(PCHInvocation);
+  Clang.createDiagnostics(new IgnoringDiagConsumer);
+
+  GeneratePCHAction Act;
+  if (!Clang.ExecuteAction(Act) || Clang.getDiagnostics().hasErrorOccurred())
+    return false;
+
+  return WriteDependencies(Clang, DepsPath);
+}
+
+bool clang::UseCachedPreamble(CompilerInvocation &Invocation,
+                              StringRef CacheDir) {
+  FrontendOptions &FrontendOpts = Invocation.getFrontendOpts();
+  PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+
+  // Leave an explicit PCH alone, and don't try to cache stdin.
+  if (!PPOpts.ImplicitPCHInclude.empty() || !PPOpts.ImplicitPTHInclude.empty())
+    return false;
+  if (FrontendOpts.Inputs.size() != 1 || !FrontendOpts.Inputs[0].isFile() ||
+      FrontendOpts.Inputs[0].getFile() == "-")
+    return false;
+
+  OwningPtr<llvm::MemoryBuffer> MainBuffer;
+  if (llvm::MemoryBuffer::getFile(FrontendOpts.Inputs[0].getFile(),
+                                  MainBuffer))
+    return false;
+
+  std::pair<unsigned, bool> Preamble =
+    Lexer::ComputePreamble(MainBuffer.get(), *Invocation.getLangOpts());
+  if (Preamble.first == 0)
+    return false;
+
+  std::string Key = GetPreambleKey(Invocation,
+                                   MainBuffer->getBuffer().substr(
+                                     0, Preamble.first),
+                                   Preamble.second);
+  SmallString<128> PCHPath(CacheDir);
+  llvm::sys::path::append(PCHPath, Key + ".pch");
+  SmallString<128> DepsPath(CacheDir);
+  llvm::sys::path::append(DepsPath, Key + ".deps");
+
+  // The dependency list is written last, so its presence means the PCH is
+  // complete.
+  if (!DependenciesAreUpToDate(DepsPath.str())) {
+    bool Existed;
+    if (llvm::sys::fs::create_directories(CacheDir, Existed))
+      return false;
+    if (!BuildPreamblePCH(Invocation, MainBuffer.get(), Preamble.first,
+                          PCHPath.str(), DepsPath.str()))
+      return false;
+  }
+
+  // This is how ASTUnit reuses a precompiled preamble: the PCH stands in for
+  // the first bytes of the main file, which the preprocessor then skips.  We
+  // have validated the headers ourselves, and the main file is expected to
+  // differ from the one the PCH was built from.
+  PPOpts.ImplicitPCHInclude = PCHPath.str();
+  PPOpts.PrecompiledPreambleBytes = Preamble;
+  PPOpts.DisablePCHValidation = true;
+  return true;
+}
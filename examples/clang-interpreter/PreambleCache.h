@@ -0,0 +1,40 @@
+//===-- examples/clang-interpreter/PreambleCache.h --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An on-disk cache of precompiled headers for the block of #include and
+// #import directives at the start of interpreted scripts.  Scripts that pull
+// in large framework headers spend most of their startup parsing them; with
+// the cache only the first run does.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_PREAMBLECACHE_H
+#define CLANG_INTERPRETER_PREAMBLECACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace clang {
+class CompilerInvocation;
+
+/// \brief Make \p Invocation load the preamble of its main file from a PCH
+/// in \p CacheDir, building the PCH first if there is no up to date one.
+///
+/// A cached PCH is reused when the preamble text and every option that
+/// affects its meaning are unchanged, and none of the headers it was built
+/// from have changed size or modification time since.  Anything that goes
+/// wrong while building it leaves \p Invocation untouched, so that the script
+/// is compiled (and its errors reported) the usual way.
+///
+/// \returns true if \p Invocation now uses a cached PCH.
+bool UseCachedPreamble(CompilerInvocation &Invocation, StringRef CacheDir);
+
+} // end namespace clang
+
+#endif
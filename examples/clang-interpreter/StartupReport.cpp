@@ -0,0 +1,220 @@
+//===-- examples/clang-interpreter/StartupReport.cpp ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StartupReport.h"
+#include "clang/AST/ASTConsumer.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/CodeGen/ObjCJitRuntimeStats.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+static const char *const PhaseNames[StartupReport::NumPhases] = {
+  "driver", "invocation", "frontend-init", "headers", "main-file", "irgen",
+  "ir-optimize", "jit-codegen", "objc-jit-init", "main"
+};
+
+void StartupReport::charge(const llvm::TimeRecord &Now) {
+  if (Stack.empty())
+    return;
+  llvm::TimeRecord Delta = Now;
+  Delta -= Started;
+  Elapsed[Stack.back()] += Delta;
+}
+
+void StartupReport::enter(Phase P) {
+  llvm::TimeRecord Now = llvm::TimeRecord::getCurrentTime();
+  charge(Now);
+  Stack.push_back(P);
+  Started = Now;
+}
+
+void StartupReport::leave() {
+  llvm::TimeRecord Now = llvm::TimeRecord::getCurrentTime();
+  charge(Now);
+  Stack.pop_back();
+  Started = Now;
+}
+
+void StartupReport::switchTo(Phase P) {
+  if (Stack.empty() || Stack.back() == P)
+    return;
+  llvm::TimeRecord Now = llvm::TimeRecord::getCurrentTime();
+  charge(Now);
+  Stack.back() = P;
+  Started = Now;
+}
+
+static void printTimes(raw_ostream &OS, const llvm::TimeRecord &T) {
+  OS << "\"wall\": " << llvm::format("%.6f", T.getWallTime())
+     << ", \"user\": " << llvm::format("%.6f", T.getUserTime())
+     << ", \"system\": " << llvm::format("%.6f", T.getSystemTime())
+     << ", \"malloc_delta\": " << int64_t(T.getMemUsed());
+}
+
+void StartupReport::print(raw_ostream &OS) {
+  llvm::TimeRecord Total;
+  OS << "{\n  \"phases\": [\n";
+  for (unsigned i = 0; i != NumPhases; ++i) {
+    OS << "    { \"name\": \"" << PhaseNames[i] << "\", ";
+    printTimes(OS, Elapsed[i]);
+    OS << " }" << (i + 1 != NumPhases ? "," : "") << "\n";
+    Total += Elapsed[i];
+  }
+  OS << "  ],\n  \"total\": { ";
+  printTimes(OS, Total);
+  OS << " },\n  \"objc_runtime_calls\": {";
+
+  SmallVector<std::pair<StringRef, unsigned>, 32> Calls;
+  getObjCJitRuntimeCallCounts(Calls);
+  unsigned NumCalls = 0;
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i) {
+    OS << (i ? ",\n" : "\n") << "    \"" << Calls[i].first << "\": "
+       << Calls[i].second;
+    NumCalls += Calls[i].second;
+  }
+  OS << (Calls.empty() ? "" : "\n  ") << "},\n"
+     << "  \"objc_runtime_calls_total\": " << NumCalls << ",\n";
+
+  ObjCJitStringPoolStats Strings;
+  getObjCJitStringPoolStats(Strings);
+  OS << "  \"objc_constant_strings\": { \"count\": " << Strings.NumStrings
+     << ", \"lookups\": " << Strings.Lookups
+     << ", \"hits\": " << Strings.Hits
+     << ", \"hit_rate\": "
+     << llvm::format("%.3f", Strings.Lookups ? double(Strings.Hits) /
+                                                 Strings.Lookups : 0.0)
+     << ", \"bytes\": " << Strings.BytesRetained << " }\n}\n";
+}
+
+namespace {
+
+/// Charges preprocessing and parsing to Headers or MainFile, depending on
+/// which file the preprocessor is in.
+class PhaseCallbacks : public PPCallbacks {
+  StartupReport &Report;
+  SourceManager &SM;
+
+public:
+  PhaseCallbacks(StartupReport &Report, SourceManager &SM)
+    : Report(Report), SM(SM) {}
+
+  virtual void FileChanged(SourceLocation Loc, FileChangeReason Reason,
+                           SrcMgr::CharacteristicKind FileType,
+                           FileID PrevFID) {
+    if (Reason != EnterFile && Reason != ExitFile)
+      return;
+    bool InMainFile = SM.getFileID(SM.getExpansionLoc(Loc)) ==
+                      SM.getMainFileID();
+    Report.switchTo(InMainFile ? StartupReport::MainFile
+                               : StartupReport::Headers);
+  }
+};
+
+/// Forwards to the code generator, charging its work to IRGen or, at the end
+/// of the translation unit, to IROptimize.  Every hook is passed on, so that
+/// the report does not change the code that is generated.
+class TimedConsumer : public ASTConsumer {
+  StartupReport &Report;
+  OwningPtr<ASTConsumer> Inner;
+
+public:
+  TimedConsumer(StartupReport &Report, ASTConsumer *Inner)
+    : Report(Report), Inner(Inner) {}
+
+  virtual void Initialize(ASTContext &Context) {
+    Inner->Initialize(Context);
+  }
+  virtual bool HandleTopLevelDecl(DeclGroupRef D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    return Inner->HandleTopLevelDecl(D);
+  }
+  virtual void HandleInterestingDecl(DeclGroupRef D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleInterestingDecl(D);
+  }
+  virtual void HandleTranslationUnit(ASTContext &Ctx) {
+    StartupReport::Region R(&Report, StartupReport::IROptimize);
+    Inner->HandleTranslationUnit(Ctx);
+  }
+  virtual void HandleTagDeclDefinition(TagDecl *D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleTagDeclDefinition(D);
+  }
+  virtual void HandleTagDeclRequiredDefinition(const TagDecl *D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleTagDeclRequiredDefinition(D);
+  }
+  virtual void HandleCXXImplicitFunctionInstantiation(FunctionDecl *D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleCXXImplicitFunctionInstantiation(D);
+  }
+  virtual void HandleTopLevelDeclInObjCContainer(DeclGroupRef D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleTopLevelDeclInObjCContainer(D);
+  }
+  virtual void HandleImplicitImportDecl(ImportDecl *D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleImplicitImportDecl(D);
+  }
+  virtual void HandleLinkerOptionPragma(StringRef Opts) {
+    Inner->HandleLinkerOptionPragma(Opts);
+  }
+  virtual void HandleDetectMismatch(StringRef Name, StringRef Value) {
+    Inner->HandleDetectMismatch(Name, Value);
+  }
+  virtual void HandleDependentLibrary(StringRef Lib) {
+    Inner->HandleDependentLibrary(Lib);
+  }
+  virtual void CompleteTentativeDefinition(VarDecl *D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->CompleteTentativeDefinition(D);
+  }
+  virtual void HandleCXXStaticMemberVarInstantiation(VarDecl *D) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleCXXStaticMemberVarInstantiation(D);
+  }
+  virtual void HandleVTable(CXXRecordDecl *RD, bool DefinitionRequired) {
+    StartupReport::Region R(&Report, StartupReport::IRGen);
+    Inner->HandleVTable(RD, DefinitionRequired);
+  }
+  virtual ASTMutationListener *GetASTMutationListener() {
+    return Inner->GetASTMutationListener();
+  }
+  virtual ASTDeserializationListener *GetASTDeserializationListener() {
+    return Inner->GetASTDeserializationListener();
+  }
+  virtual void PrintStats() {
+    Inner->PrintStats();
+  }
+  virtual bool shouldSkipFunctionBody(Decl *D) {
+    return Inner->shouldSkipFunctionBody(D);
+  }
+};
+
+} // end anonymous namespace
+
+ASTConsumer *TimedEmitLLVMOnlyAction::CreateASTConsumer(CompilerInstance &CI,
+                                                        StringRef InFile) {
+  ASTConsumer *Inner = EmitLLVMOnlyAction::CreateASTConsumer(CI, InFile);
+  if (!Inner)
+    return 0;
+  return new TimedConsumer(Report, Inner);
+}
+
+bool TimedEmitLLVMOnlyAction::BeginSourceFileAction(CompilerInstance &CI,
+                                                    StringRef Filename) {
+  CI.getPreprocessor().addPPCallbacks(
+    new PhaseCallbacks(Report, CI.getSourceManager()));
+  return EmitLLVMOnlyAction::BeginSourceFileAction(CI, Filename);
+}
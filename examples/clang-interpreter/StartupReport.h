@@ -0,0 +1,95 @@
+//===-- examples/clang-interpreter/StartupReport.h --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Measures where the time goes between starting the interpreter and main()
+// returning: driver, frontend, header and main file parsing, IR generation,
+// optimization, native code generation and the script itself.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_STARTUPREPORT_H
+#define CLANG_INTERPRETER_STARTUPREPORT_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/CodeGen/CodeGenAction.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/Timer.h"
+
+namespace clang {
+
+/// \brief Wall, user and system time and malloc'd memory per startup phase.
+///
+/// Phases nest: entering one pauses the enclosing phase until it is left
+/// again, so that every moment is charged to exactly one phase.
+class StartupReport {
+public:
+  enum Phase {
+    Driver,        ///< Building the driver's compilation.
+    Invocation,    ///< Turning the -cc1 arguments into an invocation.
+    FrontendInit,  ///< Target, preprocessor, PCH and builtins.
+    Headers,       ///< Lexing, parsing and Sema in included files.
+    MainFile,      ///< Lexing, parsing and Sema in the main file.
+    IRGen,         ///< Generating IR for each top-level declaration.
+    IROptimize,    ///< Finishing the module and running the optimizer.
+    JITCodeGen,    ///< Native code generation ahead of running anything.
+    ObjCJitInit,   ///< Running .objc_jit_init.
+    Main,          ///< Running main().
+    NumPhases
+  };
+
+  /// Charges everything between construction and destruction to a phase.
+  class Region {
+    StartupReport *Report;
+  public:
+    /// \p Report may be null, in which case nothing is measured.
+    Region(StartupReport *Report, Phase P) : Report(Report) {
+      if (Report)
+        Report->enter(P);
+    }
+    ~Region() {
+      if (Report)
+        Report->leave();
+    }
+  };
+
+private:
+  llvm::TimeRecord Elapsed[NumPhases];
+  SmallVector<Phase, 4> Stack;
+  llvm::TimeRecord Started;
+
+  void charge(const llvm::TimeRecord &Now);
+
+public:
+  void enter(Phase P);
+  void leave();
+  /// Charge the innermost phase up to now and continue in \p P instead.
+  void switchTo(Phase P);
+
+  /// Write the report, along with the calls made into the host Objective-C
+  /// runtime during code generation, as a JSON object.
+  void print(raw_ostream &OS);
+};
+
+/// \brief EmitLLVMOnlyAction, charging parsing to the Headers and MainFile
+/// phases and the code generator's work to IRGen and IROptimize.
+class TimedEmitLLVMOnlyAction : public EmitLLVMOnlyAction {
+  StartupReport &Report;
+
+protected:
+  virtual ASTConsumer *CreateASTConsumer(CompilerInstance &CI,
+                                         StringRef InFile);
+  virtual bool BeginSourceFileAction(CompilerInstance &CI, StringRef Filename);
+
+public:
+  explicit TimedEmitLLVMOnlyAction(StartupReport &Report) : Report(Report) {}
+};
+
+} // end namespace clang
+
+#endif
@@ -0,0 +1,382 @@
+//===-- examples/clang-interpreter/TieredExecution.cpp --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "TieredExecution.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/Interpreter.h"
+#include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+using namespace clang;
+
+namespace {
+/// Time spent in native code entered from the interpreter, which includes the
+/// JIT compiling it, and the number of functions the JIT compiled.
+struct TierStatistics {
+  double NativeSeconds;
+  double NativeEnteredAt;
+  unsigned NumCompiled;
+};
+}
+
+static TierStatistics Stats;
+
+static double GetWallTime() {
+  return llvm::TimeRecord::getCurrentTime(true).getWallTime();
+}
+
+// Called by the interpreter around every switch to native code.  Native code
+// never calls back into the interpreter, so these cannot nest.
+static void TierNativeEnter() {
+  Stats.NativeEnteredAt = GetWallTime();
+}
+
+static void TierNativeExit() {
+  Stats.NativeSeconds += GetWallTime() - Stats.NativeEnteredAt;
+}
+
+namespace {
+class CompileCounter : public llvm::JITEventListener {
+public:
+  virtual void NotifyFunctionEmitted(const llvm::Function &F, void *Code,
+                                     size_t Size,
+                                     const EmittedFunctionDetails &Details) {
+    ++Stats.NumCompiled;
+  }
+};
+}
+
+/// Whether \p V is, or is a constant built from, the address of a function
+/// or of a global that exists only on the native side.
+static bool IsNativeOnly(const llvm::Value *V,
+                         const llvm::SmallPtrSet<const llvm::Value*, 16>
+                           &NativeGlobals) {
+  if (isa<llvm::Function>(V))
+    return true;
+  if (isa<llvm::GlobalValue>(V))
+    return NativeGlobals.count(V);
+  if (const llvm::Constant *C = dyn_cast<llvm::Constant>(V))
+    for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+      if (IsNativeOnly(C->getOperand(i), NativeGlobals))
+        return true;
+  return false;
+}
+
+/// Whether the interpreter can pass the arguments and result of \p F to
+/// native code; libffi only handles scalars and pointers passed directly.
+static bool CanCallNatively(const llvm::Function &F) {
+  llvm::FunctionType *FTy = F.getFunctionType();
+  if (!FTy->getReturnType()->isVoidTy() &&
+      !FTy->getReturnType()->isSingleValueType())
+    return false;
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    if (!FTy->getParamType(i)->isSingleValueType() ||
+        FTy->getParamType(i)->isVectorTy() ||
+        F.getAttributes().hasAttribute(i + 1, llvm::Attribute::ByVal))
+      return false;
+  return !FTy->getReturnType()->isVectorTy() &&
+         !F.getAttributes().hasAttribute(1, llvm::Attribute::StructRet);
+}
+
+/// Whether \p F has to run natively; see TieredExecutor.
+static bool MustRunNative(const llvm::Function &F,
+                          const llvm::SmallPtrSet<const llvm::Value*, 16>
+                            &NativeGlobals) {
+  if (F.isVarArg() || F.hasFnAttribute(llvm::Attribute::Naked))
+    return true;
+
+  for (llvm::Function::const_iterator BB = F.begin(), BE = F.end(); BB != BE;
+       ++BB) {
+    for (llvm::BasicBlock::const_iterator II = BB->begin(), IE = BB->end();
+         II != IE; ++II) {
+      const llvm::Instruction *I = &*II;
+      if (isa<llvm::InvokeInst>(I) || isa<llvm::LandingPadInst>(I) ||
+          isa<llvm::ResumeInst>(I) || isa<llvm::VAArgInst>(I) ||
+          isa<llvm::FenceInst>(I) || isa<llvm::AtomicCmpXchgInst>(I) ||
+          isa<llvm::AtomicRMWInst>(I))
+        return true;
+
+      // Indirect calls include inline asm and every message send.
+      const llvm::Value *Callee = 0;
+      llvm::ImmutableCallSite CS(I);
+      if (CS) {
+        if (!CS.getCalledFunction())
+          return true;
+        Callee = CS.getCalledValue();
+      }
+
+      for (llvm::User::const_op_iterator OI = I->op_begin(),
+             OE = I->op_end(); OI != OE; ++OI)
+        if (*OI != Callee && IsNativeOnly(*OI, NativeGlobals))
+          return true;
+    }
+  }
+  return false;
+}
+
+TieredExecutor::TieredExecutor(llvm::Module *M, unsigned Threshold,
+                               llvm::CodeGenOpt::Level OptLevel)
+  : M(M), NativeM(0), Threshold(Threshold), OptLevel(OptLevel),
+    MainSeconds(0) {}
+
+TieredExecutor::~TieredExecutor() {
+  // The interpreter holds mappings to native code; tear it down first.
+  Interp.reset();
+  Native.reset();
+}
+
+/// Give \p F an entry block that counts the call and, once \p F is hot (or
+/// always, if it is \p Pinned), calls \p Target instead of running the body.
+void TieredExecutor::instrument(llvm::Function *F, llvm::Function *Target,
+                                bool Pinned) {
+  llvm::LLVMContext &Context = F->getContext();
+  llvm::Module *Mod = F->getParent();
+  llvm::FunctionType *VoidFnTy =
+    llvm::FunctionType::get(llvm::Type::getVoidTy(Context), false);
+  llvm::Constant *EnterFn =
+    Mod->getOrInsertFunction("__clang_interpreter_tier_enter", VoidFnTy);
+  llvm::Constant *ExitFn =
+    Mod->getOrInsertFunction("__clang_interpreter_tier_exit", VoidFnTy);
+
+  FunctionInfo Info = { F, 0 };
+  if (Pinned) {
+    llvm::GlobalValue::LinkageTypes Linkage = F->getLinkage();
+    F->deleteBody();
+    F->setLinkage(Linkage);
+  }
+  llvm::BasicBlock *Body = F->empty() ? 0 : &F->front();
+  llvm::BasicBlock *Up = llvm::BasicBlock::Create(Context, "tier.up", F, Body);
+
+  if (!Pinned) {
+    llvm::Type *CounterTy = llvm::Type::getInt64Ty(Context);
+    Info.Calls =
+      new llvm::GlobalVariable(*Mod, CounterTy, false,
+                               llvm::GlobalValue::PrivateLinkage,
+                               llvm::ConstantInt::get(CounterTy, 0),
+                               ".tier.calls");
+    llvm::BasicBlock *Entry =
+      llvm::BasicBlock::Create(Context, "tier.entry", F, Up);
+    llvm::IRBuilder<> Builder(Entry);
+    llvm::Value *Calls = Builder.CreateAdd(Builder.CreateLoad(Info.Calls),
+                                           llvm::ConstantInt::get(CounterTy,
+                                                                  1));
+    Builder.CreateStore(Calls, Info.Calls);
+    Builder.CreateCondBr(
+      Builder.CreateICmpUGE(Calls, llvm::ConstantInt::get(CounterTy,
+                                                          Threshold)),
+      Up, Body);
+  }
+
+  llvm::IRBuilder<> Builder(Up);
+  SmallVector<llvm::Value*, 8> Args;
+  for (llvm::Function::arg_iterator AI = F->arg_begin(), AE = F->arg_end();
+       AI != AE; ++AI)
+    Args.push_back(AI);
+  Builder.CreateCall(EnterFn);
+  llvm::CallInst *Result = Builder.CreateCall(Target, Args);
+  Result->setCallingConv(F->getCallingConv());
+  Result->setAttributes(F->getAttributes());
+  Builder.CreateCall(ExitFn);
+  if (Result->getType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(Result);
+
+  Functions.push_back(Info);
+}
+
+bool TieredExecutor::initialize(std::string &Error) {
+  // Globals whose initializers hold function addresses (vtables, method
+  // tables, block descriptors) get separate native copies, as do globals
+  // pointing at those.
+  llvm::SmallPtrSet<const llvm::Value*, 16> NativeGlobals;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (llvm::Module::global_iterator GV = M->global_begin(),
+           GE = M->global_end(); GV != GE; ++GV)
+      if (!NativeGlobals.count(GV) && GV->hasInitializer() &&
+          IsNativeOnly(GV->getInitializer(), NativeGlobals))
+        Changed = NativeGlobals.insert(GV);
+  }
+
+  // Decide on a tier for every function before touching anything, so that a
+  // module we can't split is left as it was.
+  SmallVector<std::pair<llvm::Function*, bool>, 64> Defined;
+  for (llvm::Module::iterator F = M->begin(), FE = M->end(); F != FE; ++F) {
+    if (F->isDeclaration())
+      continue;
+    bool Pinned = MustRunNative(*F, NativeGlobals);
+    if (Pinned && !CanCallNatively(*F)) {
+      Error = "function '" + F->getName().str() +
+              "' can be neither interpreted nor called natively";
+      return false;
+    }
+    Defined.push_back(std::make_pair(&*F, Pinned));
+  }
+
+  // Create both engines before instrumenting M as well, so that it is still
+  // usable if either can't be created.  The interpreter allocates globals
+  // added later, such as the call counters, when they are first used.
+  llvm::ValueToValueMapTy VMap;
+  NativeM = llvm::CloneModule(M, VMap);
+  Native.reset(llvm::ExecutionEngine::createJIT(NativeM, &Error, 0,
+                                                OptLevel));
+  if (!Native) {
+    delete NativeM;
+    NativeM = 0;
+    return false;
+  }
+
+  Interp.reset(llvm::EngineBuilder(M)
+                 .setEngineKind(llvm::EngineKind::Interpreter)
+                 .setErrorStr(&Error)
+                 .create());
+  if (!Interp) {
+    // The JIT owns and deletes NativeM.
+    Native.reset();
+    NativeM = 0;
+    return false;
+  }
+
+  Native->DisableLazyCompilation(false);
+  Listener.reset(new CompileCounter());
+  Native->RegisterJITEventListener(Listener.get());
+
+  SmallVector<std::pair<llvm::Function*, llvm::Function*>, 64> Targets;
+  for (unsigned i = 0, e = Defined.size(); i != e; ++i) {
+    llvm::Function *F = Defined[i].first;
+    llvm::Function *NativeF = cast<llvm::Function>(VMap[F]);
+    // Functions the interpreter can't call into natively stay interpreted.
+    if (!CanCallNatively(*F))
+      continue;
+    llvm::Function *Target =
+      llvm::Function::Create(F->getFunctionType(),
+                             llvm::GlobalValue::ExternalLinkage,
+                             "__clang_interpreter_native." + llvm::utostr(i),
+                             M);
+    Target->setCallingConv(F->getCallingConv());
+    instrument(F, Target, Defined[i].second);
+    Targets.push_back(std::make_pair(Target, NativeF));
+  }
+
+  // Point the native copy at the interpreter's globals, except the ones that
+  // must stay native.
+  for (llvm::Module::global_iterator GV = M->global_begin(),
+         GE = M->global_end(); GV != GE; ++GV) {
+    llvm::ValueToValueMapTy::iterator NativeGV = VMap.find(GV);
+    if (NativeGV == VMap.end() || NativeGlobals.count(GV) ||
+        GV->isDeclaration())
+      continue;
+    Native->addGlobalMapping(cast<llvm::GlobalValue>(NativeGV->second),
+                             Interp->getPointerToGlobal(GV));
+  }
+
+  // Native code is compiled lazily, when the stub is first called.
+  for (unsigned i = 0, e = Targets.size(); i != e; ++i)
+    Interp->addGlobalMapping(Targets[i].first,
+                    Native->getPointerToFunctionOrStub(Targets[i].second));
+  if (llvm::Function *Enter = M->getFunction("__clang_interpreter_tier_enter"))
+    Interp->addGlobalMapping(Enter, (void*)(intptr_t)&TierNativeEnter);
+  if (llvm::Function *Exit = M->getFunction("__clang_interpreter_tier_exit"))
+    Interp->addGlobalMapping(Exit, (void*)(intptr_t)&TierNativeExit);
+  return true;
+}
+
+int TieredExecutor::runMain(const std::vector<std::string> &Args,
+                            char * const *envp) {
+  // Methods are registered with native IMPs, since the Objective-C runtime
+  // calls them directly.
+  std::vector<llvm::GenericValue> NoArgs;
+  if (llvm::Function *InitFn = NativeM->getFunction(".objc_jit_init"))
+    Native->runFunction(InitFn, NoArgs);
+
+  llvm::Function *EntryFn = M->getFunction("main");
+  if (!EntryFn) {
+    llvm::errs() << "'main' function not found in module.\n";
+    return 255;
+  }
+  double Start = GetWallTime();
+  int Res = Interp->runFunctionAsMain(EntryFn, Args, envp);
+  MainSeconds = GetWallTime() - Start;
+  return Res;
+}
+
+namespace {
+struct HotterFunction {
+  const llvm::DenseMap<const llvm::Function*, uint64_t> &Calls;
+  HotterFunction(const llvm::DenseMap<const llvm::Function*, uint64_t> &Calls)
+    : Calls(Calls) {}
+  bool operator()(const TieredExecutor::FunctionInfo &LHS,
+                  const TieredExecutor::FunctionInfo &RHS) const {
+    return Calls.lookup(LHS.Fn) > Calls.lookup(RHS.Fn);
+  }
+};
+}
+
+void TieredExecutor::printReport(raw_ostream &OS) {
+  llvm::DenseMap<const llvm::Function*, uint64_t> Calls;
+  unsigned NumInterpreted = 0, NumTieredUp = 0, NumNativeOnly = 0;
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    if (!Functions[i].Calls) {
+      ++NumNativeOnly;
+      continue;
+    }
+    uint64_t N = *static_cast<uint64_t*>(
+      Interp->getPointerToGlobal(Functions[i].Calls));
+    Calls[Functions[i].Fn] = N;
+    if (N >= Threshold)
+      ++NumTieredUp;
+    else if (N)
+      ++NumInterpreted;
+  }
+
+  OS << "===-- Tiered execution (threshold " << Threshold
+     << " calls) --===\n";
+  OS << "  main(): " << llvm::format("%.4f", MainSeconds) << "s, of which "
+     << llvm::format("%.4f", MainSeconds - Stats.NativeSeconds)
+     << "s interpreted and "
+     << llvm::format("%.4f", Stats.NativeSeconds)
+     << "s native (including JIT compilation)\n";
+  OS << "  functions compiled by the JIT: " << Stats.NumCompiled << "\n";
+  OS << "  functions interpreted only: " << NumInterpreted
+     << ", tiered up: " << NumTieredUp
+     << ", native only: " << NumNativeOnly << "\n";
+
+  SmallVector<FunctionInfo, 64> Hottest;
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    if (Functions[i].Calls && Calls.lookup(Functions[i].Fn))
+      Hottest.push_back(Functions[i]);
+  std::sort(Hottest.begin(), Hottest.end(), HotterFunction(Calls));
+  if (Hottest.size() > 10)
+    Hottest.resize(10);
+
+  if (!Hottest.empty())
+    OS << "  interpreted calls:\n";
+  for (unsigned i = 0, e = Hottest.size(); i != e; ++i) {
+    uint64_t N = Calls.lookup(Hottest[i].Fn);
+    OS << llvm::format("  %12llu  ", (unsigned long long)N)
+       << (N >= Threshold ? "tiered up  " : "interpreted")
+       << "  " << Hottest[i].Fn->getName() << "\n";
+  }
+}
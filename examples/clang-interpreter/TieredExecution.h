@@ -0,0 +1,99 @@
+//===-- examples/clang-interpreter/TieredExecution.h ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Runs a module in the LLVM IR interpreter, switching each function over to
+// JIT-compiled native code once it has been called often enough.  Short
+// scripts then only pay for native code generation of their hot functions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLANG_INTERPRETER_TIEREDEXECUTION_H
+#define CLANG_INTERPRETER_TIEREDEXECUTION_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CodeGen.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class ExecutionEngine;
+  class Function;
+  class GlobalVariable;
+  class JITEventListener;
+  class Module;
+}
+
+namespace clang {
+
+/// \brief Two-tier execution of a module.
+///
+/// The module is cloned: the original is run by the interpreter, the clone by
+/// the JIT with lazy compilation, and global variables are shared between the
+/// two.  Every function in the interpreted copy counts its calls and, from
+/// the threshold on, forwards to the native copy instead; native code never
+/// calls back into the interpreter.
+///
+/// Functions the interpreter cannot run faithfully start out native: those
+/// with indirect calls (including every Objective-C message send), exception
+/// handling or variable arguments, and those that take the address of a
+/// function, which would otherwise leak interpreter function handles into
+/// native code.  .objc_jit_init always runs native, so that methods are
+/// registered with native IMPs.
+///
+/// Interpreted calls to external functions, including the switch to native
+/// code, go through libffi, so this needs an LLVM built with it.
+class TieredExecutor {
+public:
+  struct FunctionInfo {
+    llvm::Function *Fn;
+    /// Interpreted calls so far, or null if the function is native only.
+    llvm::GlobalVariable *Calls;
+  };
+
+private:
+  llvm::Module *M;
+  llvm::Module *NativeM;
+  unsigned Threshold;
+  llvm::CodeGenOpt::Level OptLevel;
+  double MainSeconds;
+
+  OwningPtr<llvm::ExecutionEngine> Interp;
+  OwningPtr<llvm::ExecutionEngine> Native;
+  OwningPtr<llvm::JITEventListener> Listener;
+
+  SmallVector<FunctionInfo, 64> Functions;
+
+  void instrument(llvm::Function *F, llvm::Function *Target, bool Pinned);
+
+public:
+  /// Takes ownership of \p M once initialize() succeeds.
+  TieredExecutor(llvm::Module *M, unsigned Threshold,
+                 llvm::CodeGenOpt::Level OptLevel);
+  ~TieredExecutor();
+
+  /// Create both engines.  Returns false and sets \p Error on failure, in
+  /// particular when some function can neither be interpreted nor be called
+  /// natively from the interpreter (e.g. it returns a structure).  On
+  /// failure, M is left unchanged and still belongs to the caller.
+  bool initialize(std::string &Error);
+
+  /// Run .objc_jit_init natively, then main() in the interpreter.  Returns
+  /// main's result.
+  int runMain(const std::vector<std::string> &Args, char * const *envp);
+
+  /// Print the time spent in each tier and the call counts of the hottest
+  /// functions, to help pick a threshold.
+  void printReport(raw_ostream &OS);
+};
+
+} // end namespace clang
+
+#endif
@@ -7,7 +7,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "DiskObjectCache.h"
+#include "IncrementalInterpreter.h"
+#include "InterpreterServer.h"
+#include "JITMemory.h"
+#include "ParallelFrontend.h"
+#include "PreambleCache.h"
+#include "StartupReport.h"
+#include "TieredExecution.h"
+#include "clang/CodeGen/BackendUtil.h"
 #include "clang/CodeGen/CodeGenAction.h"
+#include "clang/CodeGen/ObjCJitRuntimeStats.h"
 #include "clang/Basic/DiagnosticOptions.h"
 #include "clang/Driver/Compilation.h"
 #include "clang/Driver/Driver.h"
@@ -20,8 +30,12 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/JIT.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -43,12 +57,227 @@ std::string GetExecutablePath(const char *Argv0) {
   return llvm::sys::fs::getMainExecutable(Argv0, MainAddr);
 }
 
-static int Execute(llvm::Module *Mod, char * const *envp) {
+/// Options that belong to the interpreter rather than to the compiler.  They
+/// are taken out of the command line before it is handed to the driver.
+struct InterpreterOptions {
+  /// -interp-repl: after loading the input file, read further declarations
+  /// and statements from stdin and run each one as it is entered.
+  bool Repl;
+
+  /// -interp-pch-cache=<dir>: precompile the #include and #import directives
+  /// at the top of the input file into a PCH kept in <dir>, and reuse it on
+  /// later runs while none of the headers have changed.
+  std::string PCHCacheDir;
+
+  /// -interp-object-cache=<dir>: compile with MCJIT and keep the object code
+  /// for each module in <dir>, so that running an unchanged script again
+  /// skips native code generation.
+  std::string ObjectCacheDir;
+
+  /// -interp-object-cache-size=<megabytes>: the size the object cache is
+  /// pruned to.
+  unsigned ObjectCacheSize;
+
+  /// -interp-tiered: run main() in the IR interpreter and compile functions
+  /// natively once they have been called -interp-tier-threshold=<n> times
+  /// (100 by default).  Prints the time spent in each tier at exit.
+  bool Tiered;
+  unsigned TierThreshold;
+
+  /// -interp-lazy: compile each function when it is first called, through a
+  /// stub, rather than compiling everything main() and .objc_jit_init can
+  /// reach before running them.
+  bool Lazy;
+
+  /// -interp-startup-report=<file>: write the time and memory spent in each
+  /// phase of startup, and the number of calls made into the Objective-C
+  /// runtime while generating code, to <file> ("-" for stderr) as JSON.
+  std::string StartupReportFile;
+
+  /// -interp-server=<socket>: stay resident and run the scripts sent to the
+  /// Unix domain socket <socket>, each in a child process.  Preambles are
+  /// cached in <socket>.pch-cache unless -interp-pch-cache= says otherwise.
+  std::string ServerSocket;
+
+  /// -interp-connect=<socket>: have the server at <socket> run the script,
+  /// with this process's standard streams, directory and environment.
+  std::string ConnectSocket;
+
+  /// -interp-jobs=<n>: compile the source files of a program split across
+  /// several files on up to <n> threads (one per processor by default).
+  unsigned FrontendThreads;
+
+  /// -interp-reclaim-ir: delete the IR of each function once the JIT has
+  /// compiled it.
+  bool ReclaimIR;
+
+  InterpreterOptions() : Repl(false), ObjectCacheSize(256), Tiered(false),
+                         TierThreshold(100), Lazy(false),
+                         FrontendThreads(0), ReclaimIR(false) {}
+};
+
+static void ParseInterpreterArgs(SmallVectorImpl<const char *> &Args,
+                                 InterpreterOptions &Opts) {
+  SmallVectorImpl<const char *>::iterator Out = Args.begin() + 1;
+  for (SmallVectorImpl<const char *>::iterator I = Args.begin() + 1,
+         E = Args.end(); I != E; ++I) {
+    StringRef Arg(*I);
+    if (Arg == "-interp-repl")
+      Opts.Repl = true;
+    else if (Arg.startswith("-interp-pch-cache="))
+      Opts.PCHCacheDir = Arg.substr(strlen("-interp-pch-cache="));
+    else if (Arg.startswith("-interp-object-cache="))
+      Opts.ObjectCacheDir = Arg.substr(strlen("-interp-object-cache="));
+    else if (Arg.startswith("-interp-object-cache-size="))
+      Arg.substr(strlen("-interp-object-cache-size="))
+        .getAsInteger(10, Opts.ObjectCacheSize);
+    else if (Arg == "-interp-lazy")
+      Opts.Lazy = true;
+    else if (Arg == "-interp-tiered")
+      Opts.Tiered = true;
+    else if (Arg.startswith("-interp-tier-threshold="))
+      Arg.substr(strlen("-interp-tier-threshold="))
+        .getAsInteger(10, Opts.TierThreshold);
+    else if (Arg.startswith("-interp-startup-report="))
+      Opts.StartupReportFile = Arg.substr(strlen("-interp-startup-report="));
+    else if (Arg == "-interp-reclaim-ir")
+      Opts.ReclaimIR = true;
+    else if (Arg.startswith("-interp-jobs="))
+      Arg.substr(strlen("-interp-jobs="))
+        .getAsInteger(10, Opts.FrontendThreads);
+    else if (Arg.startswith("-interp-server="))
+      Opts.ServerSocket = Arg.substr(strlen("-interp-server="));
+    else if (Arg.startswith("-interp-connect="))
+      Opts.ConnectSocket = Arg.substr(strlen("-interp-connect="));
+    else
+      *Out++ = *I;
+  }
+  Args.erase(Out, Args.end());
+}
+
+/// Read one input from stdin, continuing onto further lines while braces are
+/// left open.  Returns false at end of file.
+static bool ReadInput(std::string &Input) {
+  Input.clear();
+  int Depth = 0;
+  char Line[4096];
+  do {
+    fputs(Input.empty() ? "clang> " : "   ..> ", stdout);
+    fflush(stdout);
+    if (!fgets(Line, sizeof(Line), stdin))
+      return !Input.empty();
+    for (const char *C = Line; *C; ++C) {
+      if (*C == '{')
+        ++Depth;
+      else if (*C == '}')
+        --Depth;
+    }
+    Input += Line;
+  } while (Depth > 0);
+  return true;
+}
+
+static void PrintMemoryUsage(const IncrementalInterpreter &Interp) {
+  JITMemoryUsage Usage;
+  Interp.getMemoryUsage(Usage);
+  llvm::outs() << Usage.NumModules << " modules, IR ~" << Usage.IRBytes
+               << " bytes, machine code " << Usage.MachineCodeBytes
+               << " bytes, ObjC constant strings " << Usage.ObjCBytes
+               << " bytes, total " << Usage.getTotal() << " bytes\n";
+  llvm::outs().flush();
+}
+
+static int RunRepl(CompilerInstance &Clang, bool ReclaimIR) {
+  llvm::InitializeNativeTarget();
+
+  llvm::LLVMContext Context;
+  IncrementalInterpreter Interp(Clang, Context);
+  Interp.setReclaimIR(ReclaimIR);
+  if (!Interp.Initialize())
+    return 1;
+
+  std::string Input;
+  while (ReadInput(Input)) {
+    StringRef Trimmed = StringRef(Input).trim();
+    if (Trimmed.empty())
+      continue;
+    if (Trimmed == ".q" || Trimmed == ".quit")
+      break;
+    if (Trimmed == ".memory") {
+      PrintMemoryUsage(Interp);
+      continue;
+    }
+    if (Trimmed.startswith(".retire ")) {
+      unsigned N;
+      if (Trimmed.substr(strlen(".retire ")).trim().getAsInteger(10, N) ||
+          !Interp.RetireInput(N))
+        llvm::errs() << "no input to retire: " << Trimmed << "\n";
+      continue;
+    }
+    Interp.Process(Input);
+  }
+  return 0;
+}
+
+/// Objects unused for longer than this are dropped from the object cache.
+static const uint64_t ObjectCacheMaxAge = 30 * 24 * 60 * 60;
+
+static int Execute(llvm::Module *Mod, const InterpreterOptions &Opts,
+                   llvm::CodeGenOpt::Level OptLevel, StartupReport *Report,
+                   char * const *envp) {
   llvm::InitializeNativeTarget();
 
   std::string Error;
-  OwningPtr<llvm::ExecutionEngine> EE(
-    llvm::ExecutionEngine::createJIT(Mod, &Error));
+  if (Opts.Tiered) {
+    TieredExecutor Tiered(Mod, Opts.TierThreshold, OptLevel);
+    if (Tiered.initialize(Error)) {
+      // FIXME: Support passing arguments.
+      std::vector<std::string> Args;
+      Args.push_back(Mod->getModuleIdentifier());
+
+      printf("Running main() (tiered)...\n");
+      StartupReport::Region R(Report, StartupReport::Main);
+      int Res = Tiered.runMain(Args, envp);
+      Tiered.printReport(llvm::errs());
+      return Res;
+    }
+    llvm::errs() << "tiered execution unavailable, using the JIT: " << Error
+                 << "\n";
+    Error.clear();
+  }
+
+  // The cache must outlive the engine that uses it.
+  OwningPtr<DiskObjectCache> ObjCache;
+  OwningPtr<JITMemoryTracker> Tracker;
+  OwningPtr<llvm::ExecutionEngine> EE;
+  llvm::SectionMemoryManager *MemMgr = 0;
+  if (Opts.ObjectCacheDir.empty()) {
+    EE.reset(llvm::ExecutionEngine::createJIT(Mod, &Error, 0, OptLevel));
+    // Functions referenced only from the method table, or from code that
+    // never runs, are then never compiled at all.
+    if (EE && Opts.Lazy)
+      EE->DisableLazyCompilation(false);
+    if (EE && Opts.ReclaimIR) {
+      Tracker.reset(new JITMemoryTracker());
+      EE->RegisterJITEventListener(Tracker.get());
+    }
+  } else {
+    // Only MCJIT produces object files that can be cached.
+    llvm::InitializeNativeTargetAsmPrinter();
+    ObjCache.reset(new DiskObjectCache(Opts.ObjectCacheDir,
+                                       Mod->getTargetTriple(), OptLevel,
+                                       uint64_t(Opts.ObjectCacheSize) << 20,
+                                       ObjectCacheMaxAge));
+    MemMgr = new llvm::SectionMemoryManager();
+    EE.reset(llvm::EngineBuilder(Mod)
+               .setErrorStr(&Error)
+               .setUseMCJIT(true)
+               .setOptLevel(OptLevel)
+               .setMCJITMemoryManager(MemMgr)
+               .create());
+    if (EE)
+      EE->setObjectCache(ObjCache.get());
+  }
   if (!EE) {
     llvm::errs() << "unable to make execution engine: " << Error << "\n";
     return 255;
@@ -67,47 +296,173 @@ static int Execute(llvm::Module *Mod, char * const *envp) {
     return 255;
   }
 
+  if (MemMgr) {
+    // As lli does: compile (or load) the module before running anything, so
+    // the instruction cache can be cleared over all of it.
+    StartupReport::Region R(Report, StartupReport::JITCodeGen);
+    (void)EE->getPointerToFunction(EntryFn);
+    MemMgr->invalidateInstructionCache();
+  } else if (Report || Tracker) {
+    // Compile up front, rather than on the first call, so that code
+    // generation is not charged to running the code and the IR can go before
+    // main() starts.  With -interp-lazy this only covers the two entry
+    // points.
+    StartupReport::Region R(Report, StartupReport::JITCodeGen);
+    (void)EE->getPointerToFunction(InitFn);
+    (void)EE->getPointerToFunction(EntryFn);
+  }
+  if (Tracker)
+    Tracker->reclaimIR();
+
   // TODO: look into getting rid of this by tying the function block to main()
   printf("Running .objc_jit_init()...\n");
   std::vector<llvm::GenericValue> noargs;
-  EE->runFunction(InitFn, noargs);
+  {
+    StartupReport::Region R(Report, StartupReport::ObjCJitInit);
+    EE->runFunction(InitFn, noargs);
+  }
 
   // FIXME: Support passing arguments.
   std::vector<std::string> Args;
   Args.push_back(Mod->getModuleIdentifier());
 
   printf("Running main()...\n");
+  StartupReport::Region R(Report, StartupReport::Main);
   return EE->runFunctionAsMain(EntryFn, Args, envp);
 }
 
-int main(int argc, const char **argv, char * const *envp) {
-  void *MainAddr = (void*) (intptr_t) GetExecutablePath;
-  std::string Path = GetExecutablePath(argv[0]);
-  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
-  TextDiagnosticPrinter *DiagClient =
-    new TextDiagnosticPrinter(llvm::errs(), &*DiagOpts);
+/// Honor -mllvm.  The options are the same for every file of a program and
+/// go to the LLVM option parser once, before anything is compiled.
+static void ParseLLVMArgs(const CompilerInvocation &CI) {
+  const std::vector<std::string> &LLVMArgs = CI.getFrontendOpts().LLVMArgs;
+  if (LLVMArgs.empty())
+    return;
+  SmallVector<const char *, 16> Args;
+  Args.push_back("clang-interpreter (LLVM option parsing)");
+  for (unsigned i = 0, e = LLVMArgs.size(); i != e; ++i)
+    Args.push_back(LLVMArgs[i].c_str());
+  Args.push_back(0);
+  llvm::cl::ParseCommandLineOptions(Args.size() - 1, Args.data());
+}
 
-  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
-  DiagnosticsEngine Diags(DiagID, &*DiagOpts, DiagClient);
-  Driver TheDriver(Path, llvm::sys::getProcessTriple(), "a.out", Diags);
-  TheDriver.setTitle("clang interpreter");
+static void WriteStartupReport(StartupReport &Report, StringRef File) {
+  if (File == "-") {
+    Report.print(llvm::errs());
+    return;
+  }
+  std::string Error;
+  llvm::raw_fd_ostream OS(File.str().c_str(), Error);
+  if (Error.empty())
+    Report.print(OS);
+  else
+    llvm::errs() << "unable to write startup report: " << Error << "\n";
+}
+
+/// Compile the several source files of \p C on parallel threads, link them
+/// and run the result.
+static int RunProgram(Compilation &C, DiagnosticsEngine &Diags,
+                      const InterpreterOptions &InterpOpts,
+                      const std::string &ResourceDir, StartupReport *Report,
+                      char * const *envp) {
+  if (InterpOpts.Repl) {
+    llvm::errs() << "-interp-repl takes a single source file\n";
+    return 1;
+  }
+
+  SmallVector<CompilerInvocation *, 16> Invocations;
+  {
+    StartupReport::Region R(Report, StartupReport::Invocation);
+    const driver::JobList &Jobs = C.getJobs();
+    for (driver::JobList::const_iterator I = Jobs.begin(), E = Jobs.end();
+         I != E; ++I) {
+      const driver::ArgStringList &CCArgs =
+        cast<driver::Command>(*I)->getArguments();
+      CompilerInvocation *CI = new CompilerInvocation;
+      CompilerInvocation::CreateFromArgs(
+        *CI, const_cast<const char **>(CCArgs.data()),
+        const_cast<const char **>(CCArgs.data()) + CCArgs.size(), Diags);
+      if (CI->getHeaderSearchOpts().UseBuiltinIncludes &&
+          CI->getHeaderSearchOpts().ResourceDir.empty())
+        CI->getHeaderSearchOpts().ResourceDir = ResourceDir;
+      Invocations.push_back(CI);
+    }
+  }
+  ParseLLVMArgs(*Invocations[0]);
+
+  // Show the invocations, with -v.
+  if (Invocations[0]->getHeaderSearchOpts().Verbose) {
+    llvm::errs() << "clang invocations:\n";
+    C.PrintJob(llvm::errs(), C.getJobs(), "\n", true);
+    llvm::errs() << "\n";
+  }
+
+  // Files that share a preamble share its PCH; build each one once, before
+  // the threads would all build it at the same time.
+  if (!InterpOpts.PCHCacheDir.empty())
+    for (unsigned i = 0, e = Invocations.size(); i != e; ++i)
+      UseCachedPreamble(*Invocations[i], InterpOpts.PCHCacheDir);
+
+  // The invocations go to the threads; keep what is needed afterwards.
+  llvm::CodeGenOpt::Level OptLevel =
+    getCodeGenOptLevel(Invocations[0]->getCodeGenOpts());
+  unsigned NumThreads = InterpOpts.FrontendThreads ?
+    InterpOpts.FrontendThreads : getDefaultFrontendThreads();
+
+  llvm::InitializeNativeTarget();
+
+  // The execution engine takes the module; the context must outlive both.
+  llvm::LLVMContext Context;
+  llvm::Module *Module;
+  {
+    StartupReport::Region R(Report, StartupReport::FrontendInit);
+    Module = CompileAndLink(Invocations, NumThreads, Context, llvm::errs());
+  }
+  if (!Module)
+    return 1;
 
+  int Res = Execute(Module, InterpOpts, OptLevel, Report, envp);
+  if (Report)
+    WriteStartupReport(*Report, InterpOpts.StartupReportFile);
+  // The engine, and with it all code that uses them, is gone.
+  clearObjCJitConstantStrings();
+  return Res;
+}
+
+/// Compile and run the script on the command line \p Args, with the
+/// interpreter's own options already taken out into \p InterpOpts.
+static int RunScript(Driver &TheDriver, DiagnosticsEngine &Diags,
+                     SmallVectorImpl<const char *> &Args,
+                     const InterpreterOptions &InterpOpts,
+                     const std::string &ResourceDir, char * const *envp) {
   // FIXME: This is a hack to try to force the driver to do something we can
   // recognize. We need to extend the driver library to support this use model
   // (basically, exactly one input, and the operation mode is hard wired).
-  SmallVector<const char *, 16> Args(argv, argv + argc);
   Args.push_back("-fsyntax-only");
   Args.push_back("-fobjc-runtime=host");
-  OwningPtr<Compilation> C(TheDriver.BuildCompilation(Args));
+
+  OwningPtr<StartupReport> Report;
+  if (!InterpOpts.StartupReportFile.empty())
+    Report.reset(new StartupReport());
+
+  OwningPtr<Compilation> C;
+  {
+    StartupReport::Region R(Report.get(), StartupReport::Driver);
+    C.reset(TheDriver.BuildCompilation(Args));
+  }
   if (!C)
     return 0;
 
   // FIXME: This is copied from ASTUnit.cpp; simplify and eliminate.
 
-  // We expect to get back exactly one command job, if we didn't something
-  // failed. Extract that job from the compilation.
+  // We expect to get back one command job per input, if we didn't something
+  // failed. Extract the jobs from the compilation.
   const driver::JobList &Jobs = C->getJobs();
-  if (Jobs.size() != 1 || !isa<driver::Command>(*Jobs.begin())) {
+  bool OnlyCommands = Jobs.size() != 0;
+  for (driver::JobList::const_iterator I = Jobs.begin(), E = Jobs.end();
+       I != E; ++I)
+    if (!isa<driver::Command>(*I))
+      OnlyCommands = false;
+  if (!OnlyCommands) {
     SmallString<256> Msg;
     llvm::raw_svector_ostream OS(Msg);
     C->PrintJob(OS, C->getJobs(), "; ", true);
@@ -115,20 +470,30 @@ int main(int argc, const char **argv, char * const *envp) {
     return 1;
   }
 
-  const driver::Command *Cmd = cast<driver::Command>(*Jobs.begin());
-  if (llvm::StringRef(Cmd->getCreator().getName()) != "clang") {
-    Diags.Report(diag::err_fe_expected_clang_command);
-    return 1;
+  for (driver::JobList::const_iterator I = Jobs.begin(), E = Jobs.end();
+       I != E; ++I) {
+    if (StringRef(cast<driver::Command>(*I)->getCreator().getName()) !=
+          "clang") {
+      Diags.Report(diag::err_fe_expected_clang_command);
+      return 1;
+    }
   }
 
+  if (Jobs.size() > 1)
+    return RunProgram(*C, Diags, InterpOpts, ResourceDir, Report.get(), envp);
+
+  const driver::Command *Cmd = cast<driver::Command>(*Jobs.begin());
+
   // Initialize a compiler invocation object from the clang (-cc1) arguments.
   const driver::ArgStringList &CCArgs = Cmd->getArguments();
   OwningPtr<CompilerInvocation> CI(new CompilerInvocation);
-  CompilerInvocation::CreateFromArgs(*CI,
-                                     const_cast<const char **>(CCArgs.data()),
-                                     const_cast<const char **>(CCArgs.data()) +
-                                       CCArgs.size(),
-                                     Diags);
+  {
+    StartupReport::Region R(Report.get(), StartupReport::Invocation);
+    CompilerInvocation::CreateFromArgs(
+      *CI, const_cast<const char **>(CCArgs.data()),
+      const_cast<const char **>(CCArgs.data()) + CCArgs.size(), Diags);
+  }
+  ParseLLVMArgs(*CI);
 
   // Show the invocation, with -v.
   if (CI->getHeaderSearchOpts().Verbose) {
@@ -151,17 +516,109 @@ int main(int argc, const char **argv, char * const *envp) {
   // Infer the builtin include path if unspecified.
   if (Clang.getHeaderSearchOpts().UseBuiltinIncludes &&
       Clang.getHeaderSearchOpts().ResourceDir.empty())
-    Clang.getHeaderSearchOpts().ResourceDir =
-      CompilerInvocation::GetResourcesPath(argv[0], MainAddr);
+    Clang.getHeaderSearchOpts().ResourceDir = ResourceDir;
+
+  if (!InterpOpts.PCHCacheDir.empty())
+    UseCachedPreamble(Clang.getInvocation(), InterpOpts.PCHCacheDir);
+
+  if (InterpOpts.Repl)
+    return RunRepl(Clang, InterpOpts.ReclaimIR);
+
+  // Register the native target first, so that the optimization passes run
+  // by the action get the target's analyses.
+  llvm::InitializeNativeTarget();
 
   // Create and execute the frontend to generate an LLVM bitcode module.
-  OwningPtr<CodeGenAction> Act(new EmitLLVMOnlyAction());
-  if (!Clang.ExecuteAction(*Act))
+  OwningPtr<CodeGenAction> Act;
+  if (Report)
+    Act.reset(new TimedEmitLLVMOnlyAction(*Report));
+  else
+    Act.reset(new EmitLLVMOnlyAction());
+  bool Success;
+  {
+    StartupReport::Region R(Report.get(), StartupReport::FrontendInit);
+    Success = Clang.ExecuteAction(*Act);
+  }
+  if (!Success)
     return 1;
 
   int Res = 255;
   if (llvm::Module *Module = Act->takeModule())
-    Res = Execute(Module, envp);
+    Res = Execute(Module, InterpOpts,
+                  getCodeGenOptLevel(Clang.getCodeGenOpts()), Report.get(),
+                  envp);
+
+  if (Report)
+    WriteStartupReport(*Report, InterpOpts.StartupReportFile);
+  // The engine, and with it all code that uses them, is gone.
+  clearObjCJitConstantStrings();
+  return Res;
+}
+
+namespace {
+/// Runs the scripts sent to -interp-server, in children forked from it.
+class ServerScriptRunner : public ScriptRunner {
+  Driver &TheDriver;
+  DiagnosticsEngine &Diags;
+  const InterpreterOptions &ServerOpts;
+  const std::string &ResourceDir;
+
+public:
+  ServerScriptRunner(Driver &TheDriver, DiagnosticsEngine &Diags,
+                     const InterpreterOptions &ServerOpts,
+                     const std::string &ResourceDir)
+    : TheDriver(TheDriver), Diags(Diags), ServerOpts(ServerOpts),
+      ResourceDir(ResourceDir) {}
+
+  virtual int run(SmallVectorImpl<const char *> &Args, char * const *envp) {
+    // The server's options are the defaults for each script.
+    InterpreterOptions Opts = ServerOpts;
+    ParseInterpreterArgs(Args, Opts);
+    Opts.ServerSocket.clear();
+    Opts.ConnectSocket.clear();
+    return RunScript(TheDriver, Diags, Args, Opts, ResourceDir, envp);
+  }
+};
+}
+
+int main(int argc, const char **argv, char * const *envp) {
+  SmallVector<const char *, 16> Args(argv, argv + argc);
+  InterpreterOptions InterpOpts;
+  ParseInterpreterArgs(Args, InterpOpts);
+
+  // Hand everything to the server before doing any work here.  It is sent the
+  // whole command line, and ignores the -interp-connect= in it.
+  if (!InterpOpts.ConnectSocket.empty())
+    return RunInterpreterClient(InterpOpts.ConnectSocket,
+                                ArrayRef<const char *>(argv, argc), envp);
+
+  void *MainAddr = (void*) (intptr_t) GetExecutablePath;
+  std::string Path = GetExecutablePath(argv[0]);
+  IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
+  TextDiagnosticPrinter *DiagClient =
+    new TextDiagnosticPrinter(llvm::errs(), &*DiagOpts);
+
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+  DiagnosticsEngine Diags(DiagID, &*DiagOpts, DiagClient);
+  Driver TheDriver(Path, llvm::sys::getProcessTriple(), "a.out", Diags);
+  TheDriver.setTitle("clang interpreter");
+
+  std::string ResourceDir =
+    CompilerInvocation::GetResourcesPath(argv[0], MainAddr);
+
+  if (!InterpOpts.ServerSocket.empty()) {
+    // Everything a script would otherwise set up for itself is done once
+    // here and inherited by each child.  Preambles are cached so that each
+    // set of headers is only parsed once.
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    if (InterpOpts.PCHCacheDir.empty())
+      InterpOpts.PCHCacheDir = InterpOpts.ServerSocket + ".pch-cache";
+    ServerScriptRunner Runner(TheDriver, Diags, InterpOpts, ResourceDir);
+    return RunInterpreterServer(InterpOpts.ServerSocket, Runner);
+  }
+
+  int Res = RunScript(TheDriver, Diags, Args, InterpOpts, ResourceDir, envp);
 
   // Shutdown.
 
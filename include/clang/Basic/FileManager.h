@@ -261,6 +261,10 @@ public:
   void GetUniqueIDMapping(
                     SmallVectorImpl<const FileEntry *> &UIDToFiles) const;
 
+  /// \brief Retrieve the files created by getVirtualFile(), which need not
+  /// exist on disk.
+  void GetVirtualFiles(SmallVectorImpl<const FileEntry *> &Files) const;
+
   /// \brief Modifies the size and modification time of a previously created
   /// FileEntry. Use with caution.
   static void modifyFileEntry(FileEntry *File, off_t Size,
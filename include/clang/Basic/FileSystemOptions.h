@@ -25,6 +25,16 @@ public:
   /// \brief If set, paths are resolved as if the working directory was
   /// set to the value of WorkingDir.
   std::string WorkingDir;
+
+  /// \brief If set, the file of a PersistentStatCache to consult before
+  /// stat()'ing paths, and to add their stat() results to.
+  std::string StatCachePath;
+
+  /// \brief The generation of the stat cache entries to trust, or 0 to
+  /// validate them against the file system.
+  unsigned StatCacheGeneration;
+
+  FileSystemOptions() : StatCacheGeneration(0) {}
 };
 
 } // end namespace clang
@@ -0,0 +1,140 @@
+//===--- PersistentStatCache.h - 'stat' results kept on disk ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Defines the PersistentStatCache interface.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_BASIC_PERSISTENTSTATCACHE_H
+#define LLVM_CLANG_BASIC_PERSISTENTSTATCACHE_H
+
+#include "clang/Basic/FileSystemStatCache.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include <string>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace clang {
+
+/// \brief A stat cache kept in a file, so that it outlives the compile that
+/// filled it and is shared by all the compiles that use the same file.
+///
+/// The file holds an on-disk hash table from absolute paths to the result
+/// of stat()'ing them, including the paths that do not exist.  Every compile
+/// memory maps it read-only and, once it is done, writes a new one through
+/// a rename if it learned results the file could answer later on; a compile
+/// that learned nothing leaves the file alone.
+///
+/// How far the entries are trusted depends on the generation the cache is
+/// used with:
+///
+///  - With generation 0, a path that did not exist is known to still be
+///    missing for as long as the modification time of its deepest existing
+///    ancestor directory has not changed, since creating anything below the
+///    directory changes it.  Each such directory is stat()'ed once per
+///    process, rather than every path below it.  Paths that exist are not
+///    kept, since they are stat()'ed again anyway: their contents may have
+///    changed.
+///
+///  - With any other generation, every entry written with the same
+///    generation is trusted without a stat().  Build systems bump the
+///    generation whenever the files the compiles look at may have changed;
+///    an entry from another generation is never used.
+class PersistentStatCache : public FileSystemStatCache {
+public:
+  /// \brief The stat() result for one path, as kept in the cache file.
+  struct Entry {
+    /// \brief Whether the path exists, in which case \c Data is valid.
+    bool Exists;
+
+    FileData Data;
+
+    /// \brief For a path that does not exist, the length of the path of its
+    /// deepest existing ancestor directory, and that directory's
+    /// modification time.
+    unsigned AncestorLength;
+    time_t AncestorModTime;
+
+    Entry() : Exists(false), AncestorLength(0), AncestorModTime(0) {}
+  };
+
+private:
+  PersistentStatCache(StringRef Path, unsigned Generation);
+
+  /// \brief The path of the cache file.
+  std::string Path;
+
+  unsigned Generation;
+
+  /// \brief The working directory relative paths are resolved against.
+  SmallString<128> WorkingDir;
+
+  /// \brief The time this cache was created, in seconds since the epoch.
+  time_t Now;
+
+  /// \brief The cache file, if it could be read and is of the same
+  /// generation.
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+
+  /// \brief The hash table in \c Buffer, if any.
+  void *Table;
+
+  /// \brief The stat() results not answered from the cache file that are
+  /// worth keeping, by absolute path.
+  llvm::StringMap<Entry, llvm::BumpPtrAllocator> NewEntries;
+
+  /// \brief The modification time of each directory looked at to validate
+  /// or to record a missing path, or -1 if it is not a directory.
+  llvm::StringMap<time_t, llvm::BumpPtrAllocator> DirModTimes;
+
+  unsigned NumHits, NumMisses, NumDirStats;
+
+  /// \brief Retrieve the modification time of the directory \p Dir, or -1
+  /// if it is not a directory, stat()'ing it at most once.
+  time_t getDirModTime(StringRef Dir);
+
+  /// \brief Whether the cached \p E, for the absolute path \p Path, can be
+  /// used without a stat().
+  bool isValid(StringRef Path, const Entry &E);
+
+  /// \brief Record the result of stat()'ing the absolute path \p Path.
+  void record(StringRef Path, LookupResult Result, const FileData &Data);
+
+public:
+  /// \brief Create a stat cache backed by the file \p Path, which need not
+  /// exist yet.
+  ///
+  /// \param Generation The generation of the entries to use, or 0 to
+  /// validate them against the file system instead.
+  static PersistentStatCache *Create(StringRef Path, unsigned Generation);
+
+  ~PersistentStatCache();
+
+  virtual LookupResult getStat(const char *Path, FileData &Data, bool isFile,
+                               int *FileDescriptor);
+
+  /// \brief Write the cache file again, with the stat() results it did not
+  /// have added, if there are any worth keeping.  The entries other compiles
+  /// wrote to the file meanwhile are kept.
+  ///
+  /// \returns true if an error occurred.  The cache is only an
+  /// optimization, so callers are free to ignore it.
+  bool save();
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -113,15 +113,22 @@ namespace SrcMgr {
 
     /// \brief A bump pointer allocated array of offsets for each source line.
     ///
-    /// This is lazily computed.  This is owned by the SourceManager
+    /// This is lazily computed, and may only cover the start of the buffer
+    /// unless LineTableComplete is set.  This is owned by the SourceManager
     /// BumpPointerAllocator object.
     unsigned *SourceLineCache;
 
-    /// \brief The number of lines in this ContentCache.
+    /// \brief The number of lines in SourceLineCache.
     ///
     /// This is only valid if SourceLineCache is non-null.
     unsigned NumLines : 31;
 
+    /// \brief True if SourceLineCache holds every line of the buffer.
+    unsigned LineTableComplete : 1;
+
+    /// \brief The number of entries allocated for SourceLineCache.
+    unsigned LineTableCapacity;
+
     /// \brief Indicates whether the buffer itself was provided to override
     /// the actual file contents.
     ///
@@ -135,13 +142,13 @@ namespace SrcMgr {
     
     ContentCache(const FileEntry *Ent = 0)
       : Buffer(0, false), OrigEntry(Ent), ContentsEntry(Ent),
-        SourceLineCache(0), NumLines(0), BufferOverridden(false),
-        IsSystemFile(false) {}
+        SourceLineCache(0), NumLines(0), LineTableComplete(false),
+        LineTableCapacity(0), BufferOverridden(false), IsSystemFile(false) {}
     
     ContentCache(const FileEntry *Ent, const FileEntry *contentEnt)
       : Buffer(0, false), OrigEntry(Ent), ContentsEntry(contentEnt),
-        SourceLineCache(0), NumLines(0), BufferOverridden(false),
-        IsSystemFile(false) {}
+        SourceLineCache(0), NumLines(0), LineTableComplete(false),
+        LineTableCapacity(0), BufferOverridden(false), IsSystemFile(false) {}
     
     ~ContentCache();
     
@@ -149,8 +156,8 @@ namespace SrcMgr {
     /// a non-NULL Buffer or SourceLineCache.  Ownership of allocated memory
     /// is not transferred, so this is a logical error.
     ContentCache(const ContentCache &RHS)
-      : Buffer(0, false), SourceLineCache(0), BufferOverridden(false),
-        IsSystemFile(false)
+      : Buffer(0, false), SourceLineCache(0), LineTableComplete(false),
+        LineTableCapacity(0), BufferOverridden(false), IsSystemFile(false)
     {
       OrigEntry = RHS.OrigEntry;
       ContentsEntry = RHS.ContentsEntry;
@@ -559,6 +566,10 @@ class SourceManager : public RefCountedBase<SourceManager> {
   /// (likely to change while trying to use them). Defaults to false.
   bool UserFilesAreVolatile;
 
+  /// \brief True if line tables are only computed as far into each buffer as
+  /// line numbers have been asked for. Defaults to true.
+  bool IncrementalLineTables;
+
   struct OverriddenFilesInfoTy {
     /// \brief Files that have been overriden with the contents from another
     /// file.
@@ -713,6 +724,11 @@ public:
   /// (likely to change while trying to use them).
   bool userFilesAreVolatile() const { return UserFilesAreVolatile; }
 
+  /// \brief Set false to compute the line table of a buffer in one go, the
+  /// first time a line number in it is asked for, rather than a chunk at a
+  /// time, only as far as the lines asked for.  Defaults to true.
+  void setIncrementalLineTables(bool value) { IncrementalLineTables = value; }
+
   /// \brief Retrieve the module build stack.
   ModuleBuildStack getModuleBuildStack() const {
     return StoredModuleBuildStack;
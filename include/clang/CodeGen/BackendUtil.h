@@ -11,6 +11,7 @@
 #define LLVM_CLANG_CODEGEN_BACKEND_UTIL_H
 
 #include "clang/Basic/LLVM.h"
+#include "llvm/Support/CodeGen.h"
 
 namespace llvm {
   class Module;
@@ -35,6 +36,10 @@ namespace clang {
                          const TargetOptions &TOpts, const LangOptions &LOpts,
                          llvm::Module *M,
                          BackendAction Action, raw_ostream *OS);
+
+  /// \brief The code generator optimization level for \p CGOpts, for clients
+  /// that generate native code themselves, such as a JIT.
+  llvm::CodeGenOpt::Level getCodeGenOptLevel(const CodeGenOptions &CGOpts);
 }
 
 #endif
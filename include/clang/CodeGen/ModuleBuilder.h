@@ -33,6 +33,14 @@ namespace clang {
   public:
     virtual llvm::Module* GetModule() = 0;
     virtual llvm::Module* ReleaseModule() = 0;
+
+    /// StartModule - Begin emitting into a new, empty module, once the
+    /// previous one has been finished with HandleTranslationUnit and taken
+    /// with ReleaseModule.  Declarations emitted into earlier modules are
+    /// only referenced from the new one.  This lets a client that feeds
+    /// top-level declarations incrementally compile each batch on its own.
+    virtual llvm::Module* StartModule(const std::string &ModuleName,
+                                      llvm::LLVMContext &C) = 0;
   };
 
   /// CreateLLVMCodeGen - Create a CodeGenerator instance.
@@ -0,0 +1,66 @@
+//===--- ObjCJitRuntimeStats.h - Host ObjC runtime state --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_CODEGEN_OBJCJITRUNTIMESTATS_H
+#define LLVM_CLANG_CODEGEN_OBJCJITRUNTIMESTATS_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include <utility>
+
+namespace llvm {
+class Module;
+}
+
+namespace clang {
+
+/// \brief Get the number of calls made into the Objective-C runtime of the
+/// host process while generating code for -fobjc-runtime=host, for each
+/// runtime function, since the process started.
+void getObjCJitRuntimeCallCounts(
+    SmallVectorImpl<std::pair<StringRef, unsigned> > &Counts);
+
+/// \brief Statistics of the pool of constant NSStrings that -fobjc-runtime=host
+/// creates for string literals.
+struct ObjCJitStringPoolStats {
+  /// Distinct literals currently in the pool.
+  unsigned NumStrings;
+  /// String literals code was generated for, and how many of them were
+  /// already in the pool.
+  uint64_t Lookups;
+  uint64_t Hits;
+  /// Bytes of literal contents held by the pooled strings.
+  uint64_t BytesRetained;
+
+  ObjCJitStringPoolStats()
+    : NumStrings(0), Lookups(0), Hits(0), BytesRetained(0) {}
+};
+
+void getObjCJitStringPoolStats(ObjCJitStringPoolStats &Stats);
+
+/// \brief Release the pooled constant strings that code was generated for
+/// in \p M and that no other module still uses.
+///
+/// This may only be called once no code from \p M will run again, e.g.
+/// after it has been removed from the execution engine, or when it was
+/// discarded without running.
+void releaseObjCJitConstantStrings(const llvm::Module *M);
+
+/// \brief Release every pooled constant string.
+///
+/// The strings are shared by all modules generated in the process, so this
+/// may only be called once no code from any of them will run again, e.g.
+/// after the execution engine has been destroyed.
+void clearObjCJitConstantStrings();
+
+} // end namespace clang
+
+#endif
@@ -172,6 +172,12 @@ public:
   /// \param J - The job to print.
   void PrintDiagnosticJob(raw_ostream &OS, const Job &J) const;
 
+  /// LogCommand - Print a command to \p OS if -v was given, or to the
+  /// CC_PRINT_OPTIONS file if one was set.
+  ///
+  /// \return False if the log file could not be opened.
+  bool LogCommand(const Command &C, raw_ostream &OS) const;
+
   /// ExecuteCommand - Execute an actual command.
   ///
   /// \param FailingCommand - For non-zero results, this will be set to the
@@ -186,6 +192,19 @@ public:
   void ExecuteJob(const Job &J,
      SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands) const;
 
+  /// ExecuteJobsInParallel - Execute the commands of a job list, running up
+  /// to \p NumJobs of them at once.
+  ///
+  /// A command starts once the commands producing its inputs have succeeded,
+  /// and is skipped if one of them failed, as with ExecuteJob.  The output of
+  /// each command, and any diagnostics about running it, are printed when it
+  /// is done, in the order ExecuteJob would have run the commands.
+  ///
+  /// \param FailingCommands - For non-zero results, this will be a vector of
+  /// failing commands and their associated result code, in job order.
+  void ExecuteJobsInParallel(const JobList &Jobs, unsigned NumJobs,
+     SmallVectorImpl< std::pair<int, const Command *> > &FailingCommands) const;
+
   /// initCompilationForDiagnostics - Remove stale state and suppress output
   /// so compilation can be reexecuted to generate additional diagnostic
   /// information (e.g., preprocessed source(s)).
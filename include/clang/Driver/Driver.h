@@ -119,6 +119,16 @@ public:
   /// The file to log CC_LOG_DIAGNOSTICS output to, if enabled.
   const char *CCLogDiagnosticsFilename;
 
+  /// The signature of the -cc1 entry point, given the arguments following
+  /// the program name and the path of the program.
+  typedef int (*CC1MainFn)(const char **ArgBegin, const char **ArgEnd,
+                           const char *Argv0);
+
+  /// The -cc1 entry point of the driver executable, if it has one.  When set
+  /// and -fintegrated-cc1 is given, -cc1 jobs are run by calling it in the
+  /// driver's process rather than by executing a new compiler process.
+  CC1MainFn CC1Main;
+
   /// A list of inputs and their types for the given arguments.
   typedef SmallVector<std::pair<types::ID, const llvm::opt::Arg *>, 16>
       InputList;
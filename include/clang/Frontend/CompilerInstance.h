@@ -39,6 +39,7 @@ class DiagnosticConsumer;
 class ExternalASTSource;
 class FileEntry;
 class FileManager;
+class PersistentStatCache;
 class FrontendAction;
 class Module;
 class Preprocessor;
@@ -77,6 +78,10 @@ class CompilerInstance : public ModuleLoader {
   /// The file manager.
   IntrusiveRefCntPtr<FileManager> FileMgr;
 
+  /// \brief Non-owning reference to the persistent stat cache of the file
+  /// manager, if it has one.
+  PersistentStatCache *StatCache;
+
   /// The source manager.
   IntrusiveRefCntPtr<SourceManager> SourceMgr;
 
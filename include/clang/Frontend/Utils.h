@@ -101,6 +101,10 @@ void AttachHeaderIncludeGen(Preprocessor &PP, bool ShowAllHeaders = false,
 /// a seekable stream.
 void CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS);
 
+/// CacheHeaderTokens - Write the tokens of the system headers that the header
+/// token cache of \p PP, if it has one, was missing to the cache.
+void CacheHeaderTokens(Preprocessor &PP);
+
 /// createInvocationFromCommandLine - Construct a compiler invocation object for
 /// a command line argument vector.
 ///
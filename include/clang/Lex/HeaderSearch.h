@@ -195,6 +195,30 @@ class HeaderSearch {
   llvm::StringMap<std::pair<unsigned, unsigned>, llvm::BumpPtrAllocator>
     LookupFileCache;
 
+  /// \brief The names in a directory, read once, used to rule out candidate
+  /// paths without a stat() each.
+  struct DirectoryListing {
+    /// \brief Whether the directory could be listed, and was not modified
+    /// too recently for the listing to be trusted.  If not, candidates in it
+    /// are always stat()'ed.
+    bool Valid;
+
+    /// \brief The modification time of the directory when it was listed.
+    time_t ModTime;
+
+    llvm::StringSet<llvm::BumpPtrAllocator> Names;
+
+    DirectoryListing() : Valid(false), ModTime(0) {}
+  };
+
+  /// \brief The listings of the directories searched so far, by path, when
+  /// HeaderSearchOptions::UseDirectoryListings is set.
+  llvm::StringMap<DirectoryListing *> DirectoryListings;
+
+  /// \brief Whether LookupFile is searching again after finding listings
+  /// that went stale.
+  bool RetryingWithFreshListings;
+
   /// \brief Collection mapping a framework or subframework
   /// name like "Carbon" to the Carbon.framework directory.
   llvm::StringMap<FrameworkCacheEntry, llvm::BumpPtrAllocator> FrameworkMap;
@@ -231,6 +255,7 @@ class HeaderSearch {
   unsigned NumIncluded;
   unsigned NumMultiIncludeFileOptzn;
   unsigned NumFrameworkLookups, NumSubFrameworkLookups;
+  unsigned NumDirectoriesListed, NumStatsAvoided;
 
   // HeaderSearch doesn't support default or copy construction.
   HeaderSearch(const HeaderSearch&) LLVM_DELETED_FUNCTION;
@@ -590,6 +615,24 @@ public:
                                               FileManager &FileMgr);
 
 private:
+  /// \brief Determine whether the file \p Filename, relative to the directory
+  /// \p DirName, may exist, according to the listings of the directories on
+  /// the way to it.
+  ///
+  /// \returns false only if a listing rules the file out; true if it may
+  /// exist or if directory listings are not in use.
+  bool mayContainFile(StringRef DirName, StringRef Filename);
+
+  /// \brief Retrieve the listing of the directory \p DirName, listing it
+  /// if it has not been yet, or null if it cannot be listed.
+  const DirectoryListing *getDirectoryListing(StringRef DirName);
+
+  /// \brief Drop the directory listings whose directories were modified
+  /// since they were listed.
+  ///
+  /// \returns true if any listing was dropped.
+  bool revalidateDirectoryListings();
+
   /// \brief Describes what happened when we tried to load a module map file.
   enum LoadModuleMapResult {
     /// \brief The module map file had already been loaded.
@@ -135,6 +135,10 @@ public:
   /// Whether header search information should be output as for -v.
   unsigned Verbose : 1;
 
+  /// Whether to rule out the candidate paths of \#include'd files using a
+  /// listing of each search directory, read once, instead of a stat() each.
+  unsigned UseDirectoryListings : 1;
+
 public:
   HeaderSearchOptions(StringRef _Sysroot = "/")
     : Sysroot(_Sysroot), DisableModuleHash(0), ModuleMaps(0),
@@ -142,7 +146,7 @@ public:
       ModuleCachePruneAfter(31*24*60*60),
       UseBuiltinIncludes(true),
       UseStandardSystemIncludes(true), UseStandardCXXIncludes(true),
-      UseLibcxx(false), Verbose(false) {}
+      UseLibcxx(false), Verbose(false), UseDirectoryListings(false) {}
 
   /// AddPath - Add the \p Path path to the specified \p Group list.
   void AddPath(StringRef Path, frontend::IncludeDirGroup Group,
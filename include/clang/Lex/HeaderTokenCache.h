@@ -0,0 +1,97 @@
+//===--- HeaderTokenCache.h - Cached system header tokens -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the HeaderTokenCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_HEADERTOKENCACHE_H
+#define LLVM_CLANG_LEX_HEADERTOKENCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "clang/Basic/SourceLocation.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Compiler.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+
+class FileEntry;
+class LangOptions;
+class PTHLexer;
+class PTHManager;
+class Preprocessor;
+
+/// \brief A directory of token caches for system headers, shared by every
+/// compile that uses it.
+///
+/// Each system header gets a PTH file of its own, holding the tokens of the
+/// header alone, which the PTHManager memory maps read-only.  Many compiles
+/// running at once thus share the pages of the headers they all include,
+/// instead of each lexing them again.
+///
+/// The cached tokens are the raw tokens of the whole header, conditional
+/// blocks included, before any macro is expanded; no macro state goes into
+/// them, only the language options the lexer looks at.  Those options, the
+/// path, unique ID, size and modification time of the header, and the
+/// compiler version make up the name of its cache file, so a header that
+/// changes simply gets a new one.  The size and modification time are checked
+/// again when the cache file is opened.
+///
+/// Headers the cache has no tokens for are recorded, so that the compile can
+/// write them out once it is done (see CacheHeaderTokens).
+class HeaderTokenCache {
+  HeaderTokenCache(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+  void operator=(const HeaderTokenCache &) LLVM_DELETED_FUNCTION;
+
+  /// The directory holding the cache files.
+  std::string Path;
+
+  /// Hash of the compiler version and of the options that affect lexing.
+  llvm::hash_code OptionsHash;
+
+  /// The cache file opened for each header seen so far, or null if there is
+  /// none.
+  llvm::DenseMap<const FileEntry *, PTHManager *> Headers;
+
+  /// The headers with no cache file, in the order they were seen.
+  std::vector<const FileEntry *> Misses;
+
+  unsigned NumHits;
+
+public:
+  HeaderTokenCache(StringRef Path, const LangOptions &LangOpts);
+  ~HeaderTokenCache();
+
+  /// \brief The directory holding the cache files.
+  StringRef getPath() const { return Path; }
+
+  /// \brief The path of the cache file for \p File, or an empty string if
+  /// it cannot be cached because its path is relative.
+  std::string getCacheFile(const FileEntry *File) const;
+
+  /// \brief Return a lexer for the cached tokens of \p FID, or null if \p FID
+  /// is not a system header or if its tokens are not in the cache.
+  PTHLexer *createLexer(Preprocessor &PP, FileID FID);
+
+  /// \brief The system headers whose tokens were not in the cache.
+  ArrayRef<const FileEntry *> getMisses() const { return Misses; }
+
+  /// \brief The number of system headers whose tokens were in the cache.
+  unsigned getNumHits() const { return NumHits; }
+
+  void PrintStats() const;
+};
+
+} // end namespace clang
+
+#endif
@@ -74,6 +74,12 @@ class PTHManager : public IdentifierInfoLookup {
   ///  if the file (if any) that was to used to generate the PTH cache.
   const char* OriginalSourceFile;
 
+  /// IdentifiersFromPreprocessor - True if the identifiers of the cached
+  ///  tokens are looked up in the identifier table of the preprocessor,
+  ///  rather than served by this manager.  This is the case for the PTH files
+  ///  of a header token cache, many of which are used at a time.
+  bool IdentifiersFromPreprocessor;
+
   /// This constructor is intended to only be called by the static 'Create'
   /// method.
   PTHManager(const llvm::MemoryBuffer* buf, void* fileLookup,
@@ -98,6 +104,10 @@ class PTHManager : public IdentifierInfoLookup {
   }
   IdentifierInfo* LazilyCreateIdentifierInfo(unsigned PersistentID);
 
+  /// Load - Implements Create and CreateForHeader, reporting errors to
+  ///  \p Diags if it is not null.
+  static PTHManager *Load(const std::string& file, DiagnosticsEngine *Diags);
+
 public:
   // The current PTH version.
   enum { Version = 10 };
@@ -120,17 +130,26 @@ public:
   ///  is the name of the PTH file.  This method returns NULL upon failure.
   static PTHManager *Create(const std::string& file, DiagnosticsEngine &Diags);
 
+  /// CreateForHeader - Open a PTH file holding the tokens of a single header,
+  ///  as written to a header token cache, for use by \p PP.  Unlike Create,
+  ///  this reports no errors: it silently returns NULL upon failure.
+  static PTHManager *CreateForHeader(const std::string& file,
+                                     Preprocessor &PP);
+
   void setPreprocessor(Preprocessor *pp) { PP = pp; }
 
   /// CreateLexer - Return a PTHLexer that "lexes" the cached tokens for the
-  ///  specified file.  This method returns NULL if no cached tokens exist.
+  ///  specified file.  This method returns NULL if no cached tokens exist, or
+  ///  if the size or modification time of the file do not match those it had
+  ///  when its tokens were cached.
   ///  It is the responsibility of the caller to 'delete' the returned object.
   PTHLexer *CreateLexer(FileID FID);
 
   /// createStatCache - Returns a FileSystemStatCache object for use with
   ///  FileManager objects.  These objects use the PTH data to speed up
   ///  calls to stat by memoizing their results from when the PTH file
-  ///  was generated.
+  ///  was generated.  Files with cached tokens are still stat'ed, so that
+  ///  CreateLexer can tell whether they changed since.
   FileSystemStatCache *createStatCache();
 };
 
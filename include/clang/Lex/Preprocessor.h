@@ -18,6 +18,7 @@
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/MacroInfo.h"
 #include "clang/Lex/ModuleMap.h"
@@ -102,6 +103,10 @@ class Preprocessor : public RefCountedBase<Preprocessor> {
   ///  a token cache rather than lexing the original source file.
   OwningPtr<PTHManager> PTH;
 
+  /// HeaderTokens - An optional cache of the tokens of system headers, used
+  ///  for the headers PTH has no tokens for.
+  OwningPtr<HeaderTokenCache> HeaderTokens;
+
   /// BP - A BumpPtrAllocator object used to quickly allocate and release
   ///  objects internal to the Preprocessor.
   llvm::BumpPtrAllocator BP;
@@ -447,6 +452,14 @@ public:
 
   PTHManager *getPTHManager() { return PTH.get(); }
 
+  /// \brief Read the tokens of system headers from \p Cache when it has them,
+  /// taking ownership of it.
+  void setHeaderTokenCache(HeaderTokenCache *Cache) {
+    HeaderTokens.reset(Cache);
+  }
+
+  HeaderTokenCache *getHeaderTokenCache() { return HeaderTokens.get(); }
+
   void setExternalSource(ExternalPreprocessorSource *Source) {
     ExternalSource = Source;
   }
@@ -89,6 +89,10 @@ public:
   /// If given, a PTH cache file to use for speeding up header parsing.
   std::string TokenCache;
 
+  /// If given, a directory in which to cache the tokens of system headers,
+  /// shared by every compile that uses it.
+  std::string HeaderTokenCachePath;
+
   /// \brief True if the SourceManager should report the original file name for
   /// contents of files that were remapped to other files. Defaults to true.
   bool RemappedFilesKeepOriginalName;
@@ -21,9 +21,8 @@
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MemoryBuffer.h"
-#include "llvm/Support/SourceMgr.h"
-#include "llvm/Support/YAMLParser.h"
 #include <string>
 #include <vector>
 
@@ -47,10 +46,21 @@ namespace tooling {
 ///
 /// JSON compilation databases can for example be generated in CMake projects
 /// by setting the flag -DCMAKE_EXPORT_COMPILE_COMMANDS.
+///
+/// Database files are memory mapped, and loading them only checks their
+/// syntax and indexes where each entry's 'directory' and 'command' strings
+/// are; the command lines are unescaped and split when they are asked for.
+/// The index can be saved to a file next to the database (see writeIndex()),
+/// which later loads use for as long as the database stays unchanged.  When
+/// the environment variable CLANG_COMPILATION_DATABASE_INDEX is set, loading
+/// a database of 1 MB or more from a build directory saves its index there.
 class JSONCompilationDatabase : public CompilationDatabase {
 public:
   /// \brief Loads a JSON compilation database from the specified file.
   ///
+  /// Uses the index at getIndexPath(FilePath) instead of scanning the file
+  /// if the index was written for the file as it is now.
+  ///
   /// Returns NULL and sets ErrorMessage if the database could not be
   /// loaded from the given file.
   static JSONCompilationDatabase *loadFromFile(StringRef FilePath,
@@ -79,21 +89,41 @@ public:
   /// database.
   virtual std::vector<CompileCommand> getAllCompileCommands() const;
 
+  /// \brief Returns the path of the index saved for the database file at
+  /// \p FilePath.
+  static std::string getIndexPath(StringRef FilePath);
+
+  /// \brief Saves the index of the database to \p IndexPath, replacing any
+  /// index that was there.
+  ///
+  /// Only databases loaded from a file can be indexed.  Returns false and
+  /// sets ErrorMessage if the index could not be written.
+  bool writeIndex(StringRef IndexPath, std::string &ErrorMessage) const;
+
+  /// \brief Returns whether the database was loaded from a saved index.
+  bool wasLoadedFromIndex() const { return LoadedFromIndex; }
+
 private:
   /// \brief Constructs a JSON compilation database on a memory buffer.
   JSONCompilationDatabase(llvm::MemoryBuffer *Database)
-    : Database(Database), YAMLStream(Database->getBuffer(), SM) {}
+    : Database(Database), HasModificationTime(false), ModificationTime(0),
+      LoadedFromIndex(false) {}
 
-  /// \brief Parses the database file and creates the index.
+  /// \brief Scans the database file and creates the index.
   ///
   /// Returns whether parsing succeeded. Sets ErrorMessage if parsing
   /// failed.
   bool parse(std::string &ErrorMessage);
 
-  // Tuple (directory, commandline) where 'commandline' pointing to the
-  // corresponding nodes in the YAML stream.
-  typedef std::pair<llvm::yaml::ScalarNode*,
-                    llvm::yaml::ScalarNode*> CompileCommandRef;
+  /// \brief Creates the index from a saved one.
+  ///
+  /// Returns false if \p Index is malformed or was not written for the
+  /// database as it is now, in which case the database must not be used.
+  bool readIndex(StringRef Index);
+
+  // Tuple (directory, commandline) of the still escaped contents of the
+  // corresponding JSON strings in the database buffer.
+  typedef std::pair<StringRef, StringRef> CompileCommandRef;
 
   /// \brief Converts the given array of CompileCommandRefs to CompileCommands.
   void getCommands(ArrayRef<CompileCommandRef> CommandsRef,
@@ -105,8 +135,13 @@ private:
   FileMatchTrie MatchTrie;
 
   OwningPtr<llvm::MemoryBuffer> Database;
-  llvm::SourceMgr SM;
-  llvm::yaml::Stream YAMLStream;
+
+  // The modification time of the database file when it was loaded, which a
+  // saved index records to tell whether it is still up to date.
+  bool HasModificationTime;
+  uint64_t ModificationTime;
+
+  bool LoadedFromIndex;
 };
 
 } // end namespace tooling
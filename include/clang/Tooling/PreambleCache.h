@@ -0,0 +1,123 @@
+//===--- PreambleCache.h - Preambles shared across a tool run ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file defines PreambleCache, which lets the translation units a tool
+//  runs over share precompiled preambles instead of each parsing the same
+//  headers again.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_TOOLING_PREAMBLE_CACHE_H
+#define LLVM_CLANG_TOOLING_PREAMBLE_CACHE_H
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace clang {
+
+class CompilerInstance;
+class CompilerInvocation;
+class FileManager;
+
+namespace tooling {
+
+/// \brief Precompiled preambles shared by the translation units of a tool
+/// run.
+///
+/// The preamble of a source file is the block of preprocessor directives and
+/// comments at its start, as computed by \c Lexer::ComputePreamble; usually,
+/// its #includes.  Source files compiled with the same options, from the same
+/// directory, and whose preambles are the same text share one precompiled
+/// preamble.  It is built the way \c ASTUnit builds its own, the first time
+/// it is needed, and every later translation unit loads it instead of
+/// parsing the headers again.
+///
+/// Headers are assumed not to change while the cache is alive.  Source
+/// locations inside the preamble itself refer to the source file the
+/// preamble was built from.  The diagnostics of building a preamble are
+/// kept with it, and reported again by every translation unit that uses it.
+///
+/// The cache may be shared by several threads.
+class PreambleCache {
+public:
+  PreambleCache();
+
+  /// \brief Removes the precompiled preambles.
+  ~PreambleCache();
+
+  /// \brief Make \p Invocation load a shared precompiled preamble for its
+  /// main file, building it first if no translation unit did so before.
+  ///
+  /// \param MainBuffer The contents of the main file.
+  /// \param Files The file manager \p Invocation runs with.
+  /// \param MappedFiles Contents standing in for files on disk, by path.
+  /// \param Diagnostics Receives the diagnostics of building the preamble,
+  /// which the translation unit does not see again; they are to be passed to
+  /// \c reportDiagnostics once it has loaded the preamble.
+  ///
+  /// \returns True if \p Invocation now uses a precompiled preamble.  If the
+  /// preamble could not be built, \p Invocation is left untouched, so that
+  /// its errors are reported when the translation unit itself is compiled.
+  bool usePreamble(CompilerInvocation &Invocation,
+                   const llvm::MemoryBuffer *MainBuffer, FileManager &Files,
+                   const llvm::StringMap<StringRef> &MappedFiles,
+                   std::vector<StoredDiagnostic> &Diagnostics);
+
+  /// \brief Report the \p Diagnostics of building the preamble \p CI has
+  /// loaded to its diagnostic consumer, as if they came from \p CI itself.
+  ///
+  /// This is to be called once the preamble is loaded, which is by the time
+  /// \c FrontendAction::BeginSourceFileAction runs.
+  static void reportDiagnostics(CompilerInstance &CI,
+                                ArrayRef<StoredDiagnostic> Diagnostics);
+
+  /// \brief The number of translation units that used a preamble built
+  /// before.
+  unsigned getNumHits() const;
+
+  /// \brief The number of translation units with a preamble that had to be
+  /// built, or that another thread was still building.
+  unsigned getNumMisses() const;
+
+  /// \brief The number of preambles that failed to build.
+  unsigned getNumFailures() const;
+
+  /// \brief Print the hit and miss counts to \p OS.
+  void printStats(raw_ostream &OS) const;
+
+private:
+  struct Entry {
+    enum StateKind { Building, Ready, Failed };
+    StateKind State;
+    std::string PCHPath;
+    // Locations are those of the compiler that built the preamble.
+    std::vector<StoredDiagnostic> Diagnostics;
+  };
+
+  mutable llvm::sys::Mutex Lock;
+  // Maps the key computed for a preamble to its precompiled form.
+  llvm::StringMap<Entry> Entries;
+  unsigned NumHits;
+  unsigned NumMisses;
+  unsigned NumFailures;
+};
+
+} // end namespace tooling
+} // end namespace clang
+
+#endif // LLVM_CLANG_TOOLING_PREAMBLE_CACHE_H
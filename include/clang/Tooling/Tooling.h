@@ -53,6 +53,8 @@ class FrontendAction;
 
 namespace tooling {
 
+class PreambleCache;
+
 /// \brief Interface to generate clang::FrontendActions.
 class FrontendActionFactory {
 public:
@@ -151,13 +153,25 @@ class ToolInvocation {
   /// \param Content A null terminated buffer of the file's content.
   void mapVirtualFile(StringRef FilePath, StringRef Content);
 
+  /// \brief Print the diagnostics of the driver and the compiler to \p OS
+  /// instead of to llvm::errs().
+  void setDiagnosticStream(raw_ostream &OS) { DiagOS = &OS; }
+
+  /// \brief Load the preamble of the main file from \p Cache, or build it
+  /// there.  Not owned.
+  void setPreambleCache(PreambleCache *Cache) { Preambles = Cache; }
+
   /// \brief Run the clang invocation.
   ///
+  /// Relative paths are resolved against the directory given with
+  /// -working-directory, if any.  If \c Files resolves them against another
+  /// directory, the invocation uses a file manager of its own.
+  ///
   /// \returns True if there were no errors during execution.
   bool run();
 
  private:
-  void addFileMappingsTo(SourceManager &SourceManager);
+  void addFileMappingsTo(SourceManager &SourceManager, FileManager &Files);
 
   bool runInvocation(const char *BinaryName,
                      clang::driver::Compilation *Compilation,
@@ -168,6 +182,25 @@ class ToolInvocation {
   FileManager *Files;
   // Maps <file name> -> <file content>.
   llvm::StringMap<StringRef> MappedFileContents;
+  raw_ostream *DiagOS;
+  PreambleCache *Preambles;
+};
+
+/// \brief Receives the outcome of each translation unit processed by
+/// ClangTool::runInParallel.
+class ToolResultCallback {
+public:
+  virtual ~ToolResultCallback();
+
+  /// \brief Called once for each compile command, in the order
+  /// ClangTool::run would have processed them, and never concurrently.
+  ///
+  /// \param File The absolute path of the source file.
+  /// \param Success Whether the tool ran without errors.
+  /// \param Diagnostics What the driver and the compiler printed while
+  /// processing the file.
+  virtual void handleResult(StringRef File, bool Success,
+                            StringRef Diagnostics) = 0;
 };
 
 /// \brief Utility to run a FrontendAction over a set of files.
@@ -213,6 +246,13 @@ class ClangTool {
   /// \brief Clear the command line arguments adjuster chain.
   void clearArgumentsAdjusters();
 
+  /// \brief Share precompiled preambles between the translation units the
+  /// tool runs over, through \p Cache.  Not owned; off by default.
+  ///
+  /// Translation units whose source files start with the same #includes,
+  /// and are compiled with the same options, parse those headers only once.
+  void setPreambleCache(PreambleCache *Cache) { Preambles = Cache; }
+
   /// Runs a frontend action over all files specified in the command line.
   ///
   /// \param ActionFactory Factory generating the frontend actions. The function
@@ -220,12 +260,34 @@ class ClangTool {
   /// processed translation unit.
   virtual int run(FrontendActionFactory *ActionFactory);
 
+  /// \brief Runs a frontend action over all files specified in the command
+  /// line, processing up to \p NumThreads translation units at once.
+  ///
+  /// Each thread has its own file manager and diagnostics.  Actions are
+  /// created one at a time, but run concurrently, so whatever they share
+  /// through \p ActionFactory must be thread safe.
+  ///
+  /// \param ActionFactory Factory generating the frontend actions. The function
+  /// takes ownership of this parameter.
+  /// \param NumThreads The number of threads to use.
+  /// \param Callback Receives the result of each translation unit.  If null,
+  /// the diagnostics of each translation unit are printed to llvm::errs(), in
+  /// the same order.
+  int runInParallel(FrontendActionFactory *ActionFactory, unsigned NumThreads,
+                    ToolResultCallback *Callback = NULL);
+
   /// \brief Returns the file manager used in the tool.
   ///
-  /// The file manager is shared between all translation units.
+  /// The file manager is shared between all translation units run by \c run
+  /// without a working directory.  Translation units compiled in a directory
+  /// get a file manager that resolves relative paths against it.
   FileManager &getFiles() { return Files; }
 
  private:
+  /// \brief Returns the command line to run for compile command \p I.
+  std::vector<std::string> getCommandLine(unsigned I,
+                                          StringRef MainExecutable) const;
+
   // We store compile commands as pair (file name, compile command).
   std::vector< std::pair<std::string, CompileCommand> > CompileCommands;
 
@@ -234,6 +296,8 @@ class ClangTool {
   std::vector< std::pair<StringRef, StringRef> > MappedFileContents;
 
   SmallVector<ArgumentsAdjuster *, 2> ArgsAdjusters;
+
+  PreambleCache *Preambles;
 };
 
 template <typename T>
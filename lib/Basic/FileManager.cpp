@@ -550,6 +550,16 @@ void FileManager::GetUniqueIDMapping(
       UIDToFiles[(*VFE)->getUID()] = *VFE;
 }
 
+void FileManager::GetVirtualFiles(
+                   SmallVectorImpl<const FileEntry *> &Files) const {
+  Files.clear();
+  for (SmallVectorImpl<FileEntry *>::const_iterator
+         VFE = VirtualFileEntries.begin(), VFEEnd = VirtualFileEntries.end();
+       VFE != VFEEnd; ++VFE)
+    if (*VFE && *VFE != NON_EXISTENT_FILE)
+      Files.push_back(*VFE);
+}
+
 void FileManager::modifyFileEntry(FileEntry *File,
                                   off_t Size, time_t ModificationTime) {
   File->Size = Size;
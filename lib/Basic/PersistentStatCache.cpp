@@ -0,0 +1,354 @@
+//===--- PersistentStatCache.cpp - 'stat' results kept on disk ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the PersistentStatCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/PersistentStatCache.h"
+#include "clang/Basic/OnDiskHashTable.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <cstdio>
+#include <cstring>
+using namespace clang;
+using namespace clang::io;
+
+// The cache file starts with a header:
+//
+//   "cfe-stat"    magic
+//   uint32        version
+//   uint32        generation
+//
+// followed by the on-disk hash table, whose offsets are relative to the
+// start of the table data.  Its first word holds the offset of the buckets.
+static const char Magic[] = "cfe-stat";
+static const unsigned MagicSize = 8;
+static const unsigned Version = 1;
+static const unsigned HeaderSize = MagicSize + 4 + 4;
+
+namespace {
+class StatCacheTrait {
+public:
+  typedef StringRef key_type;
+  typedef StringRef key_type_ref;
+  typedef StringRef internal_key_type;
+  typedef StringRef external_key_type;
+  typedef PersistentStatCache::Entry data_type;
+  typedef const PersistentStatCache::Entry &data_type_ref;
+
+  enum {
+    Exists = 0x1,
+    IsDirectory = 0x2,
+    IsNamedPipe = 0x4
+  };
+
+  static unsigned ComputeHash(StringRef Path) {
+    return llvm::HashString(Path);
+  }
+
+  static bool EqualKey(StringRef A, StringRef B) { return A == B; }
+  static StringRef GetInternalKey(StringRef Path) { return Path; }
+  static StringRef GetExternalKey(StringRef Path) { return Path; }
+
+  static std::pair<unsigned, unsigned>
+  EmitKeyDataLength(raw_ostream &Out, StringRef Path, data_type_ref E) {
+    unsigned KeyLen = Path.size();
+    unsigned DataLen = E.Exists ? 1 + 4 * 8 : 1 + 2 + 8;
+    Emit16(Out, KeyLen);
+    Emit8(Out, DataLen);
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  static void EmitKey(raw_ostream &Out, StringRef Path, unsigned) {
+    Out << Path;
+  }
+
+  static void EmitData(raw_ostream &Out, StringRef, data_type_ref E,
+                       unsigned) {
+    if (!E.Exists) {
+      Emit8(Out, 0);
+      Emit16(Out, E.AncestorLength);
+      Emit64(Out, E.AncestorModTime);
+      return;
+    }
+
+    Emit8(Out, Exists | (E.Data.IsDirectory ? IsDirectory : 0) |
+               (E.Data.IsNamedPipe ? IsNamedPipe : 0));
+    Emit64(Out, E.Data.UniqueID.getDevice());
+    Emit64(Out, E.Data.UniqueID.getFile());
+    Emit64(Out, E.Data.Size);
+    Emit64(Out, E.Data.ModTime);
+  }
+
+  static std::pair<unsigned, unsigned>
+  ReadKeyDataLength(const unsigned char *&D) {
+    unsigned KeyLen = ReadUnalignedLE16(D);
+    unsigned DataLen = *D++;
+    return std::make_pair(KeyLen, DataLen);
+  }
+
+  static StringRef ReadKey(const unsigned char *D, unsigned N) {
+    return StringRef((const char *)D, N);
+  }
+
+  static data_type ReadData(StringRef, const unsigned char *D, unsigned) {
+    data_type E;
+    unsigned Flags = *D++;
+    if (!(Flags & Exists)) {
+      E.AncestorLength = ReadUnalignedLE16(D);
+      E.AncestorModTime = ReadUnalignedLE64(D);
+      return E;
+    }
+
+    E.Exists = true;
+    uint64_t Device = ReadUnalignedLE64(D);
+    uint64_t File = ReadUnalignedLE64(D);
+    E.Data.UniqueID = llvm::sys::fs::UniqueID(Device, File);
+    E.Data.Size = ReadUnalignedLE64(D);
+    E.Data.ModTime = ReadUnalignedLE64(D);
+    E.Data.IsDirectory = Flags & IsDirectory;
+    E.Data.IsNamedPipe = Flags & IsNamedPipe;
+    E.Data.InPCH = false;
+    return E;
+  }
+};
+
+typedef OnDiskChainedHashTable<StatCacheTrait> StatCacheTable;
+} // end anonymous namespace
+
+/// Read the cache file \p Path into \p File and return its hash table, or
+/// null if it is missing, damaged or of another generation than
+/// \p Generation, unless that is 0.
+static StatCacheTable *readCacheFile(StringRef Path, unsigned Generation,
+                                     OwningPtr<llvm::MemoryBuffer> &File) {
+  if (llvm::MemoryBuffer::getFile(Path, File))
+    return 0;
+
+  const unsigned char *Start = (const unsigned char *)File->getBufferStart();
+  uint64_t Size = File->getBufferSize();
+  if (Size < HeaderSize + 4 || memcmp(Start, Magic, MagicSize) != 0)
+    return 0;
+
+  const unsigned char *D = Start + MagicSize;
+  if (ReadLE32(D) != Version)
+    return 0;
+  unsigned FileGeneration = ReadLE32(D);
+  if (Generation && FileGeneration != Generation)
+    return 0;
+
+  const unsigned char *Base = Start + HeaderSize;
+  Size -= HeaderSize;
+  D = Base;
+  uint64_t BucketOffset = ReadLE32(D);
+  if (BucketOffset < 4 || BucketOffset % 4 != 0 || BucketOffset + 8 > Size)
+    return 0;
+  D = Base + BucketOffset;
+  uint64_t NumBuckets = ReadLE32(D);
+  if (BucketOffset + 8 + NumBuckets * 4 > Size)
+    return 0;
+
+  return StatCacheTable::Create(Base + BucketOffset, Base);
+}
+
+PersistentStatCache::PersistentStatCache(StringRef Path, unsigned Generation)
+  : Path(Path), Generation(Generation), Table(0),
+    NumHits(0), NumMisses(0), NumDirStats(0) {
+  Now = llvm::sys::TimeValue::now().toEpochTime();
+  if (llvm::sys::fs::current_path(WorkingDir))
+    WorkingDir.clear();
+}
+
+PersistentStatCache *PersistentStatCache::Create(StringRef Path,
+                                                 unsigned Generation) {
+  PersistentStatCache *Cache = new PersistentStatCache(Path, Generation);
+
+  // A cache file that is missing, damaged or of another generation simply
+  // leaves the cache empty.
+  OwningPtr<llvm::MemoryBuffer> File;
+  if (StatCacheTable *Table = readCacheFile(Path, Generation, File)) {
+    Cache->Buffer.reset(File.take());
+    Cache->Table = Table;
+  }
+  return Cache;
+}
+
+PersistentStatCache::~PersistentStatCache() {
+  delete (StatCacheTable *)Table;
+}
+
+time_t PersistentStatCache::getDirModTime(StringRef Dir) {
+  llvm::StringMapEntry<time_t> &Known =
+    DirModTimes.GetOrCreateValue(Dir, time_t(-2));
+  if (Known.getValue() != time_t(-2))
+    return Known.getValue();
+
+  ++NumDirStats;
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(Dir, Status) ||
+      !llvm::sys::fs::is_directory(Status))
+    Known.setValue(-1);
+  else
+    Known.setValue(Status.getLastModificationTime().toEpochTime());
+  return Known.getValue();
+}
+
+bool PersistentStatCache::isValid(StringRef Path, const Entry &E) {
+  if (Generation)
+    return true;
+  if (E.Exists || E.AncestorLength >= Path.size())
+    return false;
+  return getDirModTime(Path.substr(0, E.AncestorLength)) == E.AncestorModTime;
+}
+
+void PersistentStatCache::record(StringRef Path, LookupResult Result,
+                                 const FileData &Data) {
+  if (Path.size() > 0xFFFF)
+    return;
+
+  Entry E;
+  if (Result == CacheExists) {
+    // Without a generation, a path that exists is stat()'ed again anyway, so
+    // there is no point in keeping it.
+    if (!Generation)
+      return;
+    E.Exists = true;
+    E.Data = Data;
+    E.Data.InPCH = false;
+  } else if (!Generation) {
+    // Without a generation, a missing path is only known to stay missing
+    // while its deepest existing ancestor is unchanged.
+    StringRef Ancestor = llvm::sys::path::parent_path(Path);
+    time_t ModTime = -1;
+    for (; !Ancestor.empty(); Ancestor = llvm::sys::path::parent_path(Ancestor))
+      if ((ModTime = getDirModTime(Ancestor)) != time_t(-1))
+        break;
+
+    // The modification time only has a resolution of a second, so a change
+    // within the second the directory was last modified would go unnoticed.
+    if (Ancestor.empty() || ModTime + 1 >= Now)
+      return;
+    E.AncestorLength = Ancestor.size();
+    E.AncestorModTime = ModTime;
+  }
+  NewEntries[Path] = E;
+}
+
+PersistentStatCache::LookupResult
+PersistentStatCache::getStat(const char *Path, FileData &Data, bool isFile,
+                             int *FileDescriptor) {
+  SmallString<256> AbsolutePath;
+  StringRef Key(Path);
+  if (!llvm::sys::path::is_absolute(Key)) {
+    if (WorkingDir.empty())
+      return statChained(Path, Data, isFile, FileDescriptor);
+    AbsolutePath = WorkingDir;
+    llvm::sys::path::append(AbsolutePath, Key);
+    Key = AbsolutePath.str();
+  }
+
+  if (StatCacheTable *Cache = (StatCacheTable *)Table) {
+    StatCacheTable::iterator I = Cache->find(Key);
+    if (I != Cache->end()) {
+      Entry E = *I;
+      if (isValid(Key, E)) {
+        ++NumHits;
+        if (!E.Exists)
+          return CacheMissing;
+        Data = E.Data;
+        return CacheExists;
+      }
+    }
+  }
+
+  ++NumMisses;
+  LookupResult Result = statChained(Path, Data, isFile, FileDescriptor);
+  record(Key, Result, Data);
+  return Result;
+}
+
+bool PersistentStatCache::save() {
+  if (NewEntries.empty())
+    return false;
+
+  // Keep the entries of the cache file that were not stat()'ed again.  Read
+  // it afresh, so that the entries written by compiles that finished since
+  // this one started are kept as well.
+  OwningPtr<llvm::MemoryBuffer> Latest;
+  OwningPtr<StatCacheTable> LatestTable(readCacheFile(Path, Generation,
+                                                      Latest));
+  StatCacheTable *Cache = LatestTable.get();
+  if (!Cache)
+    Cache = (StatCacheTable *)Table;
+  OnDiskChainedHashTableGenerator<StatCacheTrait> Generator;
+  if (Cache) {
+    StatCacheTable::key_iterator K = Cache->key_begin();
+    for (StatCacheTable::data_iterator D = Cache->data_begin(),
+           DEnd = Cache->data_end(); D != DEnd; ++D, ++K)
+      if (!NewEntries.count(*K))
+        Generator.insert(*K, *D);
+  }
+  for (llvm::StringMap<Entry, llvm::BumpPtrAllocator>::iterator
+         I = NewEntries.begin(), E = NewEntries.end(); I != E; ++I)
+    Generator.insert(I->getKey(), I->getValue());
+
+  SmallString<4096> TableData;
+  {
+    llvm::raw_svector_ostream Out(TableData);
+    // Leave room for the offset of the buckets; offsets of 0 mean an empty
+    // bucket.
+    Emit32(Out, 0);
+    uint32_t BucketOffset = Generator.Emit(Out);
+    Out.flush();
+    unsigned char *D = (unsigned char *)TableData.data();
+    for (unsigned i = 0; i != 4; ++i)
+      D[i] = (unsigned char)(BucketOffset >> (i * 8));
+  }
+
+  // Write to a temporary file and rename it, so that compiles running at the
+  // same time never map half a cache file.
+  SmallString<128> TempPath(Path);
+  TempPath += "-%%%%%%%%";
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(TempPath.str(), FD, TempPath))
+    return true;
+  {
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    Out.write(Magic, MagicSize);
+    Emit32(Out, Version);
+    Emit32(Out, Generation);
+    Out << TableData.str();
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+      return true;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath.str(), Path)) {
+    bool Existed;
+    llvm::sys::fs::remove(TempPath.str(), Existed);
+    return true;
+  }
+  return false;
+}
+
+void PersistentStatCache::PrintStats() const {
+  fprintf(stderr, "\n*** Persistent Stat Cache Stats:\n");
+  fprintf(stderr, "%u stat calls answered from the cache, %u not.\n",
+          NumHits, NumMisses);
+  fprintf(stderr, "%u directories stat'ed to validate the cache.\n",
+          NumDirStats);
+}
@@ -373,7 +373,7 @@ LineTableInfo &SourceManager::getLineTable() {
 SourceManager::SourceManager(DiagnosticsEngine &Diag, FileManager &FileMgr,
                              bool UserFilesAreVolatile)
   : Diag(Diag), FileMgr(FileMgr), OverridenFilesKeepOriginalName(true),
-    UserFilesAreVolatile(UserFilesAreVolatile),
+    UserFilesAreVolatile(UserFilesAreVolatile), IncrementalLineTables(true),
     ExternalSLocEntries(0), LineTable(0), NumLinearScans(0),
     NumBinaryProbes(0), FakeBufferForRecovery(0),
     FakeContentCacheForRecovery(0) {
@@ -1208,90 +1208,153 @@ unsigned SourceManager::getPresumedColumnNumber(SourceLocation Loc,
 #include <emmintrin.h>
 #endif
 
+/// When line tables are built incrementally, how far past the queried offset
+/// the scan for line starts goes, so that queries moving forward through a
+/// file do not each have to resume it.
+static const unsigned LineTableChunkSize = 64 * 1024;
+
+/// Append to \p LineOffsets the offsets of the lines of [Buf, End) that start
+/// after \p Offs, itself the start of a line.  Stop once a line starting
+/// after \p StopOffs has been found and \p LineOffsets holds at least
+/// \p MinLines entries.  This does not look at trigraphs, escaped newlines,
+/// or anything else tricky.
+///
+/// \returns true if the scan reached the end of the buffer.
+static bool FindLineStarts(const unsigned char *Buf, const unsigned char *End,
+                           unsigned Offs, unsigned StopOffs, unsigned MinLines,
+                           SmallVectorImpl<unsigned> &LineOffsets) {
+  const unsigned char *Ptr = Buf + Offs;
+
+#ifdef __SSE2__
+  // Scan 16 byte chunks for '\r' and '\n', and record every line that starts
+  // in a chunk before loading the next one.  Ignore '\0'.  This is very
+  // performance sensitive for programs with lots of diagnostics and in -E
+  // mode.
+  __m128i CRs = _mm_set1_epi8('\r');
+  __m128i LFs = _mm_set1_epi8('\n');
+  while (Ptr+16 <= End) {
+    const __m128i Chunk = _mm_loadu_si128((const __m128i*)Ptr);
+    __m128i Cmp = _mm_or_si128(_mm_cmpeq_epi8(Chunk, CRs),
+                               _mm_cmpeq_epi8(Chunk, LFs));
+    unsigned Mask = _mm_movemask_epi8(Cmp);
+    const unsigned char *Next = Ptr+16;
+    while (Mask != 0) {
+      const unsigned char *Newline = Ptr + llvm::countTrailingZeros(Mask);
+      const unsigned char *LineStart = Newline+1;
+      // If this is \n\r or \r\n, skip both characters.  The second one may
+      // be the first byte of the next chunk.
+      if ((*LineStart == '\n' || *LineStart == '\r') && *LineStart != *Newline)
+        ++LineStart;
+      Offs = LineStart-Buf;
+      LineOffsets.push_back(Offs);
+      if (Offs > StopOffs && LineOffsets.size() >= MinLines)
+        return false;
+      // Drop the newline characters just handled.
+      Mask &= ~0U << (LineStart-Ptr);
+      if (LineStart > Next)
+        Next = LineStart;
+    }
+    Ptr = Next;
+  }
+#endif
+
+  while (1) {
+    // Skip over the contents of the line.
+    while (*Ptr != '\n' && *Ptr != '\r' && *Ptr != '\0')
+      ++Ptr;
+
+    if (Ptr[0] == '\n' || Ptr[0] == '\r') {
+      // If this is \n\r or \r\n, skip both characters.
+      if ((Ptr[1] == '\n' || Ptr[1] == '\r') && Ptr[0] != Ptr[1])
+        ++Ptr;
+      ++Ptr;
+      Offs = Ptr-Buf;
+      LineOffsets.push_back(Offs);
+      if (Offs > StopOffs && LineOffsets.size() >= MinLines)
+        return false;
+    } else {
+      // Otherwise, this is a null.  If end of file, exit.
+      if (Ptr == End)
+        return true;
+      // Otherwise, skip the null.
+      ++Ptr;
+    }
+  }
+}
+
+/// Whether the line table of \p FI does not yet cover offset \p FilePos and
+/// line \p Line.  A line table covers an offset if it holds the start of a
+/// later line, or if it is complete.
+static bool NeedsMoreLines(const ContentCache *FI, unsigned FilePos,
+                           unsigned Line) {
+  if (FI->SourceLineCache == 0)
+    return true;
+  if (FI->LineTableComplete)
+    return false;
+  return FI->SourceLineCache[FI->NumLines-1] <= FilePos || FI->NumLines < Line;
+}
+
+/// Extend the line table of \p FI, computing it first if there is none, so
+/// that it covers offset \p FilePos and line \p Line.  Unless
+/// \p Incremental, compute the whole table.
 static LLVM_ATTRIBUTE_NOINLINE void
 ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
                    llvm::BumpPtrAllocator &Alloc,
-                   const SourceManager &SM, bool &Invalid);
+                   const SourceManager &SM, bool &Invalid,
+                   unsigned FilePos, unsigned Line, bool Incremental);
 static void ComputeLineNumbers(DiagnosticsEngine &Diag, ContentCache *FI,
                                llvm::BumpPtrAllocator &Alloc,
-                               const SourceManager &SM, bool &Invalid) {
+                               const SourceManager &SM, bool &Invalid,
+                               unsigned FilePos, unsigned Line,
+                               bool Incremental) {
   // Note that calling 'getBuffer()' may lazily page in the file.
   const MemoryBuffer *Buffer = FI->getBuffer(Diag, SM, SourceLocation(),
                                              &Invalid);
   if (Invalid)
     return;
 
-  // Find the file offsets of all of the *physical* source lines.  This does
-  // not look at trigraphs, escaped newlines, or anything else tricky.
+  // Find the file offsets of the *physical* source lines, resuming at the
+  // start of the last line found so far.
   SmallVector<unsigned, 256> LineOffsets;
+  unsigned NumLines = 0;
+  unsigned Offs = 0;
+  if (FI->SourceLineCache) {
+    NumLines = FI->NumLines;
+    Offs = FI->SourceLineCache[NumLines-1];
+  } else {
+    // Line #1 starts at char 0.
+    LineOffsets.push_back(0);
+  }
 
-  // Line #1 starts at char 0.
-  LineOffsets.push_back(0);
+  unsigned StopOffs = ~0U;
+  unsigned MinLines = 0;
+  if (Incremental) {
+    StopOffs = FilePos + std::min(LineTableChunkSize, ~0U - FilePos);
+    if (Line > NumLines)
+      MinLines = Line - NumLines;
+  }
 
   const unsigned char *Buf = (const unsigned char *)Buffer->getBufferStart();
   const unsigned char *End = (const unsigned char *)Buffer->getBufferEnd();
-  unsigned Offs = 0;
-  while (1) {
-    // Skip over the contents of the line.
-    const unsigned char *NextBuf = (const unsigned char *)Buf;
-
-#ifdef __SSE2__
-    // Try to skip to the next newline using SSE instructions. This is very
-    // performance sensitive for programs with lots of diagnostics and in -E
-    // mode.
-    __m128i CRs = _mm_set1_epi8('\r');
-    __m128i LFs = _mm_set1_epi8('\n');
-
-    // First fix up the alignment to 16 bytes.
-    while (((uintptr_t)NextBuf & 0xF) != 0) {
-      if (*NextBuf == '\n' || *NextBuf == '\r' || *NextBuf == '\0')
-        goto FoundSpecialChar;
-      ++NextBuf;
-    }
-
-    // Scan 16 byte chunks for '\r' and '\n'. Ignore '\0'.
-    while (NextBuf+16 <= End) {
-      const __m128i Chunk = *(const __m128i*)NextBuf;
-      __m128i Cmp = _mm_or_si128(_mm_cmpeq_epi8(Chunk, CRs),
-                                 _mm_cmpeq_epi8(Chunk, LFs));
-      unsigned Mask = _mm_movemask_epi8(Cmp);
-
-      // If we found a newline, adjust the pointer and jump to the handling code.
-      if (Mask != 0) {
-        NextBuf += llvm::countTrailingZeros(Mask);
-        goto FoundSpecialChar;
-      }
-      NextBuf += 16;
-    }
-#endif
-
-    while (*NextBuf != '\n' && *NextBuf != '\r' && *NextBuf != '\0')
-      ++NextBuf;
-
-#ifdef __SSE2__
-FoundSpecialChar:
-#endif
-    Offs += NextBuf-Buf;
-    Buf = NextBuf;
-
-    if (Buf[0] == '\n' || Buf[0] == '\r') {
-      // If this is \n\r or \r\n, skip both characters.
-      if ((Buf[1] == '\n' || Buf[1] == '\r') && Buf[0] != Buf[1])
-        ++Offs, ++Buf;
-      ++Offs, ++Buf;
-      LineOffsets.push_back(Offs);
-    } else {
-      // Otherwise, this is a null.  If end of file, exit.
-      if (Buf == End) break;
-      // Otherwise, skip the null.
-      ++Offs, ++Buf;
-    }
+  bool Complete = FindLineStarts(Buf, End, Offs, StopOffs, MinLines,
+                                 LineOffsets);
+
+  // Copy the offsets into the FileInfo structure, growing the table
+  // geometrically while it is still incomplete.
+  unsigned NewNumLines = NumLines + LineOffsets.size();
+  if (NewNumLines > FI->LineTableCapacity) {
+    unsigned Capacity = NewNumLines;
+    if (!Complete)
+      Capacity = std::max(Capacity, 2 * FI->LineTableCapacity);
+    unsigned *NewCache = Alloc.Allocate<unsigned>(Capacity);
+    std::copy(FI->SourceLineCache, FI->SourceLineCache + NumLines, NewCache);
+    FI->SourceLineCache = NewCache;
+    FI->LineTableCapacity = Capacity;
   }
-
-  // Copy the offsets into the FileInfo structure.
-  FI->NumLines = LineOffsets.size();
-  FI->SourceLineCache = Alloc.Allocate<unsigned>(LineOffsets.size());
-  std::copy(LineOffsets.begin(), LineOffsets.end(), FI->SourceLineCache);
+  std::copy(LineOffsets.begin(), LineOffsets.end(),
+            FI->SourceLineCache + NumLines);
+  FI->NumLines = NewNumLines;
+  FI->LineTableComplete = Complete;
 }
 
 /// getLineNumber - Given a SourceLocation, return the spelling line number
@@ -1321,11 +1384,13 @@ unsigned SourceManager::getLineNumber(FileID FID, unsigned FilePos,
     Content = const_cast<ContentCache*>(Entry.getFile().getContentCache());
   }
   
-  // If this is the first use of line information for this buffer, compute the
-  /// SourceLineCache for it on demand.
-  if (Content->SourceLineCache == 0) {
+  // If this is the first use of line information for this buffer, or the
+  // first past the lines found so far, compute the SourceLineCache for it on
+  // demand.
+  if (NeedsMoreLines(Content, FilePos, 0)) {
     bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid,
+                       FilePos, 0, IncrementalLineTables);
     if (Invalid)
       *Invalid = MyInvalid;
     if (MyInvalid)
@@ -1748,11 +1813,13 @@ SourceLocation SourceManager::translateLineCol(FileID FID,
   if (!Content)
     return SourceLocation();
 
-  // If this is the first use of line information for this buffer, compute the
-  // SourceLineCache for it on demand.
-  if (Content->SourceLineCache == 0) {
+  // If this is the first use of line information for this buffer, or the
+  // first past the lines found so far, compute the SourceLineCache for it on
+  // demand.
+  if (NeedsMoreLines(Content, 0, Line)) {
     bool MyInvalid = false;
-    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid);
+    ComputeLineNumbers(Diag, Content, ContentCacheAlloc, *this, MyInvalid,
+                       0, Line, IncrementalLineTables);
     if (MyInvalid)
       return SourceLocation();
   }
@@ -24,6 +24,8 @@
 #include "llvm/PassManager.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/Timer.h"
@@ -336,6 +338,12 @@ void EmitAssemblyHelper::CreatePasses(TargetMachine *TM) {
   PMBuilder.populateModulePassManager(*MPM);
 }
 
+/// Guards the process-wide state that CreateTargetMachine sets up.
+static llvm::ManagedStatic<llvm::sys::Mutex> BackendSetupLock;
+
+/// The backend options most recently handed to the LLVM option parser.
+static llvm::ManagedStatic<std::vector<std::string> > ParsedBackendArgs;
+
 TargetMachine *EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
   // Create the TargetMachine for generating code.
   std::string Error;
@@ -349,7 +357,9 @@ TargetMachine *EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
 
   // FIXME: Expose these capabilities via actual APIs!!!! Aside from just
   // being gross, this is also totally broken if we ever care about
-  // concurrency.
+  // concurrency.  Until then, compilers running on several threads of one
+  // process at least take turns at it.
+  llvm::sys::ScopedLock Guard(*BackendSetupLock);
 
   TargetMachine::setAsmVerbosityDefault(CodeGenOpts.AsmVerbose);
 
@@ -388,8 +398,17 @@ TargetMachine *EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
   if (CodeGenOpts.NoGlobalMerge)
     BackendArgs.push_back("-global-merge=false");
   BackendArgs.push_back(0);
-  llvm::cl::ParseCommandLineOptions(BackendArgs.size() - 1,
-                                    BackendArgs.data());
+
+  // The options keep their values, and count their occurrences, from one
+  // parse to the next; parsing the same ones again for the next compile in
+  // this process would only fail with "may only occur zero or one times".
+  std::vector<std::string> Parsed(BackendArgs.begin() + 1,
+                                  BackendArgs.end() - 1);
+  if (Parsed != *ParsedBackendArgs) {
+    llvm::cl::ParseCommandLineOptions(BackendArgs.size() - 1,
+                                      BackendArgs.data());
+    ParsedBackendArgs->swap(Parsed);
+  }
 
   std::string FeaturesStr;
   if (TargetOpts.Features.size()) {
@@ -412,12 +431,7 @@ TargetMachine *EmitAssemblyHelper::CreateTargetMachine(bool MustCreateTM) {
     RM = llvm::Reloc::DynamicNoPIC;
   }
 
-  CodeGenOpt::Level OptLevel = CodeGenOpt::Default;
-  switch (CodeGenOpts.OptimizationLevel) {
-  default: break;
-  case 0: OptLevel = CodeGenOpt::None; break;
-  case 3: OptLevel = CodeGenOpt::Aggressive; break;
-  }
+  CodeGenOpt::Level OptLevel = getCodeGenOptLevel(CodeGenOpts);
 
   llvm::TargetOptions Options;
 
@@ -588,6 +602,14 @@ void EmitAssemblyHelper::EmitAssembly(BackendAction Action, raw_ostream *OS) {
   }
 }
 
+CodeGenOpt::Level clang::getCodeGenOptLevel(const CodeGenOptions &CGOpts) {
+  switch (CGOpts.OptimizationLevel) {
+  default: return CodeGenOpt::Default;
+  case 0: return CodeGenOpt::None;
+  case 3: return CodeGenOpt::Aggressive;
+  }
+}
+
 void clang::EmitBackendOutput(DiagnosticsEngine &Diags,
                               const CodeGenOptions &CGOpts,
                               const clang::TargetOptions &TOpts,
@@ -14,14 +14,103 @@
 //
 #include <dlfcn.h>
 
+#include "clang/CodeGen/ObjCJitRuntimeStats.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/Verifier.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Mutex.h"
 
 // Macro to clean up function dynamic load statements
 //
 #define LOAD_FN(fn, fn_name) *(void**)(&fn) = dlsym(RTLD_DEFAULT, fn_name)
 
+// Host runtime functions called at code generation time; calls to them are
+// counted for clang::getObjCJitRuntimeCallCounts().
+//
+#define OBJC_JIT_RUNTIME_FUNCTIONS(X)                                      \
+  X(objc_getClass) X(objc_allocateClassPair) X(objc_registerClassPair)     \
+  X(objc_getProtocol) X(object_getClass) X(sel_registerName)               \
+  X(class_getClassVariable) X(class_addIvar) X(class_addProtocol)          \
+  X(class_getMethodImplementation) X(ivar_getOffset)                       \
+  X(NSGetSizeAndAlignment) X(objc_msg_lookup)
+
 namespace {
 
+enum ObjCJitRuntimeCall {
+#define OBJC_JIT_RUNTIME_ENUMERATOR(Name) ObjCJitCall_##Name,
+  OBJC_JIT_RUNTIME_FUNCTIONS(OBJC_JIT_RUNTIME_ENUMERATOR)
+#undef OBJC_JIT_RUNTIME_ENUMERATOR
+  NumObjCJitRuntimeCalls
+};
+
+const char *const ObjCJitRuntimeCallNames[] = {
+#define OBJC_JIT_RUNTIME_NAME(Name) #Name,
+  OBJC_JIT_RUNTIME_FUNCTIONS(OBJC_JIT_RUNTIME_NAME)
+#undef OBJC_JIT_RUNTIME_NAME
+};
+
+llvm::sys::cas_flag ObjCJitRuntimeCallCounts[NumObjCJitRuntimeCalls];
+
+/// ObjCJitRuntimeFunction - A host runtime function, looked up with dlsym,
+/// that is called while generating code.  Calls go through the conversion to
+/// the function pointer type, which counts them.
+template <typename FnTy>
+class ObjCJitRuntimeFunction {
+  FnTy Fn;
+  ObjCJitRuntimeCall Which;
+public:
+  ObjCJitRuntimeFunction() : Fn(0), Which(NumObjCJitRuntimeCalls) {}
+
+  void load(ObjCJitRuntimeCall Function) {
+    Which = Function;
+    LOAD_FN(Fn, ObjCJitRuntimeCallNames[Function]);
+  }
+
+  bool isAvailable() const { return Fn != 0; }
+
+  operator FnTy() const {
+    llvm::sys::AtomicIncrement(&ObjCJitRuntimeCallCounts[Which]);
+    return Fn;
+  }
+};
+
+/// ObjCJitStringPool - The NSString objects created for string literals.
+/// They are shared by every module generated in the process, so equal
+/// literals, in one module or across modules, get one object.  Entries are
+/// keyed by the literal's bytes prefixed with 'N' (UTF-8) or 'W' (wide), and
+/// stay alive until every module using them is released with
+/// clang::releaseObjCJitConstantStrings(), or until
+/// clang::clearObjCJitConstantStrings().
+struct ObjCJitStringPool {
+  typedef void* (*ReleaseImpTy)(void*, void*, ...);
+
+  struct Entry {
+    void *Object;
+    ReleaseImpTy ReleaseImp;
+    void *ReleaseSel;
+    /// The modules whose code refers to Object.
+    llvm::SmallPtrSet<const llvm::Module *, 2> Users;
+    Entry() : Object(0), ReleaseImp(0), ReleaseSel(0) {}
+
+    void release() { ReleaseImp(Object, ReleaseSel); }
+  };
+
+  llvm::sys::Mutex Lock;
+  llvm::StringMap<Entry> Strings;
+  /// The keys of the strings each module uses.
+  llvm::DenseMap<const llvm::Module *, std::vector<std::string> > ModuleKeys;
+  uint64_t Lookups;
+  uint64_t Hits;
+  uint64_t Bytes;
+
+  ObjCJitStringPool() : Lookups(0), Hits(0), Bytes(0) {}
+};
+
+llvm::ManagedStatic<ObjCJitStringPool> StringPool;
+
 /// Class that lazily initialises the runtime function.  Avoids inserting the
 /// types and the function declaration into a module if they're not used, and
 /// avoids constructing the type more than once if it's used more than once.
@@ -82,6 +171,155 @@ public:
 
 };
 
+/// Return a constant of type \p Ty holding the host address \p Ptr.  The JIT
+/// runtime runs generated code in the compiler's own process, so host
+/// addresses can be baked directly into the IR.
+static llvm::Constant *GetHostPointer(llvm::Type *Ty, const void *Ptr) {
+  return llvm::Constant::getIntegerValue(Ty,
+                                         llvm::APInt(sizeof(void*) * 8,
+                                                     (uint64_t)(intptr_t)Ptr));
+}
+
+/// ObjCJitCacheEntry - A resolved (class, IMP) pair for one selector.  Entries
+/// are never modified once published, so a send site only ever swaps a single
+/// pointer and can never observe a torn pair.
+struct ObjCJitCacheEntry {
+  llvm::sys::cas_flag Generation;
+  void *Class;
+  void *Imp;
+};
+
+/// Number of polymorphic entries kept by each send site behind the
+/// monomorphic one.
+enum { ObjCJitSendCachePolySize = 4 };
+
+/// ObjCJitSendCache - Per-call-site message send cache.  The monomorphic
+/// entry is checked inline by the generated code; the polymorphic entries are
+/// only consulted by ObjCJitSendCacheMiss().
+struct ObjCJitSendCache {
+  ObjCJitCacheEntry *Mono;
+  ObjCJitCacheEntry *Poly[ObjCJitSendCachePolySize];
+};
+
+/// ObjCJitSendCacheRuntime - Process-wide state shared by all inline caches.
+/// Caches are invalidated wholesale by bumping Generation whenever JITed code
+/// adds or replaces a method; entries from older generations never match.
+class ObjCJitSendCacheRuntime {
+  typedef void *(*LookupFn)(void *, void *);
+  typedef std::pair<void*, void*> ClassSelPair;
+
+  llvm::sys::Mutex Lock;
+  llvm::BumpPtrAllocator Allocator;
+  llvm::DenseMap<ClassSelPair, ObjCJitCacheEntry*> Entries;
+
+public:
+  /// Current cache generation.  Starts at 1 so that zero-initialized and empty
+  /// entries never match.
+  volatile llvm::sys::cas_flag Generation;
+
+  /// Entry that every send site points at before its first lookup.
+  ObjCJitCacheEntry EmptyEntry;
+
+  LookupFn MsgLookup;
+  LookupFn GetMethodImplementation;
+
+  ObjCJitSendCacheRuntime() : Generation(1), MsgLookup(0),
+                              GetMethodImplementation(0) {
+    EmptyEntry.Generation = 0;
+    EmptyEntry.Class = 0;
+    EmptyEntry.Imp = 0;
+    LOAD_FN(MsgLookup, "objc_msg_lookup");
+    LOAD_FN(GetMethodImplementation, "class_getMethodImplementation");
+  }
+
+  void invalidate() {
+    llvm::sys::AtomicIncrement(&Generation);
+  }
+
+  void *lookup(void *Receiver, void *Class, void *Sel) {
+    // GNU runtime workaround; see CGObjCJit::EmitMessageSend.
+    if (MsgLookup)
+      return MsgLookup(Receiver, Sel);
+    return GetMethodImplementation(Class, Sel);
+  }
+
+  /// Return the shared entry for (Class, Sel) in generation Gen.  Entries from
+  /// retired generations stay allocated, since other sites may still be
+  /// looking at them.
+  ObjCJitCacheEntry *getEntry(void *Class, void *Sel, void *Imp,
+                              llvm::sys::cas_flag Gen) {
+    llvm::sys::ScopedLock Guard(Lock);
+    ObjCJitCacheEntry *&Entry = Entries[std::make_pair(Class, Sel)];
+    if (!Entry || Entry->Generation != Gen || Entry->Imp != Imp) {
+      Entry = Allocator.Allocate<ObjCJitCacheEntry>();
+      Entry->Generation = Gen;
+      Entry->Class = Class;
+      Entry->Imp = Imp;
+    }
+    return Entry;
+  }
+};
+
+static llvm::ManagedStatic<ObjCJitSendCacheRuntime> SendCacheRuntime;
+
+/// Slow path of an inline-cached message send, called from JITed code when
+/// the site's monomorphic entry is stale or names another class.
+static void *ObjCJitSendCacheMiss(ObjCJitSendCache *Cache, void *Receiver,
+                                  void *Class, void *Sel) {
+  ObjCJitSendCacheRuntime &Runtime = *SendCacheRuntime;
+  llvm::sys::cas_flag Gen = Runtime.Generation;
+
+  for (unsigned i = 0; i != ObjCJitSendCachePolySize; ++i) {
+    ObjCJitCacheEntry *Entry = Cache->Poly[i];
+    if (Entry->Generation == Gen && Entry->Class == Class) {
+      Cache->Mono = Entry;
+      return Entry->Imp;
+    }
+  }
+
+  void *Imp = Runtime.lookup(Receiver, Class, Sel);
+  // Sends to nil have no class to key on.
+  if (!Class || !Imp)
+    return Imp;
+
+  ObjCJitCacheEntry *Entry = Runtime.getEntry(Class, Sel, Imp, Gen);
+  unsigned Slot = ((uintptr_t)Class >> 4) % ObjCJitSendCachePolySize;
+  Cache->Poly[Slot] = Entry;
+  llvm::sys::MemoryFence();
+  Cache->Mono = Entry;
+  return Imp;
+}
+
+/// Called from JITed code after it changes the method list of a class.
+static void ObjCJitInvalidateSendCaches() {
+  SendCacheRuntime->invalidate();
+}
+
+/// ObjCJitMethodRecord - One method to be added to a class when a module is
+/// initialized.  CGObjCJit emits a table of these per module, registered by a
+/// single call to ObjCJitRegisterMethods() from .objc_jit_init.
+struct ObjCJitMethodRecord {
+  void *Class;
+  void *Sel;
+  void *Imp;
+  const char *Types;
+};
+
+/// Called from .objc_jit_init with the module's method table.
+static void ObjCJitRegisterMethods(const ObjCJitMethodRecord *Records,
+                                   uintptr_t NumRecords) {
+  char (*AddMethod)(void *, void *, void *, const char *);
+  LOAD_FN(AddMethod, "class_addMethod");
+  for (uintptr_t i = 0; i != NumRecords; ++i)
+    AddMethod(Records[i].Class, Records[i].Sel, Records[i].Imp,
+              Records[i].Types);
+
+  // Send sites in earlier modules may have cached what these methods
+  // override.
+  if (SendCacheRuntime.isConstructed())
+    SendCacheRuntime->invalidate();
+}
+
 /// CGObjCJit
 ///
 class CGObjCJit : public CGObjCRuntime {
@@ -103,14 +341,23 @@ private: // data
 
   llvm::Type *ImpPtrTy;
 
+  // Inline cache support, only set up when -fobjc-jit-inline-caches is given.
+  bool UseInlineCaches;
+  llvm::StructType *CacheEntryTy;
+  llvm::StructType *SendCacheTy;
+
   llvm::Function *JitInitFunction;
   llvm::BasicBlock *JitInitBlock;
-  std::set<std::string> MethodTypeStrings;
+
+  // MethodRecords - entries of the module's method table, one
+  // struct._objc_jit_method (see ObjCJitMethodRecord) per method, registered
+  // all at once by .objc_jit_init.
+  llvm::StructType *MethodRecordTy;
+  SmallVector<llvm::Constant*, 32> MethodRecords;
 
   LazyRuntimeFunction fn_objc_getClass;
   LazyRuntimeFunction fn_objc_getMetaClass;
   LazyRuntimeFunction fn_objc_getProtocol;
-  LazyRuntimeFunction fn_class_addMethod;
   LazyRuntimeFunction fn_class_replaceMethod;
   LazyRuntimeFunction fn_class_getMethodImplementation;
   LazyRuntimeFunction fn_object_getClass;
@@ -122,6 +369,12 @@ private: // data
   // this translation unit.
   llvm::DenseMap<const ObjCMethodDecl*, llvm::Function*> MethodDefinitions;
 
+  // ClassReferences/MetaClassReferences - lazily resolved references to
+  // classes that were not yet registered with the runtime when first used,
+  // keyed by class name.
+  llvm::StringMap<llvm::GlobalVariable*> ClassReferences;
+  llvm::StringMap<llvm::GlobalVariable*> MetaClassReferences;
+
   // Protocols - map of protocols not registered with the runtime.
   llvm::StringMap<void*> DefinedProtocols;
 
@@ -133,6 +386,7 @@ private: // data
   void  *allocSel;
   void  *stringInitSel;
   void  *wideStringInitSel;
+  void  *releaseSel;
   _imp_t stringAlloc_imp;
   void  *defaultCollector;
   void  *disableCollectorSel;
@@ -143,26 +397,35 @@ protected: // methods
   // Native ObjC runtine APIs, referenced dynamically. This avoid clang having
   // to be built with objective-c runtime frameworks/libs.
   //
-  void* (*_objc_getClass)(const char *);
-  void* (*_objc_allocateClassPair)(void*, const char *, size_t);
-  void (*_objc_registerClassPair)(void*);
-  void* (*_objc_getProtocol)(const char *);
-  void* (*_object_getClass)(void *);
-  void* (*_sel_registerName)(const char*);
-  void* (*_class_getClassVariable)(void*, const char*);
-  char(*_class_addIvar)(void*, const char *, size_t, uint8_t, const char *);
-  void* (*_class_addProtocol)(void *, void *);
-  _imp_t(*_class_getMethodImplementation)(void*, void*);
-  ptrdiff_t (*_ivar_getOffset)(void*);
-  const char* (*_NSGetSizeAndAlignment)
-  (const char*, unsigned long *, unsigned long*);
+  ObjCJitRuntimeFunction<void* (*)(const char *)> _objc_getClass;
+  ObjCJitRuntimeFunction<void* (*)(void*, const char *, size_t)>
+    _objc_allocateClassPair;
+  ObjCJitRuntimeFunction<void (*)(void*)> _objc_registerClassPair;
+  ObjCJitRuntimeFunction<void* (*)(const char *)> _objc_getProtocol;
+  ObjCJitRuntimeFunction<void* (*)(void *)> _object_getClass;
+  ObjCJitRuntimeFunction<void* (*)(const char*)> _sel_registerName;
+  ObjCJitRuntimeFunction<void* (*)(void*, const char*)>
+    _class_getClassVariable;
+  ObjCJitRuntimeFunction<char (*)(void*, const char *, size_t, uint8_t,
+                                  const char *)> _class_addIvar;
+  ObjCJitRuntimeFunction<void* (*)(void *, void *)> _class_addProtocol;
+  ObjCJitRuntimeFunction<_imp_t (*)(void*, void*)>
+    _class_getMethodImplementation;
+  ObjCJitRuntimeFunction<ptrdiff_t (*)(void*)> _ivar_getOffset;
+  ObjCJitRuntimeFunction<const char* (*)(const char*, unsigned long *,
+                                         unsigned long*)>
+    _NSGetSizeAndAlignment;
 
   // GNU runtime workaround
-  _imp_t (*_objc_msg_lookup)(void *, void *);
+  ObjCJitRuntimeFunction<_imp_t (*)(void *, void *)> _objc_msg_lookup;
 
-  llvm::Value *GetMetaClass(CGBuilderTy &Builder,
+  llvm::Value *GetMetaClass(CodeGenFunction &CGF,
                             const ObjCInterfaceDecl *ID);
 
+  llvm::Value *EmitClassRef(CodeGenFunction &CGF,
+                            const ObjCInterfaceDecl *ID,
+                            bool isMetaClass);
+
   CodeGen::RValue EmitMessageSend(CodeGen::CodeGenFunction &CGF,
                                   ReturnValueSlot Return,
                                   QualType ResultType,
@@ -170,10 +433,20 @@ protected: // methods
                                   llvm::Value *Receiver,
                                   llvm::Value *ReceiverClass,
                                   const CallArgList &CallArgs,
-                                  const ObjCMethodDecl *Method);
+                                  const ObjCMethodDecl *Method,
+                                  bool UseCache = false);
+
+  llvm::Value *EmitCachedImpLookup(CodeGen::CodeGenFunction &CGF,
+                                   llvm::Value *Receiver,
+                                   llvm::Value *ReceiverClass,
+                                   llvm::Value *Sel);
+
+  void EmitSendCacheInvalidation();
 
   void AddMethodsToClass(void *theClass);
 
+  void EmitMethodTable(CGBuilderTy &Builder);
+
   void AddIvarsToClass(void *theClass,
                        const ivar_iterator& ivar_begin,
                        const ivar_iterator& ivar_end);
@@ -322,6 +595,9 @@ CGObjCJit::CGObjCJit(CodeGen::CodeGenModule &cgm)
     CGM(cgm),
     VMContext(cgm.getLLVMContext()),
     ObjCTypes(cgm),
+    UseInlineCaches(false),
+    CacheEntryTy(0),
+    SendCacheTy(0),
     JitInitFunction(0) {
 
   //puts("Constructing CGObjCJit (host runtime proxy)");
@@ -332,22 +608,23 @@ CGObjCJit::CGObjCJit(CodeGen::CodeGenModule &cgm)
   NULLPtr = llvm::ConstantPointerNull::get(PtrToInt8Ty);
 
   // TODO: For now, just searching for pre-loaded objc runtime
-  LOAD_FN(_objc_getClass, "objc_getClass");
+  _objc_getClass.load(ObjCJitCall_objc_getClass);
 
   // Don't bother to try the rest if the first one wasn't available
-  if (_objc_getClass) {
+  if (_objc_getClass.isAvailable()) {
     isUsable = true;
-    LOAD_FN(_objc_allocateClassPair,        "objc_allocateClassPair");
-    LOAD_FN(_objc_registerClassPair,        "objc_registerClassPair");
-    LOAD_FN(_objc_getProtocol,              "objc_getProtocol");
-    LOAD_FN(_object_getClass,               "object_getClass");
-    LOAD_FN(_sel_registerName,              "sel_registerName");
-    LOAD_FN(_class_getClassVariable,        "class_getClassVariable");
-    LOAD_FN(_class_addIvar,                 "class_addIvar");
-    LOAD_FN(_class_addProtocol,             "class_addProtocol");
-    LOAD_FN(_class_getMethodImplementation, "class_getMethodImplementation");
-    LOAD_FN(_ivar_getOffset,                "ivar_getOffset");
-    LOAD_FN(_NSGetSizeAndAlignment,         "NSGetSizeAndAlignment");
+    _objc_allocateClassPair.load(ObjCJitCall_objc_allocateClassPair);
+    _objc_registerClassPair.load(ObjCJitCall_objc_registerClassPair);
+    _objc_getProtocol.load(ObjCJitCall_objc_getProtocol);
+    _object_getClass.load(ObjCJitCall_object_getClass);
+    _sel_registerName.load(ObjCJitCall_sel_registerName);
+    _class_getClassVariable.load(ObjCJitCall_class_getClassVariable);
+    _class_addIvar.load(ObjCJitCall_class_addIvar);
+    _class_addProtocol.load(ObjCJitCall_class_addProtocol);
+    _class_getMethodImplementation.load(
+      ObjCJitCall_class_getMethodImplementation);
+    _ivar_getOffset.load(ObjCJitCall_ivar_getOffset);
+    _NSGetSizeAndAlignment.load(ObjCJitCall_NSGetSizeAndAlignment);
 
     //puts("Creating .objc_jit_init()");
     llvm::FunctionType *initFuncType =
@@ -359,6 +636,9 @@ CGObjCJit::CGObjCJit(CodeGen::CodeGenModule &cgm)
                                                initFuncType));
     JitInitFunction->setLinkage(llvm::Function::PrivateLinkage);
     JitInitFunction->setCallingConv(llvm::CallingConv::C);
+    // Nothing in the module calls it; keep GlobalDCE from removing it when
+    // the module is optimized.
+    CGM.AddUsedGlobal(JitInitFunction);
     JitInitBlock =
       llvm::BasicBlock::Create(VMContext, "entry", JitInitFunction);
 
@@ -385,21 +665,20 @@ CGObjCJit::CGObjCJit(CodeGen::CodeGenModule &cgm)
                             ObjCTypes.ObjectPtrTy,
                             NULL);
 
-    // Define VM class_addMethod and class_replaceMethod function calls for
-    // the init function
+    // Define the method table record and VM class_replaceMethod function
+    // call for the init function
 
     llvm::Type *ImpParams[] = {ObjCTypes.ObjectPtrTy, ObjCTypes.SelectorPtrTy};
     ImpPtrTy = llvm::FunctionType::get(ObjCTypes.ObjectPtrTy,
                                        ImpParams,
                                        false)->getPointerTo();
 
-    fn_class_addMethod.init(&CGM, "class_addMethod",
-                            llvm::Type::getInt8Ty(VMContext),
-                            ObjCTypes.ClassPtrTy,
-                            ObjCTypes.SelectorPtrTy,
-                            ImpPtrTy,
-                            ObjCTypes.Int8PtrTy,
-                            NULL);
+    MethodRecordTy = llvm::StructType::create("struct._objc_jit_method",
+                                              ObjCTypes.Int8PtrTy,
+                                              ObjCTypes.Int8PtrTy,
+                                              ObjCTypes.Int8PtrTy,
+                                              ObjCTypes.Int8PtrTy,
+                                              NULL);
 
     fn_class_replaceMethod.init(&CGM, "class_replaceMethod",
                                 llvm::Type::getInt8Ty(VMContext),
@@ -419,9 +698,9 @@ CGObjCJit::CGObjCJit(CodeGen::CodeGenModule &cgm)
     // the GNU runtime, it doesn't work on a class unless objc_msg_lookup was
     // called first.
     //
-    LOAD_FN(_objc_msg_lookup, "objc_msg_lookup");
+    _objc_msg_lookup.load(ObjCJitCall_objc_msg_lookup);
 
-    if (_objc_msg_lookup) {
+    if (_objc_msg_lookup.isAvailable()) {
       fn_objc_msg_lookup.init(&CGM, "objc_msg_lookup",
                               ImpPtrTy,
                               ObjCTypes.ClassPtrTy,
@@ -434,6 +713,24 @@ CGObjCJit::CGObjCJit(CodeGen::CodeGenModule &cgm)
     ProtocolIsaPointer = *((void**)sampleProtocol);
 
     InitConstantStringGenerator();
+
+    // Per-call-site inline caches; see ObjCJitSendCache.
+    if (CGM.getCodeGenOpts().ObjCJitInlineCaches) {
+      UseInlineCaches = true;
+      llvm::Type *GenerationTy =
+        llvm::IntegerType::get(VMContext, sizeof(llvm::sys::cas_flag) * 8);
+      CacheEntryTy = llvm::StructType::create("struct._objc_jit_cache_entry",
+                                              GenerationTy,
+                                              ObjCTypes.Int8PtrTy,
+                                              ObjCTypes.Int8PtrTy,
+                                              NULL);
+      llvm::Type *EntryPtrTy = CacheEntryTy->getPointerTo();
+      SendCacheTy = llvm::StructType::create("struct._objc_jit_send_cache",
+                                             EntryPtrTy,
+                                             llvm::ArrayType::get(EntryPtrTy,
+                                                  ObjCJitSendCachePolySize),
+                                             NULL);
+    }
   }
 }
 
@@ -442,7 +739,26 @@ llvm::Function *CGObjCJit::ModuleInitFunction() {
   if (isUsable) {
     // Finalize the init function
     CGBuilderTy RetBuilder(JitInitBlock);
+    EmitMethodTable(RetBuilder);
     RetBuilder.CreateRetVoid();
+
+    // Classes implemented later in the translation unit have been registered
+    // by now; give their references an initial value so that the lookup at
+    // the first use is skipped.
+    for (llvm::StringMap<llvm::GlobalVariable*>::iterator
+           I = ClassReferences.begin(), E = ClassReferences.end(); I != E; ++I)
+      if (void *theClass = _objc_getClass(I->getKey().str().c_str()))
+        I->getValue()->setInitializer(
+          GetHostPointer(ObjCTypes.ClassPtrTy, theClass));
+    for (llvm::StringMap<llvm::GlobalVariable*>::iterator
+           I = MetaClassReferences.begin(), E = MetaClassReferences.end();
+         I != E; ++I)
+      if (void *theClass = _objc_getClass(I->getKey().str().c_str()))
+        I->getValue()->setInitializer(
+          GetHostPointer(ObjCTypes.ClassPtrTy, _object_getClass(theClass)));
+
+    if (UseInlineCaches)
+      EmitSendCacheInvalidation();
 //    llvm::verifyFunction(*JitInitFunction);
   }
   return NULL;
@@ -476,6 +792,23 @@ llvm::Constant *CGObjCJit::GetEHType(QualType T) {
 /// Not really a constant string; can be explicitly released...
 llvm::Constant *CGObjCJit::GenerateConstantString(const StringLiteral *SL) {
   if (isUsable && stringClass) {
+    SmallString<64> Key;
+    Key += SL->isWide() ? 'W' : 'N';
+    Key += SL->getBytes();
+
+    llvm::sys::ScopedLock Guard(StringPool->Lock);
+    ++StringPool->Lookups;
+    ObjCJitStringPool::Entry &Pooled = StringPool->Strings[Key];
+    const llvm::Module *M = &CGM.getModule();
+    if (Pooled.Users.insert(M))
+      StringPool->ModuleKeys[M].push_back(Key.str());
+    if (Pooled.Object) {
+      ++StringPool->Hits;
+      return llvm::Constant::getIntegerValue(ObjCTypes.ObjectPtrTy,
+                                             llvm::APInt(sizeof(void*) * 8,
+                                                 (uint64_t)Pooled.Object));
+    }
+
     void *stringInstance = stringAlloc_imp(stringClass, allocSel);
     const llvm::StringRef& literalStringRef(SL->getString());
 
@@ -508,7 +841,17 @@ llvm::Constant *CGObjCJit::GenerateConstantString(const StringLiteral *SL) {
                            stringInstance);
     }
 
-    // TODO: save string objects to a list?
+    // Remember how to release it: the class of an initialized string may
+    // be any member of the class cluster.
+    Pooled.Object = stringInstance;
+    Pooled.ReleaseSel = releaseSel;
+    if (_objc_msg_lookup.isAvailable())
+      Pooled.ReleaseImp = _objc_msg_lookup(stringInstance, releaseSel);
+    else
+      Pooled.ReleaseImp =
+        _class_getMethodImplementation(_object_getClass(stringInstance),
+                                       releaseSel);
+    StringPool->Bytes += SL->getByteLength();
 
     return llvm::Constant::getIntegerValue(ObjCTypes.ObjectPtrTy,
                                            llvm::APInt(sizeof(void*) * 8,
@@ -597,14 +940,14 @@ CGObjCJit::GenerateMessageSend(CodeGen::CodeGenFunction &CGF,
       CGF.Builder.CreateBitCast(Receiver, ObjCTypes.ObjectPtrTy);
   llvm::Value *ReceiverClass;
   if (Class) {
-    ReceiverClass = GetMetaClass(CGF.Builder, Class);
+    ReceiverClass = GetMetaClass(CGF, Class);
   } else {
     ReceiverClass = CGF.Builder.CreateCall(fn_object_getClass, ReceiverObj);
   }
 
   return EmitMessageSend(CGF, Return, ResultType, Sel,
                          ReceiverObj, ReceiverClass,
-                         CallArgs, Method);
+                         CallArgs, Method, UseInlineCaches);
 }
 
 
@@ -624,7 +967,7 @@ CGObjCJit::GenerateMessageSendSuper(CodeGen::CodeGenFunction &CGF,
     if (isCategoryImpl) {
       ReceiverClass = GetClass(CGF, Class);
     } else {
-      ReceiverClass = GetMetaClass(CGF.Builder, Class);
+      ReceiverClass = GetMetaClass(CGF, Class);
     }
   else {
     ReceiverClass = GetClass(CGF, Class->getSuperClass());
@@ -648,6 +991,10 @@ llvm::Value *CGObjCJit::GenerateProtocolRef(CodeGenFunction &CGF,
           llvm::Constant::getIntegerValue(ObjCTypes.ProtocolPtrTy,
                                           llvm::APInt(sizeof(void*) * 8,
                                                       (uint64_t)it->second));
+    } else if (void *Registered =
+                 _objc_getProtocol(PD->getIdentifier()->getNameStart())) {
+      // Registered protocols never go away; bake them in like classes.
+      theProtocol = GetHostPointer(ObjCTypes.ProtocolPtrTy, Registered);
     } else {
       llvm::Value *ProtocolName =
           CGF.Builder.CreateGlobalStringPtr(PD->getNameAsString());
@@ -742,11 +1089,8 @@ llvm::Constant *CGObjCJit::GetSetStructFunction() {
 
 llvm::Value *CGObjCJit::GetClass(CodeGenFunction &CGF,
                                  const ObjCInterfaceDecl *ID) {
-  if (isUsable) {
-    llvm::Value *ClassName =
-        CGF.Builder.CreateGlobalStringPtr(ID->getNameAsString());
-    return CGF.Builder.CreateCall(fn_objc_getClass, ClassName);
-  }
+  if (isUsable)
+    return EmitClassRef(CGF, ID, false);
   return 0;
 }
 
@@ -970,17 +1314,63 @@ llvm::Constant *CGObjCJit::BuildGCBlockLayout(CodeGenModule &CGM,
 // Protected methods
 
 
-llvm::Value *CGObjCJit::GetMetaClass(CGBuilderTy &Builder,
+llvm::Value *CGObjCJit::GetMetaClass(CodeGenFunction &CGF,
                                      const ObjCInterfaceDecl *ID) {
-  if (isUsable) {
-    llvm::Value *ClassName =
-        Builder.CreateGlobalStringPtr(ID->getNameAsString());
-    return Builder.CreateCall(fn_objc_getMetaClass, ClassName);
-  }
+  if (isUsable)
+    return EmitClassRef(CGF, ID, true);
   return 0;
 }
 
 
+/// Return a reference to the class (or metaclass) \p ID.  Classes that are
+/// already registered are baked in as constants, the same way selectors are.
+/// Others go through a per-module reference that is resolved by name on first
+/// use and simply loaded after that.
+llvm::Value *CGObjCJit::EmitClassRef(CodeGenFunction &CGF,
+                                     const ObjCInterfaceDecl *ID,
+                                     bool isMetaClass) {
+  const char *ClassName = ID->getIdentifier()->getNameStart();
+  if (void *theClass = _objc_getClass(ClassName)) {
+    if (isMetaClass)
+      theClass = _object_getClass(theClass);
+    return GetHostPointer(ObjCTypes.ClassPtrTy, theClass);
+  }
+
+  llvm::GlobalVariable *&Ref =
+    (isMetaClass ? MetaClassReferences : ClassReferences)[ClassName];
+  if (!Ref)
+    Ref = new llvm::GlobalVariable(CGM.getModule(), ObjCTypes.ClassPtrTy,
+                                   false, llvm::GlobalValue::InternalLinkage,
+                                   llvm::Constant::getNullValue(
+                                     ObjCTypes.ClassPtrTy),
+                                   llvm::Twine(isMetaClass ?
+                                                 ".objc_jit_metaclass_ref." :
+                                                 ".objc_jit_class_ref.") +
+                                     ClassName);
+
+  CGBuilderTy &Builder = CGF.Builder;
+  llvm::Value *Cached = Builder.CreateLoad(Ref);
+  llvm::BasicBlock *CachedBB = Builder.GetInsertBlock();
+  llvm::BasicBlock *LookupBB = CGF.createBasicBlock("classref.lookup");
+  llvm::BasicBlock *ContBB = CGF.createBasicBlock("classref.cont");
+  Builder.CreateCondBr(Builder.CreateIsNull(Cached), LookupBB, ContBB);
+
+  CGF.EmitBlock(LookupBB);
+  llvm::Value *Name = Builder.CreateGlobalStringPtr(ClassName);
+  llvm::Value *Resolved =
+    Builder.CreateCall(isMetaClass ? fn_objc_getMetaClass : fn_objc_getClass,
+                       Name);
+  Builder.CreateStore(Resolved, Ref);
+  Builder.CreateBr(ContBB);
+
+  CGF.EmitBlock(ContBB);
+  llvm::PHINode *Class = Builder.CreatePHI(ObjCTypes.ClassPtrTy, 2);
+  Class->addIncoming(Cached, CachedBB);
+  Class->addIncoming(Resolved, LookupBB);
+  return Class;
+}
+
+
 //llvm::Value *CGObjCJit::EmitSuperClassRef(const ObjCInterfaceDecl *ID) {
 //  if (isUsable) {
 //    ObjCInterfaceDecl *superClassDecl =
@@ -1003,7 +1393,8 @@ CGObjCJit::EmitMessageSend(CodeGen::CodeGenFunction &CGF,
                            llvm::Value *Arg0,
                            llvm::Value *Arg0Class,
                            const CallArgList &CallArgs,
-                           const ObjCMethodDecl *Method) {
+                           const ObjCMethodDecl *Method,
+                           bool UseCache) {
 
   llvm::Value *Arg1 = GetSelector(CGF, Sel);
 
@@ -1020,14 +1411,16 @@ CGObjCJit::EmitMessageSend(CodeGen::CodeGenFunction &CGF,
   // Perform the following:
   //   imp = class_getMethodImplementation( Arg0Class, Arg1 );
   //   (*imp)( Arg0, Arg1, CallArgs );
-  llvm::CallInst *getImp;
+  llvm::Value *getImp;
 
   // Unfortunately, using the GNU runtime version of
   // class_getMethodImplementation and then calling the resulting
   // IMP doesn't work unless objc_msg_lookup was already
   // called first. TODO: avoid doing this every time
   //
-  if (fn_objc_msg_lookup.isValid()) {
+  if (UseCache) {
+    getImp = EmitCachedImpLookup(CGF, Arg0, Arg0Class, Arg1);
+  } else if (fn_objc_msg_lookup.isValid()) {
     getImp = CGF.Builder.CreateCall2(fn_objc_msg_lookup,
                                      Arg0,
                                      Arg1);
@@ -1043,13 +1436,134 @@ CGObjCJit::EmitMessageSend(CodeGen::CodeGenFunction &CGF,
 }
 
 
+/// Emit an inline-cached IMP lookup:
+///   entry = cache.Mono;
+///   if (entry->Generation == generation && entry->Class == ReceiverClass)
+///     imp = entry->Imp;
+///   else
+///     imp = ObjCJitSendCacheMiss(&cache, Receiver, ReceiverClass, Sel);
+llvm::Value *CGObjCJit::EmitCachedImpLookup(CodeGen::CodeGenFunction &CGF,
+                                            llvm::Value *Receiver,
+                                            llvm::Value *ReceiverClass,
+                                            llvm::Value *Sel) {
+  CGBuilderTy &Builder = CGF.Builder;
+  ObjCJitSendCacheRuntime &Runtime = *SendCacheRuntime;
+  llvm::Type *EntryPtrTy = CacheEntryTy->getPointerTo();
+
+  // Every site starts out pointing at the empty entry, which never matches.
+  llvm::Constant *Empty = GetHostPointer(EntryPtrTy, &Runtime.EmptyEntry);
+  std::vector<llvm::Constant*> PolyInit(ObjCJitSendCachePolySize, Empty);
+  llvm::Constant *Init =
+    llvm::ConstantStruct::get(SendCacheTy, Empty,
+                              llvm::ConstantArray::get(
+                                llvm::ArrayType::get(EntryPtrTy,
+                                                     ObjCJitSendCachePolySize),
+                                PolyInit),
+                              NULL);
+  llvm::GlobalVariable *Cache =
+    new llvm::GlobalVariable(CGM.getModule(), SendCacheTy, false,
+                             llvm::GlobalValue::InternalLinkage, Init,
+                             ".objc_jit_send_cache");
+
+  llvm::Value *GenerationPtr =
+    GetHostPointer(CacheEntryTy->getElementType(0)->getPointerTo(),
+                   (const void*)&Runtime.Generation);
+  llvm::Value *Class =
+    Builder.CreateBitCast(ReceiverClass, ObjCTypes.Int8PtrTy);
+
+  llvm::Value *Entry =
+    Builder.CreateLoad(Builder.CreateStructGEP(Cache, 0), true, "cache.entry");
+  llvm::Value *EntryGeneration =
+    Builder.CreateLoad(Builder.CreateStructGEP(Entry, 0));
+  llvm::Value *EntryClass = Builder.CreateLoad(Builder.CreateStructGEP(Entry, 1));
+  llvm::Value *Generation = Builder.CreateLoad(GenerationPtr, true);
+  llvm::Value *IsHit =
+    Builder.CreateAnd(Builder.CreateICmpEQ(EntryGeneration, Generation),
+                      Builder.CreateICmpEQ(EntryClass, Class));
+
+  llvm::BasicBlock *HitBB = CGF.createBasicBlock("cache.hit");
+  llvm::BasicBlock *MissBB = CGF.createBasicBlock("cache.miss");
+  llvm::BasicBlock *ContBB = CGF.createBasicBlock("cache.cont");
+  Builder.CreateCondBr(IsHit, HitBB, MissBB);
+
+  CGF.EmitBlock(HitBB);
+  llvm::Value *CachedImp = Builder.CreateLoad(Builder.CreateStructGEP(Entry, 2));
+  Builder.CreateBr(ContBB);
+
+  CGF.EmitBlock(MissBB);
+  llvm::Type *MissParams[] = { ObjCTypes.Int8PtrTy, ObjCTypes.Int8PtrTy,
+                               ObjCTypes.Int8PtrTy, ObjCTypes.Int8PtrTy };
+  llvm::FunctionType *MissTy =
+    llvm::FunctionType::get(ObjCTypes.Int8PtrTy, MissParams, false);
+  llvm::Value *MissFn =
+    GetHostPointer(MissTy->getPointerTo(), (void*)(intptr_t)&ObjCJitSendCacheMiss);
+  llvm::Value *MissImp =
+    Builder.CreateCall4(MissFn,
+                        Builder.CreateBitCast(Cache, ObjCTypes.Int8PtrTy),
+                        Builder.CreateBitCast(Receiver, ObjCTypes.Int8PtrTy),
+                        Class,
+                        Builder.CreateBitCast(Sel, ObjCTypes.Int8PtrTy));
+  Builder.CreateBr(ContBB);
+
+  CGF.EmitBlock(ContBB);
+  llvm::PHINode *Imp = Builder.CreatePHI(ObjCTypes.Int8PtrTy, 2, "imp");
+  Imp->addIncoming(CachedImp, HitBB);
+  Imp->addIncoming(MissImp, MissBB);
+  return Imp;
+}
+
+
+/// Route every call that can change a method list through a wrapper that
+/// invalidates the inline caches afterwards.  This covers calls made directly
+/// by the program; ObjCJitRegisterMethods invalidates after registering the
+/// methods and categories of a module.  Changes made outside JITed code (e.g.
+/// by loading a bundle) are not seen.
+void CGObjCJit::EmitSendCacheInvalidation() {
+  static const char *const MutatorNames[] = {
+    "class_addMethod",
+    "class_replaceMethod",
+    "method_setImplementation",
+    "method_exchangeImplementations"
+  };
+
+  llvm::Module &M = CGM.getModule();
+  llvm::FunctionType *InvalidateTy =
+    llvm::FunctionType::get(llvm::Type::getVoidTy(VMContext), false);
+  llvm::Value *InvalidateFn =
+    GetHostPointer(InvalidateTy->getPointerTo(),
+                   (void*)(intptr_t)&ObjCJitInvalidateSendCaches);
+
+  for (unsigned i = 0, e = llvm::array_lengthof(MutatorNames); i != e; ++i) {
+    llvm::Function *Mutator = M.getFunction(MutatorNames[i]);
+    if (!Mutator || !Mutator->isDeclaration() || Mutator->use_empty())
+      continue;
+
+    llvm::Function *Wrapper =
+      llvm::Function::Create(Mutator->getFunctionType(),
+                             llvm::GlobalValue::PrivateLinkage,
+                             llvm::Twine(".objc_jit_") + MutatorNames[i], &M);
+    // Redirect the uses before the wrapper itself calls the real function.
+    Mutator->replaceAllUsesWith(Wrapper);
+
+    CGBuilderTy Builder(llvm::BasicBlock::Create(VMContext, "entry", Wrapper));
+    SmallVector<llvm::Value*, 4> Args;
+    for (llvm::Function::arg_iterator AI = Wrapper->arg_begin(),
+           AE = Wrapper->arg_end(); AI != AE; ++AI)
+      Args.push_back(AI);
+    llvm::CallInst *Result = Builder.CreateCall(Mutator, Args);
+    Builder.CreateCall(InvalidateFn);
+    if (Result->getType()->isVoidTy())
+      Builder.CreateRetVoid();
+    else
+      Builder.CreateRet(Result);
+  }
+}
+
+
 void CGObjCJit::AddMethodsToClass(void *theClass) {
 
   // Methods need to be added at runtime. Method function pointers (IMP)
-  // are not available until then.
-
-  CGBuilderTy Builder(JitInitBlock);
-  CodeGen::CodeGenFunction CGF(CGM);
+  // are not available until then, so record them in the method table.
 
   void *theMetaclass = _object_getClass(theClass);
 
@@ -1061,26 +1575,19 @@ void CGObjCJit::AddMethodsToClass(void *theClass) {
     std::string TypeStr;
     CGM.getContext().getObjCEncodingForMethodDecl(const_cast<ObjCMethodDecl*>(D),
         TypeStr);
-    const char* TypeCStr = // keep in a set
-      MethodTypeStrings.insert(MethodTypeStrings.begin(), TypeStr)->c_str();
     void *ClassObject = D->isClassMethod() ? theMetaclass : theClass;
-    llvm::Value *ClassArg =
-      llvm::Constant::getIntegerValue(ObjCTypes.ClassPtrTy,
-                                      llvm::APInt(sizeof(void*) * 8,
-                                          (uint64_t)ClassObject));
-    llvm::Value *SelectorArg = GetSelector(CGF, D->getSelector());
-    llvm::Value *TypeArg =
-      llvm::Constant::getIntegerValue(ObjCTypes.Int8PtrTy,
-                                      llvm::APInt(sizeof(void*) * 8,
-                                          (uint64_t)TypeCStr));
-
-    llvm::Value *MethodArg = Builder.CreateBitCast(I->second, ImpPtrTy);
-
-    Builder.CreateCall4(fn_class_addMethod,
-                        ClassArg,
-                        SelectorArg,
-                        MethodArg,
-                        TypeArg);
+    void *Sel = _sel_registerName(D->getSelector().getAsString().c_str());
+
+    // The type string lives in the module, not in this CodeGenModule, since
+    // the runtime may keep the pointer.
+    llvm::Constant *Fields[] = {
+      GetHostPointer(ObjCTypes.Int8PtrTy, ClassObject),
+      GetHostPointer(ObjCTypes.Int8PtrTy, Sel),
+      llvm::ConstantExpr::getBitCast(I->second, ObjCTypes.Int8PtrTy),
+      llvm::ConstantExpr::getBitCast(CGM.GetAddrOfConstantCString(TypeStr),
+                                     ObjCTypes.Int8PtrTy)
+    };
+    MethodRecords.push_back(llvm::ConstantStruct::get(MethodRecordTy, Fields));
     I++;
   }
 
@@ -1089,6 +1596,37 @@ void CGObjCJit::AddMethodsToClass(void *theClass) {
 }
 
 
+/// Emit the module's method table and a call that registers it into the init
+/// function.  One call, rather than a class_addMethod call per method, keeps
+/// .objc_jit_init small for modules with many methods.
+void CGObjCJit::EmitMethodTable(CGBuilderTy &Builder) {
+  if (MethodRecords.empty())
+    return;
+
+  llvm::ArrayType *TableTy =
+    llvm::ArrayType::get(MethodRecordTy, MethodRecords.size());
+  llvm::GlobalVariable *Table =
+    new llvm::GlobalVariable(CGM.getModule(), TableTy, /*isConstant=*/true,
+                             llvm::GlobalValue::PrivateLinkage,
+                             llvm::ConstantArray::get(TableTy, MethodRecords),
+                             ".objc_jit_method_table");
+
+  llvm::Type *RegisterParams[] = { MethodRecordTy->getPointerTo(),
+                                   CGM.IntPtrTy };
+  llvm::FunctionType *RegisterTy =
+    llvm::FunctionType::get(llvm::Type::getVoidTy(VMContext), RegisterParams,
+                            false);
+  llvm::Value *RegisterFn =
+    GetHostPointer(RegisterTy->getPointerTo(),
+                   (void*)(intptr_t)&ObjCJitRegisterMethods);
+  Builder.CreateCall2(RegisterFn,
+                      Builder.CreateConstGEP2_32(Table, 0, 0),
+                      llvm::ConstantInt::get(CGM.IntPtrTy,
+                                             MethodRecords.size()));
+  MethodRecords.clear();
+}
+
+
 void
 CGObjCJit::AddIvarsToClass(void *theClass,
                            const ivar_iterator& ivar_begin,
@@ -1122,12 +1660,13 @@ CGObjCJit::InitConstantStringGenerator() {
 
       stringInitSel = _sel_registerName("initWithBytes:length:encoding:");
       wideStringInitSel = _sel_registerName("initWithCharacters:length");
+      releaseSel = _sel_registerName("release");
 
       // Unfortunately, using the GNU runtime version of
       // class_getMethodImplementation and then calling the resulting IMP
       // doesn't work unless objc_msg_lookup was already called first.
       //
-      if (_objc_msg_lookup) {
+      if (_objc_msg_lookup.isAvailable()) {
         stringAlloc_imp = _objc_msg_lookup(stringClass, allocSel);
       } else { // use universal way
         void *stringMetaClass = _object_getClass(stringClass);
@@ -1143,7 +1682,7 @@ CGObjCJit::InitConstantStringGenerator() {
         void *defaultCollectorSel = _sel_registerName("defaultCollector");
         _imp_t _imp;
 
-        if (_objc_msg_lookup) { // GNU runtime workaround
+        if (_objc_msg_lookup.isAvailable()) { // GNU runtime workaround
           _imp = _objc_msg_lookup(garbageCollectorClass, defaultCollectorSel);
         } else {
           void *garbageCollectorMetaClass =
@@ -1173,6 +1712,66 @@ CodeGen::CreateJitObjCRuntime(CodeGen::CodeGenModule &CGM) {
   return new CGObjCJit(CGM);
 }
 
+void clang::getObjCJitRuntimeCallCounts(
+    SmallVectorImpl<std::pair<StringRef, unsigned> > &Counts) {
+  for (unsigned i = 0; i != NumObjCJitRuntimeCalls; ++i)
+    Counts.push_back(std::make_pair(StringRef(ObjCJitRuntimeCallNames[i]),
+                                    unsigned(ObjCJitRuntimeCallCounts[i])));
+}
+
+void clang::getObjCJitStringPoolStats(ObjCJitStringPoolStats &Stats) {
+  Stats = ObjCJitStringPoolStats();
+  if (!StringPool.isConstructed())
+    return;
+  llvm::sys::ScopedLock Guard(StringPool->Lock);
+  Stats.NumStrings = StringPool->Strings.size();
+  Stats.Lookups = StringPool->Lookups;
+  Stats.Hits = StringPool->Hits;
+  Stats.BytesRetained = StringPool->Bytes;
+}
+
+void clang::clearObjCJitConstantStrings() {
+  if (!StringPool.isConstructed())
+    return;
+  llvm::sys::ScopedLock Guard(StringPool->Lock);
+  for (llvm::StringMap<ObjCJitStringPool::Entry>::iterator
+         I = StringPool->Strings.begin(), E = StringPool->Strings.end();
+       I != E; ++I)
+    I->getValue().release();
+  StringPool->Strings.clear();
+  StringPool->ModuleKeys.clear();
+  StringPool->Bytes = 0;
+}
+
+void clang::releaseObjCJitConstantStrings(const llvm::Module *M) {
+  if (!StringPool.isConstructed())
+    return;
+  llvm::sys::ScopedLock Guard(StringPool->Lock);
+  llvm::DenseMap<const llvm::Module *, std::vector<std::string> >::iterator
+    Keys = StringPool->ModuleKeys.find(M);
+  if (Keys == StringPool->ModuleKeys.end())
+    return;
+
+  for (unsigned i = 0, e = Keys->second.size(); i != e; ++i) {
+    StringRef Key = Keys->second[i];
+    llvm::StringMap<ObjCJitStringPool::Entry>::iterator Pooled =
+      StringPool->Strings.find(Key);
+    if (Pooled == StringPool->Strings.end())
+      continue;
+    Pooled->getValue().Users.erase(M);
+    if (!Pooled->getValue().Users.empty())
+      continue;
+
+    // The key is the literal's bytes after a one character prefix.
+    if (Pooled->getValue().Object) {
+      Pooled->getValue().release();
+      StringPool->Bytes -= Key.size() - 1;
+    }
+    StringPool->Strings.erase(Pooled);
+  }
+  StringPool->ModuleKeys.erase(Keys);
+}
+
 #else // INCLUDE_JIT_OBJC_RUNTIME not defined
 
 void ThisIsJustToRemoveTheLinkerWarning() {
@@ -33,13 +33,23 @@ namespace {
     OwningPtr<const llvm::DataLayout> TD;
     ASTContext *Ctx;
     const CodeGenOptions CodeGenOpts;  // Intentionally copied in.
+
+    /// Once StartModule has been used, only errors reported while emitting
+    /// the current module discard it.
+    OwningPtr<DiagnosticErrorTrap> ModuleErrors;
+
+    bool hasErrorOccurred() const {
+      if (ModuleErrors)
+        return ModuleErrors->hasErrorOccurred();
+      return Diags.hasErrorOccurred();
+    }
   protected:
     OwningPtr<llvm::Module> M;
     OwningPtr<CodeGen::CodeGenModule> Builder;
   public:
     CodeGeneratorImpl(DiagnosticsEngine &diags, const std::string& ModuleName,
                       const CodeGenOptions &CGO, llvm::LLVMContext& C)
-      : Diags(diags), CodeGenOpts(CGO),
+      : Diags(diags), Ctx(0), CodeGenOpts(CGO),
         M(new llvm::Module(ModuleName, C)) {}
 
     virtual ~CodeGeneratorImpl() {}
@@ -52,6 +62,23 @@ namespace {
       return M.take();
     }
 
+    virtual llvm::Module* StartModule(const std::string &ModuleName,
+                                      llvm::LLVMContext &C) {
+      assert(!M && "previous module was not released");
+      M.reset(new llvm::Module(ModuleName, C));
+
+      if (ModuleErrors)
+        ModuleErrors->reset();
+      else
+        ModuleErrors.reset(new DiagnosticErrorTrap(Diags));
+
+      // A fresh CodeGenModule; everything the old one emitted now lives in
+      // a module owned by somebody else.
+      if (Ctx)
+        Initialize(*Ctx);
+      return M.get();
+    }
+
     virtual void Initialize(ASTContext &Context) {
       Ctx = &Context;
 
@@ -104,7 +131,7 @@ namespace {
     }
 
     virtual void HandleTranslationUnit(ASTContext &Ctx) {
-      if (Diags.hasErrorOccurred()) {
+      if (hasErrorOccurred()) {
         M.reset();
         return;
       }
@@ -114,14 +141,14 @@ namespace {
     }
 
     virtual void CompleteTentativeDefinition(VarDecl *D) {
-      if (Diags.hasErrorOccurred())
+      if (hasErrorOccurred())
         return;
 
       Builder->EmitTentativeDefinition(D);
     }
 
     virtual void HandleVTable(CXXRecordDecl *RD, bool DefinitionRequired) {
-      if (Diags.hasErrorOccurred())
+      if (hasErrorOccurred())
         return;
 
       Builder->EmitVTable(RD, DefinitionRequired);
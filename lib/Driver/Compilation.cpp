@@ -13,14 +13,22 @@
 #include "clang/Driver/DriverDiagnostic.h"
 #include "clang/Driver/Options.h"
 #include "clang/Driver/ToolChain.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Config/config.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/raw_ostream.h"
 #include <errno.h>
 #include <sys/stat.h>
+#include <vector>
+
+#if HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 using namespace clang::driver;
 using namespace clang;
@@ -258,47 +266,107 @@ bool Compilation::CleanupFileMap(const ArgStringMap &Files,
   return Success;
 }
 
-int Compilation::ExecuteCommand(const Command &C,
-                                const Command *&FailingCommand) const {
+bool Compilation::LogCommand(const Command &C, raw_ostream &OS) const {
+  if ((!getDriver().CCPrintOptions && !getArgs().hasArg(options::OPT_v)) ||
+      getDriver().CCGenDiagnostics)
+    return true;
+
+  raw_ostream *LogOS = &OS;
+
+  // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
+  // output stream.
+  if (getDriver().CCPrintOptions && getDriver().CCPrintOptionsFilename) {
+    std::string Error;
+    LogOS = new llvm::raw_fd_ostream(getDriver().CCPrintOptionsFilename, Error,
+                                     llvm::sys::fs::F_Append);
+    if (!Error.empty()) {
+      getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
+        << Error;
+      delete LogOS;
+      return false;
+    }
+  }
+
+  if (getDriver().CCPrintOptions)
+    *LogOS << "[Logging clang options]";
+
+  PrintJob(*LogOS, C, "\n", /*Quote=*/getDriver().CCPrintOptions);
+
+  if (LogOS != &OS)
+    delete LogOS;
+  return true;
+}
+
+/// Run the program of \p C and wait for it to exit.
+static int RunCommand(const Command &C, const StringRef **Redirects,
+                      std::string *Error, bool *ExecutionFailed) {
   std::string Prog(C.getExecutable());
   const char **Argv = new const char*[C.getArguments().size() + 2];
   Argv[0] = C.getExecutable();
   std::copy(C.getArguments().begin(), C.getArguments().end(), Argv+1);
   Argv[C.getArguments().size() + 1] = 0;
 
-  if ((getDriver().CCPrintOptions ||
-       getArgs().hasArg(options::OPT_v)) && !getDriver().CCGenDiagnostics) {
-    raw_ostream *OS = &llvm::errs();
+  int Res = llvm::sys::ExecuteAndWait(Prog, Argv, /*env*/ 0, Redirects,
+                                      /*secondsToWait*/ 0, /*memoryLimit*/ 0,
+                                      Error, ExecutionFailed);
+  delete[] Argv;
+  return Res;
+}
 
-    // Follow gcc implementation of CC_PRINT_OPTIONS; we could also cache the
-    // output stream.
-    if (getDriver().CCPrintOptions && getDriver().CCPrintOptionsFilename) {
-      std::string Error;
-      OS = new llvm::raw_fd_ostream(getDriver().CCPrintOptionsFilename, Error,
-                                    llvm::sys::fs::F_Append);
-      if (!Error.empty()) {
-        getDriver().Diag(clang::diag::err_drv_cc_print_options_failure)
-          << Error;
-        FailingCommand = &C;
-        delete OS;
-        return 1;
-      }
-    }
+/// Whether the compiler argument \p Arg ends up in LLVM's global options,
+/// which are parsed from a command line that may only be given once per
+/// process.
+static bool SetsLLVMOptions(StringRef Arg) {
+  return llvm::StringSwitch<bool>(Arg)
+    .Cases("-mllvm", "-backend-option", true)
+    .Cases("-mdebug-pass", "-mlimit-float-precision", true)
+    .Cases("-ftime-report", "-mno-global-merge", true)
+    .Default(false);
+}
 
-    if (getDriver().CCPrintOptions)
-      *OS << "[Logging clang options]";
+/// Whether \p C runs the compiler of the driver executable, and can do so in
+/// the driver's process.  Commands setting any of LLVM's global options
+/// always get a process of their own, since a second compiler setting them
+/// in the same process would fail.
+static bool CanRunInProcess(const Driver &D, const Command &C) {
+  const ArgStringList &Args = C.getArguments();
+  if (Args.empty() || StringRef(Args[0]) != "-cc1" ||
+      StringRef(C.getExecutable()) != D.getClangProgramPath())
+    return false;
+  for (unsigned i = 1, e = Args.size(); i != e; ++i)
+    if (SetsLLVMOptions(Args[i]))
+      return false;
+  return true;
+}
 
-    PrintJob(*OS, C, "\n", /*Quote=*/getDriver().CCPrintOptions);
+int Compilation::ExecuteCommand(const Command &C,
+                                const Command *&FailingCommand) const {
+  if (!LogCommand(C, llvm::errs())) {
+    FailingCommand = &C;
+    return 1;
+  }
 
-    if (OS != &llvm::errs())
-      delete OS;
+  // Redirected commands are those rerun to generate crash diagnostics, which
+  // must not run in the process of the compiler that crashed.
+  if (getDriver().CC1Main && !Redirects &&
+      getArgs().hasFlag(options::OPT_fintegrated_cc1,
+                        options::OPT_fno_integrated_cc1, false) &&
+      CanRunInProcess(getDriver(), C)) {
+    // Output the driver has buffered must come before the compiler's.
+    llvm::outs().flush();
+    llvm::errs().flush();
+    SmallVector<const char *, 128> Argv(C.getArguments().begin() + 1,
+                                        C.getArguments().end());
+    int Res = getDriver().CC1Main(Argv.data(), Argv.data() + Argv.size(),
+                                  C.getExecutable());
+    if (Res)
+      FailingCommand = &C;
+    return Res;
   }
 
   std::string Error;
   bool ExecutionFailed;
-  int Res = llvm::sys::ExecuteAndWait(Prog, Argv, /*env*/ 0, Redirects,
-                                      /*secondsToWait*/ 0, /*memoryLimit*/ 0,
-                                      &Error, &ExecutionFailed);
+  int Res = RunCommand(C, Redirects, &Error, &ExecutionFailed);
   if (!Error.empty()) {
     assert(Res && "Error string set with 0 result code!");
     getDriver().Diag(clang::diag::err_drv_command_failure) << Error;
@@ -307,7 +375,6 @@ int Compilation::ExecuteCommand(const Command &C,
   if (Res)
     FailingCommand = &C;
 
-  delete[] Argv;
   return ExecutionFailed ? 1 : Res;
 }
 
@@ -352,6 +419,242 @@ void Compilation::ExecuteJob(const Job &J,
   }
 }
 
+namespace {
+/// A command of a parallel run, and what running it produced.
+struct ScheduledCommand {
+  enum StateKind { Pending, Running, Finished, Skipped };
+
+  const Command *Cmd;
+  /// The earlier commands producing this command's inputs.
+  SmallVector<unsigned, 4> Deps;
+  StateKind State;
+  int Res;
+  std::string Error;
+  /// The -v output for the command.
+  std::string Log;
+  /// Where the command's standard output and error were captured, if they
+  /// were.
+  std::string OutPath, ErrPath;
+
+  ScheduledCommand(const Command *Cmd) : Cmd(Cmd), State(Pending), Res(0) {}
+
+  bool failed() const { return State == Skipped || Res != 0; }
+};
+
+struct CommandSchedule {
+  const Compilation *C;
+  std::vector<ScheduledCommand> Commands;
+  /// Redirection for the commands, if their output is not captured.
+  const StringRef **Redirects;
+  /// The first command whose results have not been reported yet.
+  unsigned NextToReport;
+  FailingCommandList *FailingCommands;
+#if HAVE_PTHREAD_H
+  pthread_mutex_t Lock;
+  pthread_cond_t Changed;
+#endif
+};
+}
+
+static void CollectCommands(const Job &J,
+                            std::vector<ScheduledCommand> &Commands) {
+  if (const Command *C = dyn_cast<Command>(&J)) {
+    Commands.push_back(ScheduledCommand(C));
+    return;
+  }
+  const JobList *Jobs = cast<JobList>(&J);
+  for (JobList::const_iterator it = Jobs->begin(), ie = Jobs->end();
+       it != ie; ++it)
+    CollectCommands(**it, Commands);
+}
+
+/// Add the commands producing the inputs of \p A, which come before command
+/// \p Index, to \p Deps.
+static void CollectDeps(const Action *A,
+                        const llvm::DenseMap<const Action *, unsigned> &Sources,
+                        unsigned Index, SmallVectorImpl<unsigned> &Deps) {
+  for (Action::const_iterator AI = A->begin(), AE = A->end(); AI != AE; ++AI) {
+    llvm::DenseMap<const Action *, unsigned>::const_iterator S =
+      Sources.find(*AI);
+    if (S != Sources.end() && S->second < Index)
+      Deps.push_back(S->second);
+    CollectDeps(*AI, Sources, Index, Deps);
+  }
+}
+
+/// Copy the contents of \p Path to \p OS and remove the file.
+static void ReplayOutput(const std::string &Path, raw_ostream &OS) {
+  if (Path.empty())
+    return;
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  if (!llvm::MemoryBuffer::getFile(Path, Buffer))
+    OS << Buffer->getBuffer();
+  OS.flush();
+  bool Existed;
+  llvm::sys::fs::remove(Path, Existed);
+}
+
+/// Print the results of the finished commands whose turn it is, in job
+/// order.  Must be called with the schedule locked.
+static void ReportFinishedCommands(CommandSchedule &S) {
+  const Driver &D = S.C->getDriver();
+  for (; S.NextToReport != S.Commands.size(); ++S.NextToReport) {
+    ScheduledCommand &SC = S.Commands[S.NextToReport];
+    if (SC.State == ScheduledCommand::Pending ||
+        SC.State == ScheduledCommand::Running)
+      return;
+    if (SC.State == ScheduledCommand::Skipped)
+      continue;
+
+    llvm::errs() << SC.Log;
+    llvm::errs().flush();
+    ReplayOutput(SC.OutPath, llvm::outs());
+    ReplayOutput(SC.ErrPath, llvm::errs());
+    if (!SC.Error.empty())
+      D.Diag(clang::diag::err_drv_command_failure) << SC.Error;
+    if (SC.Res)
+      S.FailingCommands->push_back(std::make_pair(SC.Res, SC.Cmd));
+  }
+}
+
+/// Find a command whose inputs are ready, skipping the commands whose inputs
+/// failed.  Must be called with the schedule locked.
+///
+/// \return The index of the command, or the number of commands if none is
+/// ready.  \p Waiting is set if some command may become ready later.
+static unsigned FindReadyCommand(CommandSchedule &S, bool &Waiting) {
+  Waiting = false;
+  for (unsigned i = S.NextToReport, e = S.Commands.size(); i != e; ++i) {
+    ScheduledCommand &SC = S.Commands[i];
+    if (SC.State != ScheduledCommand::Pending)
+      continue;
+
+    bool Ready = true, InputsOk = true;
+    for (unsigned j = 0, je = SC.Deps.size(); j != je; ++j) {
+      const ScheduledCommand &Dep = S.Commands[SC.Deps[j]];
+      if (Dep.State == ScheduledCommand::Pending ||
+          Dep.State == ScheduledCommand::Running)
+        Ready = false;
+      else if (Dep.failed())
+        InputsOk = false;
+    }
+    // The inputs of the later commands come from earlier ones, so skipping
+    // this command here is seen by the rest of the scan.
+    if (!InputsOk) {
+      SC.State = ScheduledCommand::Skipped;
+      continue;
+    }
+    if (Ready)
+      return i;
+    Waiting = true;
+  }
+  return S.Commands.size();
+}
+
+/// Start the command \p SC: log it and pick the files its output goes to.
+/// Must be called with the schedule locked.
+///
+/// \return False if the command must not run.
+static bool PrepareCommand(CommandSchedule &S, ScheduledCommand &SC) {
+  llvm::raw_string_ostream LogOS(SC.Log);
+  if (!S.C->LogCommand(*SC.Cmd, LogOS))
+    return false;
+  if (S.Redirects)
+    return true;
+
+  const Driver &D = S.C->getDriver();
+  SC.OutPath = D.GetTemporaryPath("job", "out");
+  SC.ErrPath = D.GetTemporaryPath("job", "err");
+  return !SC.OutPath.empty() && !SC.ErrPath.empty();
+}
+
+#if HAVE_PTHREAD_H
+static void *RunScheduledCommands(void *Arg) {
+  CommandSchedule &S = *static_cast<CommandSchedule *>(Arg);
+  pthread_mutex_lock(&S.Lock);
+  for (;;) {
+    bool Waiting;
+    unsigned Next = FindReadyCommand(S, Waiting);
+    if (Next == S.Commands.size()) {
+      ReportFinishedCommands(S);
+      if (!Waiting)
+        break;
+      pthread_cond_wait(&S.Changed, &S.Lock);
+      continue;
+    }
+
+    ScheduledCommand &SC = S.Commands[Next];
+    SC.State = ScheduledCommand::Running;
+    if (PrepareCommand(S, SC)) {
+      StringRef OutPath(SC.OutPath), ErrPath(SC.ErrPath);
+      const StringRef *Captured[] = { 0, &OutPath, &ErrPath };
+      const StringRef **Redirects = S.Redirects ? S.Redirects : Captured;
+      std::string Error;
+      bool ExecutionFailed;
+      pthread_mutex_unlock(&S.Lock);
+      int Res = RunCommand(*SC.Cmd, Redirects, &Error, &ExecutionFailed);
+      pthread_mutex_lock(&S.Lock);
+      SC.Error.swap(Error);
+      SC.Res = ExecutionFailed ? 1 : Res;
+    } else {
+      SC.Res = 1;
+    }
+    SC.State = ScheduledCommand::Finished;
+    ReportFinishedCommands(S);
+    pthread_cond_broadcast(&S.Changed);
+  }
+  pthread_cond_broadcast(&S.Changed);
+  pthread_mutex_unlock(&S.Lock);
+  return 0;
+}
+#endif
+
+void Compilation::ExecuteJobsInParallel(const JobList &Jobs, unsigned NumJobs,
+                                 FailingCommandList &FailingCommands) const {
+#if HAVE_PTHREAD_H
+  CommandSchedule S;
+  S.C = this;
+  S.Redirects = Redirects;
+  S.NextToReport = 0;
+  S.FailingCommands = &FailingCommands;
+  CollectCommands(Jobs, S.Commands);
+  if (NumJobs > S.Commands.size())
+    NumJobs = S.Commands.size();
+  if (NumJobs <= 1) {
+    ExecuteJob(Jobs, FailingCommands);
+    return;
+  }
+
+  llvm::DenseMap<const Action *, unsigned> Sources;
+  for (unsigned i = 0, e = S.Commands.size(); i != e; ++i)
+    Sources.insert(std::make_pair(&S.Commands[i].Cmd->getSource(), i));
+  for (unsigned i = 0, e = S.Commands.size(); i != e; ++i)
+    CollectDeps(&S.Commands[i].Cmd->getSource(), Sources, i,
+                S.Commands[i].Deps);
+
+  // Output printed so far must come before that of the commands.
+  llvm::outs().flush();
+  llvm::errs().flush();
+
+  pthread_mutex_init(&S.Lock, 0);
+  pthread_cond_init(&S.Changed, 0);
+  // This thread is one of the workers.
+  std::vector<pthread_t> Threads;
+  for (unsigned i = 1; i != NumJobs; ++i) {
+    pthread_t Thread;
+    if (pthread_create(&Thread, 0, RunScheduledCommands, &S) == 0)
+      Threads.push_back(Thread);
+  }
+  RunScheduledCommands(&S);
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    pthread_join(Threads[i], 0);
+  pthread_cond_destroy(&S.Changed);
+  pthread_mutex_destroy(&S.Lock);
+#else
+  ExecuteJob(Jobs, FailingCommands);
+#endif
+}
+
 void Compilation::initCompilationForDiagnostics() {
   // Free actions and jobs.
   DeleteContainerPointers(Actions);
@@ -55,7 +55,7 @@ Driver::Driver(StringRef ClangExecutable,
     DefaultImageName(DefaultImageName),
     DriverTitle("clang LLVM compiler"),
     CCPrintOptionsFilename(0), CCPrintHeadersFilename(0),
-    CCLogDiagnosticsFilename(0),
+    CCLogDiagnosticsFilename(0), CC1Main(0),
     CCCPrintBindings(false),
     CCPrintOptions(false), CCPrintHeaders(false), CCLogDiagnostics(false),
     CCGenDiagnostics(false), CCCGenericGCCName(""), CheckInputsExist(true),
@@ -320,6 +320,14 @@ Compilation *Driver::BuildCompilation(ArrayRef<const char *> ArgList) {
   // Ignore -pipe.
   Args->ClaimAllArgs(options::OPT_pipe);
 
+  // -j and -fintegrated-cc1 are read when the jobs are executed.
+  Args->ClaimAllArgs(options::OPT_j);
+  Args->ClaimAllArgs(options::OPT_fintegrated_cc1);
+  Args->ClaimAllArgs(options::OPT_fno_integrated_cc1);
+
+  // Only GCC based tool chains look for a GCC installation to cache.
+  Args->ClaimAllArgs(options::OPT_gcc_install_cache_EQ);
+
   // Extract -ccc args.
   //
   // FIXME: We need to figure out where this behavior should live. Most of it
@@ -570,7 +578,20 @@ int Driver::ExecuteCompilation(const Compilation &C,
   if (Diags.hasErrorOccurred())
     return 1;
 
-  C.ExecuteJob(C.getJobs(), FailingCommands);
+  unsigned NumJobs = 1;
+  if (Arg *A = C.getArgs().getLastArg(options::OPT_j)) {
+    StringRef Value = A->getValue();
+    if (Value.getAsInteger(10, NumJobs) || NumJobs == 0) {
+      Diag(clang::diag::err_drv_invalid_int_value)
+        << A->getAsString(C.getArgs()) << Value;
+      return 1;
+    }
+  }
+
+  if (NumJobs > 1)
+    C.ExecuteJobsInParallel(C.getJobs(), NumJobs, FailingCommands);
+  else
+    C.ExecuteJob(C.getJobs(), FailingCommands);
 
   // Remove temp files.
   C.CleanupFileList(C.getTempFiles());
@@ -27,6 +27,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 
@@ -983,6 +984,43 @@ static StringRef getGCCToolchainDir(const ArgList &Args) {
   return GCC_INSTALL_PREFIX;
 }
 
+// The GCC installation cache is a text file holding one entry for each key
+// (target triple, search prefixes and so on) a driver detected a GCC
+// installation for:
+//
+//   entry
+//   key <part of the key>        one line for each part
+//   dir <mtime> <path>           a directory the installation depends on
+//   <field> <value>              the detected installation
+//   end
+//
+// where the key lines are the ones getCacheKey() computes.
+
+/// \brief Split the contents of a GCC installation cache into the lines
+/// following the key of the entry for \p Key, and the other entries.
+static bool splitCacheEntries(StringRef Cache, StringRef Key, StringRef &Entry,
+                              std::string &OtherEntries) {
+  const StringRef EntryStart = "entry\n", EntryEnd = "\nend\n";
+  bool Found = false;
+  while (Cache.startswith(EntryStart)) {
+    size_t End = Cache.find(EntryEnd);
+    if (End == StringRef::npos)
+      break;
+    StringRef Lines = Cache.slice(EntryStart.size(), End + 1);
+    Cache = Cache.substr(End + EntryEnd.size());
+    if (!Found && Lines.startswith(Key) &&
+        !Lines.substr(Key.size()).startswith("key ")) {
+      Entry = Lines.substr(Key.size());
+      Found = true;
+    } else {
+      OtherEntries += "entry\n";
+      OtherEntries += Lines;
+      OtherEntries += "end\n";
+    }
+  }
+  return Found;
+}
+
 /// \brief Construct a GCCInstallationDetector from the driver.
 ///
 /// This performs all of the autodetection and sets up the various paths.
@@ -994,7 +1032,8 @@ static StringRef getGCCToolchainDir(const ArgList &Args) {
 /// triple.
 Generic_GCC::GCCInstallationDetector::GCCInstallationDetector(
     const Driver &D, const llvm::Triple &TargetTriple, const ArgList &Args)
-    : IsValid(false) {
+    : IsValid(false), NumProbes(0), RecordProbes(false), UsesCache(false),
+      LoadedFromCache(false), NumValidatedDirs(0), NumCachedProbes(0) {
   llvm::Triple BiarchVariantTriple =
       TargetTriple.isArch32Bit() ? TargetTriple.get64BitArchVariant()
                                  : TargetTriple.get32BitArchVariant();
@@ -1024,15 +1063,32 @@ Generic_GCC::GCCInstallationDetector::GCCInstallationDetector(
     Prefixes.push_back(D.InstalledDir + "/..");
   }
 
+  // Use the installation found by an earlier driver if it is still valid.
+  StringRef CachePath = Args.getLastArgValue(options::OPT_gcc_install_cache_EQ);
+  std::string CacheKey;
+  if (!CachePath.empty() &&
+      getCacheKey(TargetTriple, Args, Prefixes, CacheKey)) {
+    UsesCache = true;
+    OwningPtr<llvm::MemoryBuffer> Cache;
+    StringRef Entry;
+    std::string OtherEntries;
+    if (!llvm::MemoryBuffer::getFile(CachePath, Cache) &&
+        splitCacheEntries(Cache->getBuffer(), CacheKey, Entry, OtherEntries) &&
+        loadFromCache(Entry))
+      return;
+    RecordProbes = true;
+  }
+  uint64_t StartTime = llvm::sys::TimeValue::now().toEpochTime();
+
   // Loop over the various components which exist and select the best GCC
   // installation available. GCC installs are ranked by version number.
   Version = GCCVersion::Parse("0.0.0");
   for (unsigned i = 0, ie = Prefixes.size(); i < ie; ++i) {
-    if (!llvm::sys::fs::exists(Prefixes[i]))
+    if (!probeExists(Prefixes[i]))
       continue;
     for (unsigned j = 0, je = CandidateLibDirs.size(); j < je; ++j) {
       const std::string LibDir = Prefixes[i] + CandidateLibDirs[j].str();
-      if (!llvm::sys::fs::exists(LibDir))
+      if (!probeExists(LibDir))
         continue;
       for (unsigned k = 0, ke = CandidateTripleAliases.size(); k < ke; ++k)
         ScanLibDirForGCCTriple(TargetArch, Args, LibDir,
@@ -1040,7 +1096,7 @@ Generic_GCC::GCCInstallationDetector::GCCInstallationDetector(
     }
     for (unsigned j = 0, je = CandidateBiarchLibDirs.size(); j < je; ++j) {
       const std::string LibDir = Prefixes[i] + CandidateBiarchLibDirs[j].str();
-      if (!llvm::sys::fs::exists(LibDir))
+      if (!probeExists(LibDir))
         continue;
       for (unsigned k = 0, ke = CandidateBiarchTripleAliases.size(); k < ke;
            ++k)
@@ -1049,6 +1105,9 @@ Generic_GCC::GCCInstallationDetector::GCCInstallationDetector(
                                /*NeedsBiarchSuffix=*/ true);
     }
   }
+
+  if (RecordProbes)
+    saveToCache(CachePath, CacheKey, StartTime);
 }
 
 void Generic_GCC::GCCInstallationDetector::print(raw_ostream &OS) const {
@@ -1059,6 +1118,14 @@ void Generic_GCC::GCCInstallationDetector::print(raw_ostream &OS) const {
     OS << "Found candidate GCC installation: " << *I << "\n";
 
   OS << "Selected GCC installation: " << GCCInstallPath << "\n";
+
+  if (LoadedFromCache)
+    OS << "GCC installation cache: hit, checked " << NumValidatedDirs
+       << " directories instead of making " << NumCachedProbes
+       << " filesystem queries\n";
+  else if (UsesCache)
+    OS << "GCC installation cache: miss, made " << NumProbes
+       << " filesystem queries\n";
 }
 
 /*static*/ void Generic_GCC::GCCInstallationDetector::CollectLibDirsAndTriples(
@@ -1320,9 +1387,9 @@ static StringRef getMipsTargetABISuffix(llvm::Triple::ArchType TargetArch,
   return "/32";
 }
 
-static bool findTargetBiarchSuffix(std::string &Suffix, StringRef Path,
-                                   llvm::Triple::ArchType TargetArch,
-                                   const ArgList &Args) {
+bool Generic_GCC::GCCInstallationDetector::findTargetBiarchSuffix(
+    std::string &Suffix, StringRef Path, llvm::Triple::ArchType TargetArch,
+    const ArgList &Args) {
   // FIXME: This routine was only intended to model bi-arch toolchains which
   // use -m32 and -m64 to swap between variants of a target. It shouldn't be
   // doing ABI-based builtin location for MIPS.
@@ -1338,13 +1405,13 @@ static bool findTargetBiarchSuffix(std::string &Suffix, StringRef Path,
         TargetArch == llvm::Triple::mips64el)
       Suffix += ABISuffix;
 
-    if (llvm::sys::fs::exists(Path + Suffix + "/crtbegin.o"))
+    if (probeExists(Path + Suffix + "/crtbegin.o"))
       return true;
 
     // Then fall back and probe a simple case like
     // mips-linux-gnu/4.7/32/crtbegin.o
     Suffix = ABISuffix;
-    return llvm::sys::fs::exists(Path + Suffix + "/crtbegin.o");
+    return probeExists(Path + Suffix + "/crtbegin.o");
   }
 
   if (TargetArch == llvm::Triple::x86_64 ||
@@ -1354,7 +1421,7 @@ static bool findTargetBiarchSuffix(std::string &Suffix, StringRef Path,
   else
     Suffix = "/32";
 
-  return llvm::sys::fs::exists(Path + Suffix + "/crtbegin.o");
+  return probeExists(Path + Suffix + "/crtbegin.o");
 }
 
 void Generic_GCC::GCCInstallationDetector::ScanLibDirForGCCTriple(
@@ -1391,10 +1458,11 @@ void Generic_GCC::GCCInstallationDetector::ScanLibDirForGCCTriple(
   const unsigned NumLibSuffixes =
       (llvm::array_lengthof(LibSuffixes) - (TargetArch != llvm::Triple::x86));
   for (unsigned i = 0; i < NumLibSuffixes; ++i) {
-    StringRef LibSuffix = LibSuffixes[i];
+    const std::string Dir = LibDir + LibSuffixes[i];
     llvm::error_code EC;
-    for (llvm::sys::fs::directory_iterator LI(LibDir + LibSuffix, EC), LE;
-         !EC && LI != LE; LI = LI.increment(EC)) {
+    llvm::sys::fs::directory_iterator LI(Dir, EC), LE;
+    noteListing(Dir, !EC);
+    for (; !EC && LI != LE; LI = LI.increment(EC)) {
       CandidateGCCInstallPaths.push_back(LI->path());
       StringRef VersionText = llvm::sys::path::filename(LI->path());
       GCCVersion CandidateVersion = GCCVersion::Parse(VersionText);
@@ -1414,8 +1482,7 @@ void Generic_GCC::GCCInstallationDetector::ScanLibDirForGCCTriple(
       if (findTargetBiarchSuffix(BiarchSuffix, LI->path(), TargetArch, Args)) {
         GCCBiarchSuffix = BiarchSuffix;
       } else {
-        if (NeedsBiarchSuffix ||
-            !llvm::sys::fs::exists(LI->path() + "/crtbegin.o"))
+        if (NeedsBiarchSuffix || !probeExists(LI->path() + "/crtbegin.o"))
           continue;
         GCCBiarchSuffix.clear();
       }
@@ -1432,6 +1499,186 @@ void Generic_GCC::GCCInstallationDetector::ScanLibDirForGCCTriple(
   }
 }
 
+bool Generic_GCC::GCCInstallationDetector::probeExists(const Twine &Path) {
+  ++NumProbes;
+  SmallString<128> PathStorage;
+  StringRef PathStr = Path.toStringRef(PathStorage);
+  bool Exists = llvm::sys::fs::exists(PathStr);
+  // Whether Path exists can only change along with the directory it is in,
+  // or, if it does not exist, the closest directory above it that does.
+  if (RecordProbes)
+    noteExistingParent(PathStr);
+  return Exists;
+}
+
+void Generic_GCC::GCCInstallationDetector::noteListing(StringRef Dir,
+                                                       bool Listed) {
+  ++NumProbes;
+  if (!RecordProbes)
+    return;
+  if (Listed)
+    noteDir(Dir);
+  noteExistingParent(Dir);
+}
+
+void Generic_GCC::GCCInstallationDetector::noteExistingParent(StringRef Path) {
+  for (StringRef Dir = llvm::sys::path::parent_path(Path); !Dir.empty();
+       Dir = llvm::sys::path::parent_path(Dir))
+    if (noteDir(Dir))
+      return;
+}
+
+bool Generic_GCC::GCCInstallationDetector::noteDir(StringRef Dir) {
+  if (ProbedDirs.count(Dir))
+    return true;
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(Dir, Status) ||
+      !llvm::sys::fs::is_directory(Status))
+    return false;
+  ProbedDirs[Dir] = Status.getLastModificationTime().toEpochTime();
+  return true;
+}
+
+/*static*/ bool Generic_GCC::GCCInstallationDetector::getCacheKey(
+    const llvm::Triple &TargetTriple, const ArgList &Args,
+    ArrayRef<std::string> Prefixes, std::string &Key) {
+  SmallVector<std::string, 8> Parts;
+  // The search itself may change from one version to the next.
+  Parts.push_back("clang " + getClangFullVersion());
+  Parts.push_back("triple " + TargetTriple.str());
+  for (unsigned i = 0, e = Prefixes.size(); i != e; ++i)
+    Parts.push_back("prefix " + Prefixes[i]);
+  // The options findTargetBiarchSuffix() looks at for MIPS.
+  if (isMipsArch(TargetTriple.getArch())) {
+    std::string MipsSuffix;
+    appendMipsTargetSuffix(MipsSuffix, TargetTriple.getArch(), Args);
+    MipsSuffix += getMipsTargetABISuffix(TargetTriple.getArch(), Args);
+    Parts.push_back("mips " + MipsSuffix);
+  }
+
+  Key.clear();
+  for (unsigned i = 0, e = Parts.size(); i != e; ++i) {
+    if (Parts[i].find('\n') != std::string::npos)
+      return false;
+    Key += "key " + Parts[i] + "\n";
+  }
+  return true;
+}
+
+bool Generic_GCC::GCCInstallationDetector::loadFromCache(StringRef Entry) {
+  SmallVector<StringRef, 32> Lines;
+  Entry.split(Lines, "\n", /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+
+  // Check the directories first, so that a stale entry leaves nothing
+  // behind.
+  unsigned NumDirs = 0;
+  for (unsigned i = 0, e = Lines.size(); i != e; ++i) {
+    std::pair<StringRef, StringRef> Field = Lines[i].split(' ');
+    if (Field.first != "dir")
+      continue;
+    std::pair<StringRef, StringRef> TimeAndPath = Field.second.split(' ');
+    uint64_t Time;
+    llvm::sys::fs::file_status Status;
+    if (TimeAndPath.first.getAsInteger(10, Time) ||
+        llvm::sys::fs::status(TimeAndPath.second, Status) ||
+        !llvm::sys::fs::is_directory(Status) ||
+        Status.getLastModificationTime().toEpochTime() != Time)
+      return false;
+    ++NumDirs;
+  }
+
+  unsigned Probes = 0;
+  for (unsigned i = 0, e = Lines.size(); i != e; ++i) {
+    std::pair<StringRef, StringRef> Field = Lines[i].split(' ');
+    if (Field.first == "valid")
+      IsValid = Field.second == "1";
+    else if (Field.first == "triple")
+      GCCTriple.setTriple(Field.second);
+    else if (Field.first == "install-path")
+      GCCInstallPath = Field.second;
+    else if (Field.first == "biarch-suffix")
+      GCCBiarchSuffix = Field.second;
+    else if (Field.first == "parent-lib-path")
+      GCCParentLibPath = Field.second;
+    else if (Field.first == "version")
+      Version = GCCVersion::Parse(Field.second);
+    else if (Field.first == "candidate")
+      CandidateGCCInstallPaths.push_back(Field.second);
+    else if (Field.first == "probes")
+      Field.second.getAsInteger(10, Probes);
+  }
+  LoadedFromCache = true;
+  NumValidatedDirs = NumDirs;
+  NumCachedProbes = Probes;
+  return true;
+}
+
+void Generic_GCC::GCCInstallationDetector::saveToCache(
+    StringRef CachePath, StringRef Key, uint64_t StartTime) const {
+  // The paths below are made of the prefixes in the key and the names of the
+  // candidates; each has to fit on its line.
+  for (unsigned i = 0, e = CandidateGCCInstallPaths.size(); i != e; ++i)
+    if (StringRef(CandidateGCCInstallPaths[i]).find('\n') != StringRef::npos)
+      return;
+
+  std::string Entry = Key.str();
+  llvm::raw_string_ostream OS(Entry);
+  for (llvm::StringMap<uint64_t>::const_iterator I = ProbedDirs.begin(),
+                                                 E = ProbedDirs.end();
+       I != E; ++I) {
+    // Modification times only have a resolution of a second, so a directory
+    // changed since the search started could change again without it
+    // showing.  Try again next time.
+    if (I->getValue() >= StartTime)
+      return;
+    OS << "dir " << I->getValue() << " " << I->getKey() << "\n";
+  }
+  OS << "valid " << (IsValid ? "1" : "0") << "\n"
+     << "triple " << GCCTriple.str() << "\n"
+     << "install-path " << GCCInstallPath << "\n"
+     << "biarch-suffix " << GCCBiarchSuffix << "\n"
+     << "parent-lib-path " << GCCParentLibPath << "\n"
+     << "version " << Version.Text << "\n";
+  for (unsigned i = 0, e = CandidateGCCInstallPaths.size(); i != e; ++i)
+    OS << "candidate " << CandidateGCCInstallPaths[i] << "\n";
+  OS << "probes " << NumProbes << "\n";
+  OS.flush();
+
+  // Keep the entries for other keys, dropping an out of date one for this
+  // key.
+  std::string Cache;
+  OwningPtr<llvm::MemoryBuffer> OldCache;
+  if (!llvm::MemoryBuffer::getFile(CachePath, OldCache)) {
+    StringRef OldEntry;
+    splitCacheEntries(OldCache->getBuffer(), Key, OldEntry, Cache);
+  }
+  Cache += "entry\n" + Entry + "end\n";
+
+  // Write to a temporary file and rename it, so that drivers running at the
+  // same time never see half a cache.  The cache is only an optimization, so
+  // errors are ignored.
+  SmallString<128> TempPath(CachePath);
+  TempPath += "-%%%%%%%%";
+  int FD;
+  if (llvm::sys::fs::createUniqueFile(TempPath.str(), FD, TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    Out << Cache;
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath.str(), CachePath)) {
+    bool Existed;
+    llvm::sys::fs::remove(TempPath.str(), Existed);
+  }
+}
+
 Generic_GCC::Generic_GCC(const Driver &D, const llvm::Triple& Triple,
                          const ArgList &Args)
   : ToolChain(D, Triple, Args), GCCInstallation(getDriver(), Triple, Args) {
@@ -15,6 +15,7 @@
 #include "clang/Driver/Action.h"
 #include "clang/Driver/ToolChain.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Compiler.h"
 
 #include <vector>
@@ -71,6 +72,11 @@ protected:
   /// This class tries to find a GCC installation on the system, and report
   /// information about it. It starts from the host information provided to the
   /// Driver, and has logic for fuzzing that where appropriate.
+  ///
+  /// With --gcc-install-cache=<file>, the detected installation is saved in
+  /// <file> along with the modification times of the directories looked at,
+  /// and later drivers use it for as long as none of those directories
+  /// change, instead of searching again.
   class GCCInstallationDetector {
     bool IsValid;
     llvm::Triple GCCTriple;
@@ -86,6 +92,23 @@ protected:
     // order to print out detailed information in verbose mode.
     SmallVector<std::string, 4> CandidateGCCInstallPaths;
 
+    // The number of filesystem queries the search made.
+    unsigned NumProbes;
+
+    // Whether to note the directories the search depends on in ProbedDirs,
+    // which maps them to their modification times.
+    bool RecordProbes;
+    llvm::StringMap<uint64_t> ProbedDirs;
+
+    // Whether the installation cache is in use, whether the installation
+    // came from it, and if so, how many directories were checked to tell the
+    // cached installation is still valid and how many filesystem queries
+    // detecting it took.
+    bool UsesCache;
+    bool LoadedFromCache;
+    unsigned NumValidatedDirs;
+    unsigned NumCachedProbes;
+
   public:
     GCCInstallationDetector(const Driver &D, const llvm::Triple &TargetTriple,
                             const llvm::opt::ArgList &Args);
@@ -126,6 +149,40 @@ protected:
                                 const std::string &LibDir,
                                 StringRef CandidateTriple,
                                 bool NeedsBiarchSuffix = false);
+
+    bool findTargetBiarchSuffix(std::string &Suffix, StringRef Path,
+                                llvm::Triple::ArchType TargetArch,
+                                const llvm::opt::ArgList &Args);
+
+    /// \brief Check whether \p Path exists, noting what the answer depends
+    /// on.
+    bool probeExists(const Twine &Path);
+
+    /// \brief Note that the search listed the directory \p Dir, or failed
+    /// to.
+    void noteListing(StringRef Dir, bool Listed);
+
+    /// \brief Note that the search depends on the closest existing directory
+    /// containing \p Path.
+    void noteExistingParent(StringRef Path);
+
+    /// \brief Note that the search depends on the directory \p Dir, if it
+    /// exists.
+    bool noteDir(StringRef Dir);
+
+    /// \brief Compute the key the installation is cached under, returning
+    /// false if it cannot be cached.
+    static bool getCacheKey(const llvm::Triple &TargetTriple,
+                            const llvm::opt::ArgList &Args,
+                            ArrayRef<std::string> Prefixes, std::string &Key);
+
+    /// \brief Use the installation saved in the cache entry \p Entry if none
+    /// of the directories it depends on changed.
+    bool loadFromCache(StringRef Entry);
+
+    /// \brief Save the detected installation in the cache at \p CachePath.
+    void saveToCache(StringRef CachePath, StringRef Key,
+                     uint64_t StartTime) const;
   };
 
   GCCInstallationDetector GCCInstallation;
@@ -392,6 +392,12 @@ void Clang::AddPreprocessingOptions(Compilation &C,
   Args.AddAllArgs(CmdArgs, options::OPT_D, options::OPT_U);
   Args.AddAllArgs(CmdArgs, options::OPT_I_Group, options::OPT_F,
                   options::OPT_index_header_map);
+  Args.AddLastArg(CmdArgs, options::OPT_fheader_token_cache_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fstat_cache_EQ);
+  Args.AddLastArg(CmdArgs, options::OPT_fstat_cache_generation_EQ);
+  if (Args.hasFlag(options::OPT_fheader_search_listings,
+                   options::OPT_fno_header_search_listings, false))
+    CmdArgs.push_back("-fheader-search-listings");
 
   // Add -Wp, and -Xassembler if using the preprocessor.
 
@@ -19,6 +19,7 @@
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Basic/OnDiskHashTable.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Lex/HeaderTokenCache.h"
 #include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/ADT/StringExtras.h"
@@ -214,12 +215,27 @@ class PTHWriter {
   PTHEntry LexTokens(Lexer& L);
   Offset EmitCachedSpellings();
 
+  /// EmitPrologue - Emit the start of the prologue, leaving room for the
+  ///  offsets of the tables, and return its offset.
+  Offset EmitPrologue(const std::string &MainFile);
+
+  /// CacheFile - Lex the given file and add its tokens to the PTH file.
+  void CacheFile(const FileEntry *FE);
+
+  /// EmitTables - Emit the identifier, spelling and file tables, and
+  ///  backpatch their offsets into the prologue.
+  void EmitTables(Offset PrologueOffset);
+
 public:
   PTHWriter(llvm::raw_fd_ostream& out, Preprocessor& pp)
     : Out(out), PP(pp), idcount(0), CurStrOffset(0) {}
 
   PTHMap &getPM() { return PM; }
   void GeneratePTH(const std::string &MainFile);
+
+  /// GenerateHeaderPTH - Generate a PTH file holding the tokens of the
+  ///  header FE alone, for a header token cache.
+  void GenerateHeaderPTH(const FileEntry *FE);
 };
 } // end anonymous namespace
 
@@ -444,7 +460,7 @@ Offset PTHWriter::EmitCachedSpellings() {
   return SpellingsOff;
 }
 
-void PTHWriter::GeneratePTH(const std::string &MainFile) {
+Offset PTHWriter::EmitPrologue(const std::string &MainFile) {
   // Generate the prologue.
   Out << "cfe-pth" << '\0';
   Emit32(PTHManager::Version);
@@ -462,11 +478,23 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
     Emit16(0);
   }
   Emit8(0);
+  return PrologueOffset;
+}
+
+void PTHWriter::CacheFile(const FileEntry *FE) {
+  SourceManager &SM = PP.getSourceManager();
+  FileID FID = SM.createFileID(FE, SourceLocation(), SrcMgr::C_User);
+  const llvm::MemoryBuffer *FromFile = SM.getBuffer(FID);
+  Lexer L(FID, FromFile, SM, PP.getLangOpts());
+  PM.insert(FE, LexTokens(L));
+}
+
+void PTHWriter::GeneratePTH(const std::string &MainFile) {
+  Offset PrologueOffset = EmitPrologue(MainFile);
 
   // Iterate over all the files in SourceManager.  Create a lexer
   // for each file and cache the tokens.
   SourceManager &SM = PP.getSourceManager();
-  const LangOptions &LOpts = PP.getLangOpts();
 
   for (SourceManager::fileinfo_iterator I = SM.fileinfo_begin(),
        E = SM.fileinfo_end(); I != E; ++I) {
@@ -480,12 +508,19 @@ void PTHWriter::GeneratePTH(const std::string &MainFile) {
     const llvm::MemoryBuffer *B = C.getBuffer(PP.getDiagnostics(), SM);
     if (!B) continue;
 
-    FileID FID = SM.createFileID(FE, SourceLocation(), SrcMgr::C_User);
-    const llvm::MemoryBuffer *FromFile = SM.getBuffer(FID);
-    Lexer L(FID, FromFile, SM, LOpts);
-    PM.insert(FE, LexTokens(L));
+    CacheFile(FE);
   }
 
+  EmitTables(PrologueOffset);
+}
+
+void PTHWriter::GenerateHeaderPTH(const FileEntry *FE) {
+  Offset PrologueOffset = EmitPrologue("");
+  CacheFile(FE);
+  EmitTables(PrologueOffset);
+}
+
+void PTHWriter::EmitTables(Offset PrologueOffset) {
   // Write out the identifier table.
   const std::pair<Offset,Offset> &IdTableOff = EmitIdentifierTable();
 
@@ -561,6 +596,47 @@ void clang::CacheTokens(Preprocessor &PP, llvm::raw_fd_ostream* OS) {
   PW.GeneratePTH(MainFilePath.str());
 }
 
+void clang::CacheHeaderTokens(Preprocessor &PP) {
+  HeaderTokenCache *Cache = PP.getHeaderTokenCache();
+  if (!Cache || Cache->getMisses().empty())
+    return;
+
+  // The cache is only an optimization, so errors are ignored.
+  if (llvm::sys::fs::create_directories(Cache->getPath()))
+    return;
+
+  ArrayRef<const FileEntry *> Misses = Cache->getMisses();
+  for (unsigned i = 0, e = Misses.size(); i != e; ++i) {
+    std::string CacheFile = Cache->getCacheFile(Misses[i]);
+    if (CacheFile.empty())
+      continue;
+
+    // Write to a temporary file and rename it, so that compiles running at
+    // the same time never map half a cache file.
+    SmallString<128> TempPath(CacheFile);
+    TempPath += "-%%%%%%%%";
+    int FD;
+    if (llvm::sys::fs::createUniqueFile(TempPath.str(), FD, TempPath))
+      continue;
+    {
+      llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+      PTHWriter PW(Out, PP);
+      PW.GenerateHeaderPTH(Misses[i]);
+      Out.close();
+      if (Out.has_error()) {
+        Out.clear_error();
+        bool Existed;
+        llvm::sys::fs::remove(TempPath.str(), Existed);
+        continue;
+      }
+    }
+    if (llvm::sys::fs::rename(TempPath.str(), CacheFile)) {
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+    }
+  }
+}
+
 //===----------------------------------------------------------------------===//
 
 namespace {
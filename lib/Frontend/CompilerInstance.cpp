@@ -13,6 +13,7 @@
 #include "clang/AST/Decl.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
+#include "clang/Basic/PersistentStatCache.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Basic/Version.h"
@@ -50,7 +51,7 @@
 using namespace clang;
 
 CompilerInstance::CompilerInstance()
-  : Invocation(new CompilerInvocation()), ModuleManager(0),
+  : Invocation(new CompilerInvocation()), StatCache(0), ModuleManager(0),
     BuildGlobalModuleIndex(false), ModuleBuildFailed(false) {
 }
 
@@ -79,6 +80,7 @@ void CompilerInstance::setTarget(TargetInfo *Value) {
 
 void CompilerInstance::setFileManager(FileManager *Value) {
   FileMgr = Value;
+  StatCache = 0;
 }
 
 void CompilerInstance::setSourceManager(SourceManager *Value) {
@@ -198,6 +200,14 @@ CompilerInstance::createDiagnostics(DiagnosticOptions *Opts,
 
 void CompilerInstance::createFileManager() {
   FileMgr = new FileManager(getFileSystemOpts());
+  StatCache = 0;
+
+  const FileSystemOptions &FSOpts = getFileSystemOpts();
+  if (!FSOpts.StatCachePath.empty()) {
+    StatCache = PersistentStatCache::Create(FSOpts.StatCachePath,
+                                            FSOpts.StatCacheGeneration);
+    FileMgr->addStatCache(StatCache);
+  }
 }
 
 // Source Manager
@@ -235,6 +245,10 @@ void CompilerInstance::createPreprocessor() {
     PP->setPTHManager(PTHMgr);
   }
 
+  if (!PPOpts.HeaderTokenCachePath.empty())
+    PP->setHeaderTokenCache(new HeaderTokenCache(PPOpts.HeaderTokenCachePath,
+                                                 getLangOpts()));
+
   if (PPOpts.DetailedRecord)
     PP->createPreprocessingRecord();
 
@@ -709,6 +723,10 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
     }
   }
 
+  // Keep the stat() results the stat cache did not have for later compiles.
+  if (StatCache)
+    StatCache->save();
+
   // Notify the diagnostic client that all files were processed.
   getDiagnostics().getClient()->finish();
 
@@ -730,6 +748,8 @@ bool CompilerInstance::ExecuteAction(FrontendAction &Act) {
 
   if (getFrontendOpts().ShowStats && hasFileManager()) {
     getFileManager().PrintStats();
+    if (StatCache)
+      StatCache->PrintStats();
     OS << "\n";
   }
 
@@ -18,6 +18,7 @@
 #include "clang/Frontend/FrontendPluginRegistry.h"
 #include "clang/Frontend/LayoutOverrideSource.h"
 #include "clang/Frontend/MultiplexConsumer.h"
+#include "clang/Frontend/Utils.h"
 #include "clang/Lex/HeaderSearch.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Parse/ParseAST.h"
@@ -420,6 +421,12 @@ void FrontendAction::EndSourceFile() {
   if (CI.hasPreprocessor())
     CI.getPreprocessor().EndSourceFile();
 
+  // Save the tokens of the system headers missing from the header token
+  // cache, if there is one, for later compiles.  A compile with errors may
+  // have stopped in the middle of a header, so it saves none.
+  if (CI.hasPreprocessor() && !CI.getDiagnostics().hasErrorOccurred())
+    CacheHeaderTokens(CI.getPreprocessor());
+
   if (CI.getFrontendOpts().ShowStats) {
     llvm::errs() << "\nSTATISTICS FOR '" << getCurrentFile() << "':\n";
     CI.getPreprocessor().PrintStats();
@@ -22,6 +22,7 @@
 #include "llvm/Support/Capacity.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
 #include <cstdio>
 #if defined(LLVM_ON_UNIX)
 #include <limits.h>
@@ -58,12 +59,19 @@ HeaderSearch::HeaderSearch(IntrusiveRefCntPtr<HeaderSearchOptions> HSOpts,
   NumIncluded = 0;
   NumMultiIncludeFileOptzn = 0;
   NumFrameworkLookups = NumSubFrameworkLookups = 0;
+  NumDirectoriesListed = NumStatsAvoided = 0;
+  RetryingWithFreshListings = false;
 }
 
 HeaderSearch::~HeaderSearch() {
   // Delete headermaps.
   for (unsigned i = 0, e = HeaderMaps.size(); i != e; ++i)
     delete HeaderMaps[i].second;
+
+  for (llvm::StringMap<DirectoryListing *>::iterator
+         I = DirectoryListings.begin(), E = DirectoryListings.end();
+       I != E; ++I)
+    delete I->getValue();
 }
 
 void HeaderSearch::PrintStats() {
@@ -86,6 +94,12 @@ void HeaderSearch::PrintStats() {
 
   fprintf(stderr, "%d framework lookups.\n", NumFrameworkLookups);
   fprintf(stderr, "%d subframework lookups.\n", NumSubFrameworkLookups);
+
+  if (HSOpts->UseDirectoryListings) {
+    fprintf(stderr, "%d directories listed.\n", NumDirectoriesListed);
+    fprintf(stderr, "  %d stat calls avoided by directory listings.\n",
+            NumStatsAvoided);
+  }
 }
 
 /// CreateHeaderMap - This method returns a HeaderMap for the specified
@@ -243,6 +257,9 @@ const FileEntry *DirectoryLookup::LookupFile(
       RelativePath->clear();
       RelativePath->append(Filename.begin(), Filename.end());
     }
+
+    if (!HS.mayContainFile(getDir()->getName(), Filename))
+      return 0;
     
     // If we have a module map that might map this header, load it and
     // check whether we'll have a suggestion for a module.
@@ -522,12 +539,15 @@ const FileEntry *HeaderSearch::LookupFile(
     return FileMgr.getFile(Filename, /*openFile=*/true);
   }
 
+  unsigned NumStatsAvoidedBefore = NumStatsAvoided;
+
   // Unless disabled, check to see if the file is in the #includer's
   // directory.  This has to be based on CurFileEnt, not CurDir, because
   // CurFileEnt could be a #include of a subdirectory (#include "foo/bar.h") and
   // a subsequent include of "baz.h" should resolve to "whatever/foo/baz.h".
   // This search is not done for <> headers.
-  if (CurFileEnt && !isAngled && !NoCurDirSearch) {
+  if (CurFileEnt && !isAngled && !NoCurDirSearch &&
+      mayContainFile(CurFileEnt->getDir()->getName(), Filename)) {
     SmallString<1024> TmpDir;
     // Concatenate the requested file onto the directory.
     // FIXME: Portability.  Filename concatenation should be in sys::Path.
@@ -664,11 +684,133 @@ const FileEntry *HeaderSearch::LookupFile(
     }
   }
 
+  // If a directory listing ruled the file out, make sure that the directory
+  // did not change since it was listed before giving up.
+  if (NumStatsAvoided != NumStatsAvoidedBefore &&
+      !RetryingWithFreshListings && revalidateDirectoryListings()) {
+    RetryingWithFreshListings = true;
+    const FileEntry *Result = LookupFile(Filename, isAngled, FromDir, CurDir,
+                                         CurFileEnt, SearchPath, RelativePath,
+                                         SuggestedModule, /*SkipCache=*/true);
+    RetryingWithFreshListings = false;
+    return Result;
+  }
+
   // Otherwise, didn't find it. Remember we didn't find this.
   CacheLookup.second = SearchDirs.size();
   return 0;
 }
 
+/// \brief The key under which \p Name is kept in a directory listing.  Names
+/// are compared without regard to case where file systems usually do so, so
+/// that a listing never rules out a file that stat() would find.  Elsewhere,
+/// listings must not be used with case-insensitive file systems.
+static std::string getListingKey(StringRef Name) {
+#if defined(_WIN32) || defined(__APPLE__)
+  return Name.lower();
+#else
+  return Name;
+#endif
+}
+
+bool HeaderSearch::mayContainFile(StringRef DirName, StringRef Filename) {
+  if (!HSOpts->UseDirectoryListings)
+    return true;
+
+  // Check each component of the file name against the listing of the
+  // directory it should be in.
+  SmallString<1024> Path(DirName);
+  for (llvm::sys::path::const_iterator I = llvm::sys::path::begin(Filename),
+                                       E = llvm::sys::path::end(Filename);
+       I != E; ++I) {
+    if (*I == "." || *I == "..")
+      return true;
+
+    const DirectoryListing *Listing = getDirectoryListing(Path);
+    if (!Listing)
+      return true;
+    if (!Listing->Names.count(getListingKey(*I))) {
+      ++NumStatsAvoided;
+      return false;
+    }
+    llvm::sys::path::append(Path, *I);
+  }
+  return true;
+}
+
+const HeaderSearch::DirectoryListing *
+HeaderSearch::getDirectoryListing(StringRef DirName) {
+  DirectoryListing *&Listing = DirectoryListings[DirName];
+  if (Listing)
+    return Listing->Valid ? Listing : 0;
+
+  Listing = new DirectoryListing();
+  SmallString<128> DirNative(DirName);
+  FileMgr.FixupRelativePath(DirNative);
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(DirNative.str(), Status) ||
+      !llvm::sys::fs::is_directory(Status))
+    return 0;
+
+  // The modification time only has a resolution of a second, so a file
+  // created within the second the directory was last modified would go
+  // unnoticed when revalidating.  Don't trust the listing of such a directory.
+  time_t ModTime = Status.getLastModificationTime().toEpochTime();
+  if (ModTime + 1 >= time_t(llvm::sys::TimeValue::now().toEpochTime()))
+    return 0;
+
+  llvm::error_code EC;
+  for (llvm::sys::fs::directory_iterator Dir(DirNative.str(), EC), DirEnd;
+       Dir != DirEnd && !EC; Dir.increment(EC))
+    Listing->Names.insert(getListingKey(llvm::sys::path::filename(
+                                          Dir->path())));
+  if (EC)
+    return 0;
+
+  // Virtual files are found by the file manager without being on disk, so
+  // they and the directories leading to them are part of the listing.
+  SmallVector<const FileEntry *, 4> VirtualFiles;
+  FileMgr.GetVirtualFiles(VirtualFiles);
+  for (unsigned i = 0, e = VirtualFiles.size(); i != e; ++i) {
+    StringRef Child = VirtualFiles[i]->getName();
+    for (StringRef Parent = llvm::sys::path::parent_path(Child);
+         !Parent.empty(); Child = Parent,
+           Parent = llvm::sys::path::parent_path(Parent)) {
+      if (Parent == DirName) {
+        Listing->Names.insert(getListingKey(llvm::sys::path::filename(Child)));
+        break;
+      }
+    }
+  }
+
+  Listing->Valid = true;
+  Listing->ModTime = ModTime;
+  ++NumDirectoriesListed;
+  return Listing;
+}
+
+bool HeaderSearch::revalidateDirectoryListings() {
+  bool Dropped = false;
+  for (llvm::StringMap<DirectoryListing *>::iterator
+         I = DirectoryListings.begin(), E = DirectoryListings.end();
+       I != E; /* in loop */) {
+    llvm::StringMap<DirectoryListing *>::iterator Current = I++;
+    DirectoryListing *Listing = Current->getValue();
+    if (!Listing->Valid)
+      continue;
+
+    llvm::sys::fs::file_status Status;
+    if (!FileMgr.getNoncachedStatValue(Current->getKey(), Status) &&
+        Status.getLastModificationTime().toEpochTime() == Listing->ModTime)
+      continue;
+
+    delete Listing;
+    DirectoryListings.erase(Current);
+    Dropped = true;
+  }
+  return Dropped;
+}
+
 /// LookupSubframeworkHeader - Look up a subframework for the specified
 /// \#include file.  For example, if \#include'ing <HIToolbox/HIToolbox.h> from
 /// within ".../Carbon.framework/Headers/Carbon.h", check to see if HIToolbox
@@ -0,0 +1,119 @@
+//===--- HeaderTokenCache.cpp - Cached system header tokens ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the HeaderTokenCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderTokenCache.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
+#include "clang/Lex/PTHManager.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace clang;
+
+HeaderTokenCache::HeaderTokenCache(StringRef Path, const LangOptions &LangOpts)
+  : Path(Path), NumHits(0) {
+  OptionsHash = llvm::hash_combine(getClangFullRepositoryVersion(),
+                                   unsigned(PTHManager::Version));
+  // The options the lexer looks at.
+  OptionsHash = llvm::hash_combine(OptionsHash, LangOpts.C99, LangOpts.C11,
+                                   LangOpts.CPlusPlus, LangOpts.CPlusPlus11,
+                                   LangOpts.CPlusPlus1y);
+  OptionsHash = llvm::hash_combine(OptionsHash, LangOpts.LineComment,
+                                   LangOpts.Digraphs, LangOpts.Trigraphs,
+                                   LangOpts.DollarIdents,
+                                   LangOpts.MicrosoftExt);
+  OptionsHash = llvm::hash_combine(OptionsHash, LangOpts.ObjC1,
+                                   LangOpts.AsmPreprocessor,
+                                   LangOpts.TraditionalCPP, LangOpts.CUDA);
+}
+
+HeaderTokenCache::~HeaderTokenCache() {
+  for (llvm::DenseMap<const FileEntry *, PTHManager *>::iterator
+         I = Headers.begin(), E = Headers.end(); I != E; ++I)
+    delete I->second;
+}
+
+std::string HeaderTokenCache::getCacheFile(const FileEntry *File) const {
+  StringRef Name = File->getName();
+  if (llvm::sys::path::is_relative(Name))
+    return std::string();
+
+  llvm::sys::fs::UniqueID UID = File->getUniqueID();
+  llvm::hash_code Hash =
+    llvm::hash_combine(OptionsHash, Name, UID.getDevice(), UID.getFile(),
+                       uint64_t(File->getSize()),
+                       uint64_t(File->getModificationTime()));
+  SmallString<128> CacheFile(Path);
+  llvm::sys::path::append(CacheFile,
+                          llvm::sys::path::filename(Name) + "-" +
+                          llvm::APInt(64, Hash).toString(36, false) + ".pth");
+  return CacheFile.str();
+}
+
+PTHLexer *HeaderTokenCache::createLexer(Preprocessor &PP, FileID FID) {
+  // Cached tokens come without the comments and the warnings of the lexer,
+  // so only use them where neither is wanted.
+  if (PP.getCommentRetentionState() ||
+      !PP.getDiagnostics().getSuppressSystemWarnings())
+    return 0;
+
+  bool Invalid = false;
+  const SrcMgr::SLocEntry &Entry =
+    PP.getSourceManager().getSLocEntry(FID, &Invalid);
+  if (Invalid || !Entry.isFile() ||
+      Entry.getFile().getFileCharacteristic() == SrcMgr::C_User)
+    return 0;
+
+  // Headers whose contents were overridden have to be lexed from the buffer
+  // they were given.
+  const SrcMgr::ContentCache *Content = Entry.getFile().getContentCache();
+  const FileEntry *File = Content->OrigEntry;
+  if (!File || Content->BufferOverridden || Content->ContentsEntry != File)
+    return 0;
+
+  std::pair<llvm::DenseMap<const FileEntry *, PTHManager *>::iterator, bool>
+    Known = Headers.insert(std::make_pair(File, (PTHManager *)0));
+  if (!Known.second) {
+    PTHManager *PTHMgr = Known.first->second;
+    return PTHMgr ? PTHMgr->CreateLexer(FID) : 0;
+  }
+
+  std::string CacheFile = getCacheFile(File);
+  if (CacheFile.empty())
+    return 0;
+
+  PTHLexer *Lexer = 0;
+  if (PTHManager *PTHMgr = PTHManager::CreateForHeader(CacheFile, PP)) {
+    Lexer = PTHMgr->CreateLexer(FID);
+    if (Lexer)
+      Known.first->second = PTHMgr;
+    else
+      delete PTHMgr;
+  }
+
+  if (Lexer)
+    ++NumHits;
+  else
+    Misses.push_back(File);
+  return Lexer;
+}
+
+void HeaderTokenCache::PrintStats() const {
+  llvm::errs() << "\n*** Header Token Cache Stats:\n";
+  llvm::errs() << NumHits << " system headers read from the cache, "
+               << Misses.size() << " missing from it.\n";
+}
@@ -38,6 +38,14 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "UnicodeCharSets.h"
 #include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#elif __ALTIVEC__
+#include <altivec.h>
+#undef bool
+#endif
+
 using namespace clang;
 
 //===----------------------------------------------------------------------===//
@@ -1419,14 +1427,132 @@ static void maybeDiagnoseIDCharCompat(DiagnosticsEngine &Diags, uint32_t C,
   }
  }
 
+//===----------------------------------------------------------------------===//
+// Fast scanning loops
+//===----------------------------------------------------------------------===//
+
+// Each of these returns the first character at or after CurPtr that the loop
+// it implements stops at.  With SSE2, 16 characters are classified at a time
+// for as long as they all come before BufferEnd, and the scalar loop handles
+// the rest.  None of them skip '\0', so the nul terminating the buffer (or
+// marking a code completion point) always stops the scan.
+
+#ifdef __SSE2__
+/// Mark the bytes of \p Chars that are in the range [Lo, Hi].
+static inline __m128i inCharRange(__m128i Chars, unsigned char Lo,
+                                  unsigned char Hi) {
+  // SSE2 only compares signed bytes; move Lo to -128 so that one comparison
+  // checks both bounds.
+  __m128i Biased = _mm_add_epi8(Chars, _mm_set1_epi8((char)(0x80 - Lo)));
+  return _mm_cmplt_epi8(Biased, _mm_set1_epi8((char)(0x80 + Hi - Lo + 1)));
+}
+
+/// Mark the bytes of \p Chars equal to \p C.
+static inline __m128i isChar(__m128i Chars, char C) {
+  return _mm_cmpeq_epi8(Chars, _mm_set1_epi8(C));
+}
+
+/// Return the index of the first byte not marked in \p Marked, or 16.
+static inline unsigned findFirstUnmarked(__m128i Marked) {
+  unsigned Mask = ~_mm_movemask_epi8(Marked) & 0xFFFF;
+  return Mask ? llvm::countTrailingZeros(Mask) : 16;
+}
+#endif
+
+/// Skip [_A-Za-z0-9]*.
+static const char *skipIdentifierBody(const char *CurPtr,
+                                      const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chars = _mm_loadu_si128((const __m128i *)CurPtr);
+    // Setting bit 5 maps upper case letters to lower case ones, and nothing
+    // else to a letter.
+    __m128i Lower = _mm_or_si128(Chars, _mm_set1_epi8(0x20));
+    __m128i Body = _mm_or_si128(_mm_or_si128(inCharRange(Lower, 'a', 'z'),
+                                             inCharRange(Chars, '0', '9')),
+                                isChar(Chars, '_'));
+    unsigned Index = findFirstUnmarked(Body);
+    if (Index != 16)
+      return CurPtr + Index;
+    CurPtr += 16;
+  }
+#endif
+  while (isIdentifierBody(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// Skip [ \t\f\v]*.
+static const char *skipHorizontalWhitespace(const char *CurPtr,
+                                            const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chars = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Space = _mm_or_si128(_mm_or_si128(isChar(Chars, ' '),
+                                              isChar(Chars, '\t')),
+                                 inCharRange(Chars, '\v', '\f'));
+    unsigned Index = findFirstUnmarked(Space);
+    if (Index != 16)
+      return CurPtr + Index;
+    CurPtr += 16;
+  }
+#endif
+  while (isHorizontalWhitespace(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// Skip [^\n\r\0]*, the body of a line comment.
+static const char *skipLineCommentBody(const char *CurPtr,
+                                       const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chars = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i End = _mm_or_si128(_mm_or_si128(isChar(Chars, '\n'),
+                                            isChar(Chars, '\r')),
+                               isChar(Chars, '\0'));
+    int Mask = _mm_movemask_epi8(End);
+    if (Mask)
+      return CurPtr + llvm::countTrailingZeros<unsigned>(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (*CurPtr != 0 && *CurPtr != '\n' && *CurPtr != '\r')
+    ++CurPtr;
+  return CurPtr;
+}
+
+/// Skip the characters of a string literal that getAndAdvanceChar would
+/// return one at a time without looking at them: anything but the closing
+/// quote, '\\', '?' (which may start a trigraph), newlines and '\0'.
+static const char *skipPlainStringChars(const char *CurPtr,
+                                        const char *BufferEnd) {
+#ifdef __SSE2__
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chars = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Special =
+      _mm_or_si128(_mm_or_si128(_mm_or_si128(isChar(Chars, '"'),
+                                             isChar(Chars, '\\')),
+                                _mm_or_si128(isChar(Chars, '?'),
+                                             isChar(Chars, '\n'))),
+                   _mm_or_si128(isChar(Chars, '\r'), isChar(Chars, '\0')));
+    int Mask = _mm_movemask_epi8(Special);
+    if (Mask)
+      return CurPtr + llvm::countTrailingZeros<unsigned>(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (*CurPtr != '"' && *CurPtr != '\\' && *CurPtr != '?' &&
+         *CurPtr != '\n' && *CurPtr != '\r' && *CurPtr != 0)
+    ++CurPtr;
+  return CurPtr;
+}
+
 void Lexer::LexIdentifier(Token &Result, const char *CurPtr) {
   // Match [_A-Za-z0-9]*, we have already matched [_A-Za-z$]
   unsigned Size;
-  unsigned char C = *CurPtr++;
-  while (isIdentifierBody(C))
-    C = *CurPtr++;
-
-  --CurPtr;   // Back up over the skipped character.
+  CurPtr = skipIdentifierBody(CurPtr, BufferEnd);
+  unsigned char C = *CurPtr;
 
   // Fast path, no $,\,? in identifier found.  '\' might be an escaped newline
   // or UCN, and ? might be a trigraph for '\', an escaped newline or UCN.
@@ -1674,6 +1800,7 @@ void Lexer::LexStringLiteral(Token &Result, const char *CurPtr,
 
       NulCharacter = CurPtr-1;
     }
+    CurPtr = skipPlainStringChars(CurPtr, BufferEnd);
     C = getAndAdvanceChar(CurPtr, Result);
   }
 
@@ -1877,9 +2004,13 @@ bool Lexer::SkipWhitespace(Token &Result, const char *CurPtr) {
 
   // Skip consecutive spaces efficiently.
   while (1) {
-    // Skip horizontal whitespace very aggressively.
-    while (isHorizontalWhitespace(Char))
-      Char = *++CurPtr;
+    // Skip horizontal whitespace very aggressively.  A single space between
+    // tokens is by far the most common case; longer runs, like indentation,
+    // are worth a vector scan.
+    if (isHorizontalWhitespace(Char)) {
+      CurPtr = skipHorizontalWhitespace(CurPtr + 1, BufferEnd);
+      Char = *CurPtr;
+    }
 
     // Otherwise if we have something other than whitespace, we're done.
     if (!isVerticalWhitespace(Char))
@@ -1939,11 +2070,10 @@ bool Lexer::SkipLineComment(Token &Result, const char *CurPtr) {
   // them.  As such, optimize for this case with the inner loop.
   char C;
   do {
+    // Skip over characters in the fast loop, up to a potential EOF, a newline
+    // or a DOS-style newline.
+    CurPtr = skipLineCommentBody(CurPtr, BufferEnd);
     C = *CurPtr;
-    // Skip over characters in the fast loop.
-    while (C != 0 &&                // Potentially EOF.
-           C != '\n' && C != '\r')  // Newline or DOS-style newline.
-      C = *++CurPtr;
 
     const char *NextLine = CurPtr;
     if (C != 0) {
@@ -2136,13 +2266,6 @@ static bool isEndOfBlockCommentWithEscapedNewLine(const char *CurPtr,
   return true;
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-#elif __ALTIVEC__
-#include <altivec.h>
-#undef bool
-#endif
-
 /// We have just read from input the / and * characters that started a comment.
 /// Read until we find the * and / characters that terminate the comment.
 /// Note that we don't bother decoding trigraphs or escaped newlines in block
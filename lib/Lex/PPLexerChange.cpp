@@ -82,6 +82,15 @@ void Preprocessor::EnterSourceFile(FileID FID, const DirectoryLookup *CurDir,
       return;
     }
   }
+
+  // Code completion needs the file it completes in to be lexed, which is
+  // most easily ensured by not using the cache at all.
+  if (HeaderTokens && !isCodeCompletionEnabled()) {
+    if (PTHLexer *PL = HeaderTokens->createLexer(*this, FID)) {
+      EnterSourceFileWithPTH(PL, CurDir);
+      return;
+    }
+  }
   
   // Get the MemoryBuffer for this FID, if it fails, we fail.
   bool Invalid = false;
@@ -307,12 +307,18 @@ namespace {
 class PTHFileData {
   const uint32_t TokenOff;
   const uint32_t PPCondOff;
+  const uint64_t ModTime;
+  const uint64_t Size;
 public:
-  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff)
-    : TokenOff(tokenOff), PPCondOff(ppCondOff) {}
+  PTHFileData(uint32_t tokenOff, uint32_t ppCondOff, uint64_t modTime,
+              uint64_t size)
+    : TokenOff(tokenOff), PPCondOff(ppCondOff), ModTime(modTime),
+      Size(size) {}
 
   uint32_t getTokenOffset() const { return TokenOff; }
   uint32_t getPPCondOffset() const { return PPCondOff; }
+  uint64_t getModTime() const { return ModTime; }
+  uint64_t getSize() const { return Size; }
 };
 
 
@@ -355,7 +361,10 @@ public:
     assert(k.first == 0x1 && "Only file lookups can match!");
     uint32_t x = ::ReadUnalignedLE32(d);
     uint32_t y = ::ReadUnalignedLE32(d);
-    return PTHFileData(x, y);
+    d += 8 * 2; // Skip the unique ID of the file.
+    uint64_t ModTime = ::ReadUnalignedLE64(d);
+    uint64_t Size = ::ReadUnalignedLE64(d);
+    return PTHFileData(x, y, ModTime, Size);
   }
 };
 
@@ -418,7 +427,8 @@ PTHManager::PTHManager(const llvm::MemoryBuffer* buf, void* fileLookup,
 : Buf(buf), PerIDCache(perIDCache), FileLookup(fileLookup),
   IdDataTable(idDataTable), StringIdLookup(stringIdLookup),
   NumIds(numIds), PP(0), SpellingBase(spellingBase),
-  OriginalSourceFile(originalSourceFile) {}
+  OriginalSourceFile(originalSourceFile),
+  IdentifiersFromPreprocessor(false) {}
 
 PTHManager::~PTHManager() {
   delete Buf;
@@ -427,18 +437,39 @@ PTHManager::~PTHManager() {
   free(PerIDCache);
 }
 
-static void InvalidPTH(DiagnosticsEngine &Diags, const char *Msg) {
-  Diags.Report(Diags.getCustomDiagID(DiagnosticsEngine::Error, Msg));
+static void InvalidPTH(DiagnosticsEngine *Diags, const char *Msg) {
+  if (Diags)
+    Diags->Report(Diags->getCustomDiagID(DiagnosticsEngine::Error, Msg));
+}
+
+static void InvalidPTHFile(DiagnosticsEngine *Diags, const std::string &file) {
+  if (Diags)
+    Diags->Report(diag::err_invalid_pth_file) << file;
 }
 
 PTHManager *PTHManager::Create(const std::string &file,
                                DiagnosticsEngine &Diags) {
+  return Load(file, &Diags);
+}
+
+PTHManager *PTHManager::CreateForHeader(const std::string &file,
+                                        Preprocessor &PP) {
+  PTHManager *PTHMgr = Load(file, 0);
+  if (!PTHMgr)
+    return 0;
+  PTHMgr->IdentifiersFromPreprocessor = true;
+  PTHMgr->setPreprocessor(&PP);
+  return PTHMgr;
+}
+
+PTHManager *PTHManager::Load(const std::string &file,
+                             DiagnosticsEngine *Diags) {
   // Memory map the PTH file.
   OwningPtr<llvm::MemoryBuffer> File;
 
   if (llvm::MemoryBuffer::getFile(file, File)) {
     // FIXME: Add ec.message() to this diag.
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0;
   }
 
@@ -450,7 +481,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   // Check the prologue of the file.
   if ((BufEnd - BufBeg) < (signed)(sizeof("cfe-pth") + 4 + 4) ||
       memcmp(BufBeg, "cfe-pth", sizeof("cfe-pth")) != 0) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0;
   }
 
@@ -470,7 +501,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char *PrologueOffset = p;
 
   if (PrologueOffset >= BufEnd) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0;
   }
 
@@ -480,7 +511,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* FileTable = BufBeg + ReadLE32(FileTableOffset);
 
   if (!(FileTable > BufBeg && FileTable < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0; // FIXME: Proper error diagnostic?
   }
 
@@ -497,7 +528,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* IData = BufBeg + ReadLE32(IDTableOffset);
 
   if (!(IData >= BufBeg && IData < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0;
   }
 
@@ -506,7 +537,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* StringIdTableOffset = PrologueOffset + sizeof(uint32_t)*1;
   const unsigned char* StringIdTable = BufBeg + ReadLE32(StringIdTableOffset);
   if (!(StringIdTable >= BufBeg && StringIdTable < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0;
   }
 
@@ -517,7 +548,7 @@ PTHManager *PTHManager::Create(const std::string &file,
   const unsigned char* spellingBaseOffset = PrologueOffset + sizeof(uint32_t)*3;
   const unsigned char* spellingBase = BufBeg + ReadLE32(spellingBaseOffset);
   if (!(spellingBase >= BufBeg && spellingBase < BufEnd)) {
-    Diags.Report(diag::err_invalid_pth_file) << file;
+    InvalidPTHFile(Diags, file);
     return 0;
   }
 
@@ -555,6 +586,12 @@ IdentifierInfo* PTHManager::LazilyCreateIdentifierInfo(unsigned PersistentID) {
     (const unsigned char*)Buf->getBufferStart() + ReadLE32(TableEntry);
   assert(IDData < (const unsigned char*)Buf->getBufferEnd());
 
+  if (IdentifiersFromPreprocessor) {
+    IdentifierInfo *II = PP->getIdentifierInfo((const char*) IDData);
+    PerIDCache[PersistentID] = II;
+    return II;
+  }
+
   // Allocate the object.
   std::pair<IdentifierInfo,const unsigned char*> *Mem =
     Alloc.Allocate<std::pair<IdentifierInfo,const unsigned char*> >();
@@ -599,6 +636,11 @@ PTHLexer *PTHManager::CreateLexer(FileID FID) {
 
   const PTHFileData& FileData = *I;
 
+  // Tokens cached before the file last changed are of no use.
+  if (FileData.getModTime() != (uint64_t) FE->getModificationTime() ||
+      FileData.getSize() != (uint64_t) FE->getSize())
+    return 0;
+
   const unsigned char *BufStart = (const unsigned char *)Buf->getBufferStart();
   // Compute the offset of the token data within the buffer.
   const unsigned char* data = BufStart + FileData.getTokenOffset();
@@ -697,6 +739,15 @@ public:
     if (!D.HasData)
       return CacheMissing;
 
+    // The tokens of a file are only used while it is unchanged (see
+    // PTHManager::CreateLexer), which only a real stat can tell.
+    if (!D.IsDirectory) {
+      LookupResult Result = statChained(Path, Data, isFile, FileDescriptor);
+      if (Result == CacheExists)
+        Data.InPCH = Data.Size == D.Size && Data.ModTime == D.ModTime;
+      return Result;
+    }
+
     Data.Size = D.Size;
     Data.ModTime = D.ModTime;
     Data.UniqueID = D.UniqueID;
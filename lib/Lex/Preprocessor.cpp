@@ -247,6 +247,9 @@ void Preprocessor::PrintStats() {
              << " token paste (##) operations performed, "
              << NumFastTokenPaste << " on the fast path.\n";
 
+  if (HeaderTokens)
+    HeaderTokens->PrintStats();
+
   llvm::errs() << "\nPreprocessor Memory: " << getTotalMemory() << "B total";
 
   llvm::errs() << "\n  BumpPtr: " << BP.getTotalMemory();
@@ -12,12 +12,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "clang/Tooling/JSONCompilationDatabase.h"
+#include "clang/Basic/CharInfo.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "clang/Tooling/CompilationDatabasePluginRegistry.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include <cstdlib>
 
 namespace clang {
 namespace tooling {
@@ -117,15 +122,240 @@ std::vector<std::string> unescapeCommandLine(
   return parser.parse();
 }
 
+/// \brief A scanner for the JSON tokens of a compilation database.
+///
+/// Strings are returned as they are in the input, still escaped, so that
+/// scanning does not need to copy anything.
+class JSONScanner {
+ public:
+  JSONScanner(StringRef Input) : Input(Input), Position(0) {}
+
+  /// \brief Skips whitespace and consumes \p C if it comes next.
+  bool consume(char C) {
+    skipWhitespace();
+    if (Position == Input.size() || Input[Position] != C)
+      return false;
+    ++Position;
+    return true;
+  }
+
+  /// \brief Skips whitespace and scans the string that comes next into
+  /// \p Contents, without its quotes.
+  ///
+  /// Sets ErrorMessage to \p Expected if no string comes next.
+  bool scanString(StringRef &Contents, std::string &ErrorMessage,
+                  StringRef Expected) {
+    if (!consume('"')) {
+      ErrorMessage = Expected.str();
+      return false;
+    }
+    size_t Begin = Position;
+    while (Position != Input.size()) {
+      char C = Input[Position++];
+      if (C == '"') {
+        Contents = Input.slice(Begin, Position - 1);
+        return true;
+      }
+      if (C == '\\' && !skipEscapeSequence()) {
+        ErrorMessage = "Invalid escape sequence in string.";
+        return false;
+      }
+    }
+    ErrorMessage = "Unterminated string.";
+    return false;
+  }
+
+  /// \brief Returns whether only whitespace is left.
+  bool atEnd() {
+    skipWhitespace();
+    return Position == Input.size();
+  }
+
+ private:
+  void skipWhitespace() {
+    while (Position != Input.size() &&
+           (Input[Position] == ' ' || Input[Position] == '\n' ||
+            Input[Position] == '\r' || Input[Position] == '\t'))
+      ++Position;
+  }
+
+  bool skipEscapeSequence() {
+    if (Position == Input.size())
+      return false;
+    switch (Input[Position++]) {
+    case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r':
+    case 't':
+      return true;
+    case 'u':
+      for (unsigned I = 0; I != 4; ++I, ++Position)
+        if (Position == Input.size() || !isHexDigit(Input[Position]))
+          return false;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  const StringRef Input;
+  size_t Position;
+};
+
+/// \brief Appends the UTF-8 encoding of \p CodePoint to \p Result.
+void appendUTF8(unsigned CodePoint, SmallVectorImpl<char> &Result) {
+  if (CodePoint < 0x80) {
+    Result.push_back(CodePoint);
+  } else if (CodePoint < 0x800) {
+    Result.push_back(0xC0 | (CodePoint >> 6));
+    Result.push_back(0x80 | (CodePoint & 0x3F));
+  } else if (CodePoint < 0x10000) {
+    Result.push_back(0xE0 | (CodePoint >> 12));
+    Result.push_back(0x80 | ((CodePoint >> 6) & 0x3F));
+    Result.push_back(0x80 | (CodePoint & 0x3F));
+  } else {
+    Result.push_back(0xF0 | (CodePoint >> 18));
+    Result.push_back(0x80 | ((CodePoint >> 12) & 0x3F));
+    Result.push_back(0x80 | ((CodePoint >> 6) & 0x3F));
+    Result.push_back(0x80 | (CodePoint & 0x3F));
+  }
+}
+
+/// \brief Reads the four hex digits of a \u escape starting at \p Position.
+bool readHexQuad(StringRef String, size_t Position, unsigned &Value) {
+  return Position + 4 <= String.size() &&
+         !String.substr(Position, 4).getAsInteger(16, Value);
+}
+
+/// \brief Returns the value of the JSON string with the escaped contents
+/// \p Contents.
+///
+/// Strings without escapes are returned as they are; others are unescaped
+/// into \p Storage.
+StringRef unescapeJSONString(StringRef Contents,
+                             SmallVectorImpl<char> &Storage) {
+  size_t Escape = Contents.find('\\');
+  if (Escape == StringRef::npos)
+    return Contents;
+  Storage.clear();
+  Storage.append(Contents.begin(), Contents.begin() + Escape);
+  for (size_t I = Escape, E = Contents.size(); I != E; ++I) {
+    if (Contents[I] != '\\') {
+      Storage.push_back(Contents[I]);
+      continue;
+    }
+    if (++I == E) {
+      Storage.push_back('\\');
+      break;
+    }
+    switch (Contents[I]) {
+    case 'b': Storage.push_back('\b'); break;
+    case 'f': Storage.push_back('\f'); break;
+    case 'n': Storage.push_back('\n'); break;
+    case 'r': Storage.push_back('\r'); break;
+    case 't': Storage.push_back('\t'); break;
+    case 'u': {
+      unsigned CodePoint;
+      if (!readHexQuad(Contents, I + 1, CodePoint)) {
+        Storage.push_back('u');
+        break;
+      }
+      I += 4;
+      // Characters outside the BMP are written as UTF-16 surrogate pairs.
+      unsigned Low;
+      if (CodePoint >= 0xD800 && CodePoint < 0xDC00 &&
+          Contents.substr(I + 1, 2) == "\\u" &&
+          readHexQuad(Contents, I + 3, Low) && Low >= 0xDC00 && Low < 0xE000) {
+        CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (Low - 0xDC00);
+        I += 6;
+      }
+      appendUTF8(CodePoint, Storage);
+      break;
+    }
+    default:
+      Storage.push_back(Contents[I]);
+      break;
+    }
+  }
+  return StringRef(Storage.data(), Storage.size());
+}
+
+/// \brief The first bytes of a saved index; the last one is the version of
+/// the format.
+const char IndexMagic[8] = { 'J', 'S', 'O', 'N', 'C', 'D', 'B', 2 };
+
+/// \brief Databases smaller than this are scanned faster than their index
+/// can be written, so the plugin does not bother saving one.
+const uint64_t MinIndexedDatabaseSize = 1 << 20;
+
+void writeIndexInteger(raw_ostream &OS, uint64_t Value) {
+  for (unsigned I = 0; I != 8; ++I)
+    OS << char(Value >> (8 * I));
+}
+
+/// \brief Hashes the contents of a database (64 bit FNV-1a), which is the
+/// same in every process, unlike llvm::hash_value.
+uint64_t hashDatabase(StringRef Contents) {
+  uint64_t Hash = 14695981039346656037ULL;
+  for (size_t I = 0, E = Contents.size(); I != E; ++I) {
+    Hash ^= (unsigned char)Contents[I];
+    Hash *= 1099511628211ULL;
+  }
+  return Hash;
+}
+
+/// \brief Reads the fields of a saved index, which are stored as 64 bit
+/// little endian integers and strings prefixed by their length.
+class IndexReader {
+ public:
+  IndexReader(StringRef Index) : Index(Index), Position(0) {}
+
+  bool read(uint64_t &Value) {
+    if (Index.size() - Position < 8)
+      return false;
+    Value = 0;
+    for (unsigned I = 0; I != 8; ++I)
+      Value |= uint64_t((unsigned char)Index[Position + I]) << (8 * I);
+    Position += 8;
+    return true;
+  }
+
+  bool read(StringRef &String) {
+    uint64_t Size;
+    if (!read(Size) || Index.size() - Position < Size)
+      return false;
+    String = Index.substr(Position, Size);
+    Position += Size;
+    return true;
+  }
+
+  bool atEnd() const { return Position == Index.size(); }
+
+ private:
+  const StringRef Index;
+  size_t Position;
+};
+
 class JSONCompilationDatabasePlugin : public CompilationDatabasePlugin {
   virtual CompilationDatabase *loadFromDirectory(
       StringRef Directory, std::string &ErrorMessage) {
     SmallString<1024> JSONDatabasePath(Directory);
     llvm::sys::path::append(JSONDatabasePath, "compile_commands.json");
-    OwningPtr<CompilationDatabase> Database(
+    OwningPtr<JSONCompilationDatabase> Database(
         JSONCompilationDatabase::loadFromFile(JSONDatabasePath, ErrorMessage));
     if (!Database)
       return NULL;
+    // Save the index of large databases for the next tool that needs them,
+    // if asked to; loading a database does not write to the build directory
+    // otherwise.  The index is only an optimization, so failing to write it
+    // is fine.
+    llvm::sys::fs::file_status Status;
+    const char *SaveIndex = ::getenv("CLANG_COMPILATION_DATABASE_INDEX");
+    if (SaveIndex && *SaveIndex && !Database->wasLoadedFromIndex() &&
+        !llvm::sys::fs::status(JSONDatabasePath.str(), Status) &&
+        Status.getSize() >= MinIndexedDatabaseSize) {
+      std::string IndexError;
+      Database->writeIndex(
+          JSONCompilationDatabase::getIndexPath(JSONDatabasePath), IndexError);
+    }
     return Database.take();
   }
 };
@@ -144,15 +374,41 @@ volatile int JSONAnchorSource = 0;
 JSONCompilationDatabase *
 JSONCompilationDatabase::loadFromFile(StringRef FilePath,
                                       std::string &ErrorMessage) {
+  // Look at the file before reading it: if it changes in between, the
+  // index written for it will be out of date right away, rather than
+  // looking up to date when it is not.
+  llvm::sys::fs::file_status Status;
+  bool HasStatus = !llvm::sys::fs::status(FilePath, Status);
   OwningPtr<llvm::MemoryBuffer> DatabaseBuffer;
+  // Without a null terminator the file can always be memory mapped.
   llvm::error_code Result =
-    llvm::MemoryBuffer::getFile(FilePath, DatabaseBuffer);
+    llvm::MemoryBuffer::getFile(FilePath, DatabaseBuffer, -1,
+                                /*RequiresNullTerminator=*/false);
   if (Result != 0) {
     ErrorMessage = "Error while opening JSON database: " + Result.message();
     return NULL;
   }
   OwningPtr<JSONCompilationDatabase> Database(
     new JSONCompilationDatabase(DatabaseBuffer.take()));
+  if (HasStatus) {
+    Database->HasModificationTime = true;
+    Database->ModificationTime =
+      Status.getLastModificationTime().toEpochTime();
+
+    OwningPtr<llvm::MemoryBuffer> IndexBuffer;
+    if (!llvm::MemoryBuffer::getFile(getIndexPath(FilePath), IndexBuffer)) {
+      if (Database->readIndex(IndexBuffer->getBuffer())) {
+        Database->LoadedFromIndex = true;
+        return Database.take();
+      }
+      // Start over with the parts of the index read so far thrown away.
+      OwningPtr<JSONCompilationDatabase> Fresh(
+        new JSONCompilationDatabase(Database->Database.take()));
+      Fresh->HasModificationTime = true;
+      Fresh->ModificationTime = Database->ModificationTime;
+      Database.reset(Fresh.take());
+    }
+  }
   if (!Database->parse(ErrorMessage))
     return NULL;
   return Database.take();
@@ -219,94 +475,87 @@ void JSONCompilationDatabase::getCommands(
                                   ArrayRef<CompileCommandRef> CommandsRef,
                                   std::vector<CompileCommand> &Commands) const {
   for (int I = 0, E = CommandsRef.size(); I != E; ++I) {
-    SmallString<8> DirectoryStorage;
+    SmallString<128> DirectoryStorage;
     SmallString<1024> CommandStorage;
     Commands.push_back(CompileCommand(
-      // FIXME: Escape correctly:
-      CommandsRef[I].first->getValue(DirectoryStorage),
-      unescapeCommandLine(CommandsRef[I].second->getValue(CommandStorage))));
+      unescapeJSONString(CommandsRef[I].first, DirectoryStorage),
+      unescapeCommandLine(
+        unescapeJSONString(CommandsRef[I].second, CommandStorage))));
   }
 }
 
 bool JSONCompilationDatabase::parse(std::string &ErrorMessage) {
-  llvm::yaml::document_iterator I = YAMLStream.begin();
-  if (I == YAMLStream.end()) {
-    ErrorMessage = "Error while parsing YAML.";
-    return false;
-  }
-  llvm::yaml::Node *Root = I->getRoot();
-  if (Root == NULL) {
-    ErrorMessage = "Error while parsing YAML.";
-    return false;
-  }
-  llvm::yaml::SequenceNode *Array = dyn_cast<llvm::yaml::SequenceNode>(Root);
-  if (Array == NULL) {
+  JSONScanner Scanner(Database->getBuffer());
+  if (!Scanner.consume('[')) {
     ErrorMessage = "Expected array.";
     return false;
   }
-  for (llvm::yaml::SequenceNode::iterator AI = Array->begin(),
-                                          AE = Array->end();
-       AI != AE; ++AI) {
-    llvm::yaml::MappingNode *Object = dyn_cast<llvm::yaml::MappingNode>(&*AI);
-    if (Object == NULL) {
+  if (Scanner.consume(']')) {
+    if (!Scanner.atEnd()) {
+      ErrorMessage = "Expected end of file after the array.";
+      return false;
+    }
+    return true;
+  }
+  do {
+    if (!Scanner.consume('{')) {
       ErrorMessage = "Expected object.";
       return false;
     }
-    llvm::yaml::ScalarNode *Directory = NULL;
-    llvm::yaml::ScalarNode *Command = NULL;
-    llvm::yaml::ScalarNode *File = NULL;
-    for (llvm::yaml::MappingNode::iterator KVI = Object->begin(),
-                                           KVE = Object->end();
-         KVI != KVE; ++KVI) {
-      llvm::yaml::Node *Value = (*KVI).getValue();
-      if (Value == NULL) {
-        ErrorMessage = "Expected value.";
-        return false;
-      }
-      llvm::yaml::ScalarNode *ValueString =
-          dyn_cast<llvm::yaml::ScalarNode>(Value);
-      if (ValueString == NULL) {
-        ErrorMessage = "Expected string as value.";
-        return false;
-      }
-      llvm::yaml::ScalarNode *KeyString =
-          dyn_cast<llvm::yaml::ScalarNode>((*KVI).getKey());
-      if (KeyString == NULL) {
-        ErrorMessage = "Expected strings as key.";
-        return false;
-      }
-      SmallString<8> KeyStorage;
-      if (KeyString->getValue(KeyStorage) == "directory") {
-        Directory = ValueString;
-      } else if (KeyString->getValue(KeyStorage) == "command") {
-        Command = ValueString;
-      } else if (KeyString->getValue(KeyStorage) == "file") {
-        File = ValueString;
-      } else {
-        ErrorMessage = ("Unknown key: \"" +
-                        KeyString->getRawValue() + "\"").str();
+    StringRef Directory, Command, File;
+    bool HasDirectory = false, HasCommand = false, HasFile = false;
+    if (!Scanner.consume('}')) {
+      do {
+        StringRef Key, Value;
+        if (!Scanner.scanString(Key, ErrorMessage, "Expected strings as key."))
+          return false;
+        if (!Scanner.consume(':')) {
+          ErrorMessage = "Expected ':' after key.";
+          return false;
+        }
+        if (!Scanner.scanString(Value, ErrorMessage,
+                                "Expected string as value."))
+          return false;
+        SmallString<16> KeyStorage;
+        StringRef KeyString = unescapeJSONString(Key, KeyStorage);
+        if (KeyString == "directory") {
+          Directory = Value;
+          HasDirectory = true;
+        } else if (KeyString == "command") {
+          Command = Value;
+          HasCommand = true;
+        } else if (KeyString == "file") {
+          File = Value;
+          HasFile = true;
+        } else {
+          ErrorMessage = ("Unknown key: \"" + Key + "\"").str();
+          return false;
+        }
+      } while (Scanner.consume(','));
+      if (!Scanner.consume('}')) {
+        ErrorMessage = "Expected ',' or '}' in object.";
         return false;
       }
     }
-    if (!File) {
+    if (!HasFile) {
       ErrorMessage = "Missing key: \"file\".";
       return false;
     }
-    if (!Command) {
+    if (!HasCommand) {
       ErrorMessage = "Missing key: \"command\".";
       return false;
     }
-    if (!Directory) {
+    if (!HasDirectory) {
       ErrorMessage = "Missing key: \"directory\".";
       return false;
     }
-    SmallString<8> FileStorage;
-    StringRef FileName = File->getValue(FileStorage);
+    SmallString<128> FileStorage;
+    StringRef FileName = unescapeJSONString(File, FileStorage);
     SmallString<128> NativeFilePath;
     if (llvm::sys::path::is_relative(FileName)) {
-      SmallString<8> DirectoryStorage;
+      SmallString<128> DirectoryStorage;
       SmallString<128> AbsolutePath(
-          Directory->getValue(DirectoryStorage));
+          unescapeJSONString(Directory, DirectoryStorage));
       llvm::sys::path::append(AbsolutePath, FileName);
       llvm::sys::path::native(AbsolutePath.str(), NativeFilePath);
     } else {
@@ -315,9 +564,129 @@ bool JSONCompilationDatabase::parse(std::string &ErrorMessage) {
     IndexByFile[NativeFilePath].push_back(
         CompileCommandRef(Directory, Command));
     MatchTrie.insert(NativeFilePath.str());
+  } while (Scanner.consume(','));
+  if (!Scanner.consume(']')) {
+    ErrorMessage = "Expected ',' or ']' in array.";
+    return false;
+  }
+  if (!Scanner.atEnd()) {
+    ErrorMessage = "Expected end of file after the array.";
+    return false;
+  }
+  return true;
+}
+
+std::string JSONCompilationDatabase::getIndexPath(StringRef FilePath) {
+  return (FilePath + ".index").str();
+}
+
+// A saved index holds IndexMagic, the size and modification time of the
+// database it was written for, whether its contents must be compared and
+// their hash, and then the number of files followed by,
+// for each file, its path and the (offset, length) pairs locating the
+// directory and command strings of each of its commands in the database.
+bool JSONCompilationDatabase::writeIndex(StringRef IndexPath,
+                                         std::string &ErrorMessage) const {
+  if (!HasModificationTime) {
+    ErrorMessage = "Only databases loaded from a file can be indexed.";
+    return false;
+  }
+
+  // The modification time only has a resolution of a second, so a database
+  // rewritten within the second it was last modified would look unchanged.
+  // Have its contents compared then, which costs reading all of it.
+  uint64_t Now = llvm::sys::TimeValue::now().toEpochTime();
+  bool CheckContents = ModificationTime + 1 >= Now;
+
+  // Write to a temporary file and rename it, so that tools loading the
+  // database meanwhile never see half an index.
+  SmallString<128> TempPath(IndexPath);
+  TempPath += "-%%%%%%%%";
+  int FD;
+  if (llvm::error_code EC = llvm::sys::fs::createUniqueFile(TempPath.str(), FD,
+                                                            TempPath)) {
+    ErrorMessage = "Error while creating the index: " + EC.message();
+    return false;
+  }
+  {
+    llvm::raw_fd_ostream Out(FD, /*shouldClose=*/true);
+    const char *BufferStart = Database->getBufferStart();
+    Out.write(IndexMagic, sizeof(IndexMagic));
+    writeIndexInteger(Out, Database->getBufferSize());
+    writeIndexInteger(Out, ModificationTime);
+    writeIndexInteger(Out, CheckContents);
+    writeIndexInteger(Out, CheckContents ? hashDatabase(Database->getBuffer())
+                                         : 0);
+    writeIndexInteger(Out, IndexByFile.size());
+    for (llvm::StringMap< std::vector<CompileCommandRef> >::const_iterator
+           I = IndexByFile.begin(), E = IndexByFile.end();
+         I != E; ++I) {
+      writeIndexInteger(Out, I->first().size());
+      Out << I->first();
+      const std::vector<CompileCommandRef> &Commands = I->getValue();
+      writeIndexInteger(Out, Commands.size());
+      for (unsigned J = 0, JE = Commands.size(); J != JE; ++J) {
+        writeIndexInteger(Out, Commands[J].first.data() - BufferStart);
+        writeIndexInteger(Out, Commands[J].first.size());
+        writeIndexInteger(Out, Commands[J].second.data() - BufferStart);
+        writeIndexInteger(Out, Commands[J].second.size());
+      }
+    }
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      bool Existed;
+      llvm::sys::fs::remove(TempPath.str(), Existed);
+      ErrorMessage = "Error while writing the index.";
+      return false;
+    }
+  }
+  if (llvm::error_code EC = llvm::sys::fs::rename(TempPath.str(), IndexPath)) {
+    bool Existed;
+    llvm::sys::fs::remove(TempPath.str(), Existed);
+    ErrorMessage = "Error while writing the index: " + EC.message();
+    return false;
   }
   return true;
 }
 
+bool JSONCompilationDatabase::readIndex(StringRef Index) {
+  if (!Index.startswith(StringRef(IndexMagic, sizeof(IndexMagic))))
+    return false;
+  IndexReader Reader(Index.substr(sizeof(IndexMagic)));
+  StringRef Buffer = Database->getBuffer();
+  uint64_t Size, Time, CheckContents, Hash, NumFiles;
+  if (!Reader.read(Size) || Size != Buffer.size() ||
+      !Reader.read(Time) || Time != ModificationTime ||
+      !Reader.read(CheckContents) || !Reader.read(Hash) ||
+      (CheckContents && Hash != hashDatabase(Buffer)) ||
+      !Reader.read(NumFiles))
+    return false;
+  for (uint64_t I = 0; I != NumFiles; ++I) {
+    StringRef FilePath;
+    uint64_t NumCommands;
+    if (!Reader.read(FilePath) || !Reader.read(NumCommands))
+      return false;
+    std::vector<CompileCommandRef> &Commands = IndexByFile[FilePath];
+    for (uint64_t J = 0; J != NumCommands; ++J) {
+      StringRef Strings[2];
+      for (unsigned K = 0; K != 2; ++K) {
+        uint64_t Offset, Length;
+        if (!Reader.read(Offset) || !Reader.read(Length))
+          return false;
+        // Check that the string at least lies between quotes in the buffer.
+        if (Offset == 0 || Offset > Buffer.size() ||
+            Length >= Buffer.size() - Offset ||
+            Buffer[Offset - 1] != '"' || Buffer[Offset + Length] != '"')
+          return false;
+        Strings[K] = Buffer.substr(Offset, Length);
+      }
+      Commands.push_back(CompileCommandRef(Strings[0], Strings[1]));
+    }
+    MatchTrie.insert(FilePath);
+  }
+  return Reader.atEnd();
+}
+
 } // end namespace tooling
 } // end namespace clang
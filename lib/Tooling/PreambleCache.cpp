@@ -0,0 +1,319 @@
+//===--- PreambleCache.cpp - Preambles shared across a tool run -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements PreambleCache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Tooling/PreambleCache.h"
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/CompilerInvocation.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Lex/HeaderSearchOptions.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/PreprocessorOptions.h"
+#include "clang/Serialization/ASTReader.h"
+#include "clang/Serialization/Module.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace clang {
+namespace tooling {
+
+PreambleCache::PreambleCache() : NumHits(0), NumMisses(0), NumFailures(0) {}
+
+PreambleCache::~PreambleCache() {
+  for (llvm::StringMap<Entry>::iterator I = Entries.begin(),
+                                        E = Entries.end();
+       I != E; ++I) {
+    if (I->getValue().PCHPath.empty())
+      continue;
+    bool Existed;
+    llvm::sys::fs::remove(I->getValue().PCHPath, Existed);
+  }
+}
+
+static void appendKeyPart(std::string &Key, StringRef Part) {
+  Key += Part;
+  Key += '\0';
+}
+
+/// \brief Returns a key for everything that can change what the preamble of
+/// \p Invocation means: the options, the directories paths are resolved
+/// against, and the text of the preamble itself.
+static std::string getPreambleKey(const CompilerInvocation &Invocation,
+                                  StringRef Preamble, bool AtStartOfLine) {
+  const HeaderSearchOptions &HSOpts = Invocation.getHeaderSearchOpts();
+  const PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+  const FileSystemOptions &FSOpts = Invocation.getFileSystemOpts();
+
+  // The module hash covers the language, target and macro options.
+  std::string Key;
+  appendKeyPart(Key, Invocation.getModuleHash());
+  appendKeyPart(Key, FSOpts.WorkingDir);
+  // Quoted #includes are looked up next to the main file first.
+  SmallString<256> MainFile(Invocation.getFrontendOpts().Inputs[0].getFile());
+  if (!FSOpts.WorkingDir.empty() && !llvm::sys::path::is_absolute(MainFile)) {
+    SmallString<256> Path(FSOpts.WorkingDir);
+    llvm::sys::path::append(Path, MainFile.str());
+    MainFile = Path;
+  }
+  appendKeyPart(Key, llvm::sys::path::parent_path(MainFile.str()));
+  appendKeyPart(Key, HSOpts.ResourceDir);
+  for (unsigned I = 0, E = HSOpts.UserEntries.size(); I != E; ++I) {
+    const HeaderSearchOptions::Entry &Entry = HSOpts.UserEntries[I];
+    appendKeyPart(Key, Entry.Path);
+    Key += char('0' + Entry.Group);
+    Key += Entry.IsFramework ? 'F' : 'D';
+  }
+  appendKeyPart(Key, "");
+  for (unsigned I = 0, E = PPOpts.Includes.size(); I != E; ++I)
+    appendKeyPart(Key, PPOpts.Includes[I]);
+  appendKeyPart(Key, "");
+  for (unsigned I = 0, E = PPOpts.MacroIncludes.size(); I != E; ++I)
+    appendKeyPart(Key, PPOpts.MacroIncludes[I]);
+  appendKeyPart(Key, "");
+  Key += AtStartOfLine ? '1' : '0';
+  Key += Preamble;
+  return Key;
+}
+
+namespace {
+/// \brief Keeps the diagnostics of building a preamble.
+class StoredDiagnosticConsumer : public DiagnosticConsumer {
+  std::vector<StoredDiagnostic> &Stored;
+
+public:
+  explicit StoredDiagnosticConsumer(std::vector<StoredDiagnostic> &Stored)
+      : Stored(Stored) {}
+
+  virtual void HandleDiagnostic(DiagnosticsEngine::Level Level,
+                                const Diagnostic &Info) {
+    DiagnosticConsumer::HandleDiagnostic(Level, Info);
+    Stored.push_back(StoredDiagnostic(Level, Info));
+  }
+};
+} // end anonymous namespace
+
+/// \brief Precompile the first \p PreambleSize bytes of the main file of
+/// \p Invocation into \p PCHPath, keeping its diagnostics in
+/// \p Diagnostics.  If the preamble has errors, they are reported when the
+/// translation unit is compiled without it.
+static bool buildPreamble(const CompilerInvocation &Invocation,
+                          const llvm::MemoryBuffer *MainBuffer,
+                          unsigned PreambleSize, FileManager &Files,
+                          const llvm::StringMap<StringRef> &MappedFiles,
+                          StringRef PCHPath,
+                          std::vector<StoredDiagnostic> &Diagnostics) {
+  CompilerInvocation *PCHInvocation = new CompilerInvocation(Invocation);
+  FrontendOptions &FrontendOpts = PCHInvocation->getFrontendOpts();
+  FrontendOpts.ProgramAction = frontend::GeneratePCH;
+  FrontendOpts.OutputFile = PCHPath;
+  FrontendOpts.DisableFree = false;
+  FrontendOpts.ShowStats = false;
+  FrontendOpts.ShowTimers = false;
+
+  // Compile only the preamble, under the name of the main file, and with the
+  // mapped files the translation unit will see.
+  PreprocessorOptions &PPOpts = PCHInvocation->getPreprocessorOpts();
+  PPOpts.RetainRemappedFileBuffers = false;
+  StringRef MainFile = FrontendOpts.Inputs[0].getFile();
+  PPOpts.addRemappedFile(
+      MainFile, llvm::MemoryBuffer::getMemBufferCopy(
+                    MainBuffer->getBuffer().substr(0, PreambleSize), MainFile));
+  for (llvm::StringMap<StringRef>::const_iterator I = MappedFiles.begin(),
+                                                  E = MappedFiles.end();
+       I != E; ++I) {
+    if (I->getKey() == MainFile)
+      continue;
+    PPOpts.addRemappedFile(
+        I->getKey(),
+        llvm::MemoryBuffer::getMemBufferCopy(I->getValue(), I->getKey()));
+  }
+
+  CompilerInstance Compiler;
+  Compiler.setInvocation(PCHInvocation);
+  Compiler.setFileManager(&Files);
+  Compiler.createDiagnostics(new StoredDiagnosticConsumer(Diagnostics));
+
+  GeneratePCHAction Action;
+  bool Success = Compiler.ExecuteAction(Action) &&
+                 !Compiler.getDiagnostics().hasErrorOccurred();
+
+  // The file manager belongs to the caller.
+  Compiler.resetAndLeakFileManager();
+  return Success;
+}
+
+bool PreambleCache::usePreamble(CompilerInvocation &Invocation,
+                                const llvm::MemoryBuffer *MainBuffer,
+                                FileManager &Files,
+                                const llvm::StringMap<StringRef> &MappedFiles,
+                                std::vector<StoredDiagnostic> &Diagnostics) {
+  FrontendOptions &FrontendOpts = Invocation.getFrontendOpts();
+  PreprocessorOptions &PPOpts = Invocation.getPreprocessorOpts();
+
+  // Leave an explicit PCH alone.
+  if (!PPOpts.ImplicitPCHInclude.empty() || !PPOpts.ImplicitPTHInclude.empty())
+    return false;
+  if (FrontendOpts.Inputs.size() != 1 || !FrontendOpts.Inputs[0].isFile())
+    return false;
+
+  std::pair<unsigned, bool> Preamble =
+      Lexer::ComputePreamble(MainBuffer, *Invocation.getLangOpts());
+  if (Preamble.first == 0)
+    return false;
+
+  std::string Key = getPreambleKey(
+      Invocation, MainBuffer->getBuffer().substr(0, Preamble.first),
+      Preamble.second);
+
+  std::string PCHPath;
+  {
+    llvm::sys::ScopedLock Guard(Lock);
+    llvm::StringMap<Entry>::iterator I = Entries.find(Key);
+    if (I != Entries.end()) {
+      if (I->getValue().State != Entry::Ready) {
+        // Another thread is still building it, or it failed to build.
+        ++NumMisses;
+        return false;
+      }
+      ++NumHits;
+      PCHPath = I->getValue().PCHPath;
+      Diagnostics = I->getValue().Diagnostics;
+    } else {
+      ++NumMisses;
+      Entry &New = Entries.GetOrCreateValue(Key).getValue();
+      New.State = Entry::Building;
+    }
+  }
+
+  if (PCHPath.empty()) {
+    SmallString<128> Path;
+    std::vector<StoredDiagnostic> Built;
+    bool Success =
+        !llvm::sys::fs::createTemporaryFile("preamble", "pch", Path) &&
+        buildPreamble(Invocation, MainBuffer, Preamble.first, Files,
+                      MappedFiles, Path.str(), Built);
+
+    llvm::sys::ScopedLock Guard(Lock);
+    Entry &New = Entries.find(Key)->getValue();
+    New.PCHPath = Path.str();
+    if (!Success) {
+      New.State = Entry::Failed;
+      ++NumFailures;
+      return false;
+    }
+    New.State = Entry::Ready;
+    New.Diagnostics = Built;
+    Diagnostics.swap(Built);
+    PCHPath = Path.str();
+  }
+
+  // This is how ASTUnit uses a precompiled preamble: the PCH stands in for
+  // the first bytes of the main file, which the preprocessor then skips.
+  // The headers cannot have changed since it was built, and the main file is
+  // expected to differ from the one it was built from.
+  PPOpts.ImplicitPCHInclude = PCHPath;
+  PPOpts.PrecompiledPreambleBytes = Preamble;
+  PPOpts.DisablePCHValidation = true;
+  return true;
+}
+
+typedef ContinuousRangeMap<unsigned, int, 2> SLocRemap;
+
+/// \brief Moves \p L from the source manager that wrote a PCH into the one
+/// that loaded it, as \c ASTUnit does for its preamble.
+static void translateSLoc(SourceLocation &L, SLocRemap &Remap) {
+  if (L.isInvalid())
+    return;
+  unsigned Raw = L.getRawEncoding();
+  const unsigned MacroBit = 1U << 31;
+  L = SourceLocation::getFromRawEncoding((Raw & MacroBit) |
+      ((Raw & ~MacroBit) + Remap.find(Raw & ~MacroBit)->second));
+}
+
+void PreambleCache::reportDiagnostics(CompilerInstance &CI,
+                                      ArrayRef<StoredDiagnostic> Diagnostics) {
+  if (Diagnostics.empty() || !CI.getModuleManager())
+    return;
+  serialization::ModuleFile *Mod =
+      CI.getModuleManager()->getModuleManager().lookup(
+          CI.getPreprocessorOpts().ImplicitPCHInclude);
+  if (!Mod)
+    return;
+  SLocRemap &Remap = Mod->SLocRemap;
+  SourceManager &SM = CI.getSourceManager();
+  for (unsigned I = 0, E = Diagnostics.size(); I != E; ++I) {
+    const StoredDiagnostic &SD = Diagnostics[I];
+    SourceLocation L = SD.getLocation();
+    translateSLoc(L, Remap);
+
+    SmallVector<CharSourceRange, 4> Ranges;
+    for (StoredDiagnostic::range_iterator RI = SD.range_begin(),
+                                          RE = SD.range_end();
+         RI != RE; ++RI) {
+      SourceLocation BL = RI->getBegin();
+      translateSLoc(BL, Remap);
+      SourceLocation EL = RI->getEnd();
+      translateSLoc(EL, Remap);
+      Ranges.push_back(CharSourceRange(SourceRange(BL, EL),
+                                       RI->isTokenRange()));
+    }
+
+    SmallVector<FixItHint, 2> FixIts;
+    for (StoredDiagnostic::fixit_iterator FI = SD.fixit_begin(),
+                                          FE = SD.fixit_end();
+         FI != FE; ++FI) {
+      FixIts.push_back(FixItHint());
+      FixItHint &FH = FixIts.back();
+      FH.CodeToInsert = FI->CodeToInsert;
+      SourceLocation BL = FI->RemoveRange.getBegin();
+      translateSLoc(BL, Remap);
+      SourceLocation EL = FI->RemoveRange.getEnd();
+      translateSLoc(EL, Remap);
+      FH.RemoveRange = CharSourceRange(SourceRange(BL, EL),
+                                       FI->RemoveRange.isTokenRange());
+    }
+
+    CI.getDiagnostics().Report(
+        StoredDiagnostic(SD.getLevel(), SD.getID(), SD.getMessage(),
+                         FullSourceLoc(L, SM), Ranges, FixIts));
+  }
+}
+
+unsigned PreambleCache::getNumHits() const {
+  llvm::sys::ScopedLock Guard(Lock);
+  return NumHits;
+}
+
+unsigned PreambleCache::getNumMisses() const {
+  llvm::sys::ScopedLock Guard(Lock);
+  return NumMisses;
+}
+
+unsigned PreambleCache::getNumFailures() const {
+  llvm::sys::ScopedLock Guard(Lock);
+  return NumFailures;
+}
+
+void PreambleCache::printStats(raw_ostream &OS) const {
+  llvm::sys::ScopedLock Guard(Lock);
+  OS << "Preamble cache: " << NumHits << " hits, " << NumMisses
+     << " misses, " << NumFailures << " failed to build, "
+     << Entries.size() << " preambles\n";
+}
+
+} // end namespace tooling
+} // end namespace clang
@@ -18,6 +18,7 @@
 #include "clang/Lex/Lexer.h"
 #include "clang/Rewrite/Core/Rewriter.h"
 #include "clang/Tooling/Refactoring.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/raw_os_ostream.h"
 
 namespace clang {
@@ -102,7 +103,16 @@ void Replacement::setFromSourceLocation(SourceManager &Sources,
   const std::pair<FileID, unsigned> DecomposedLocation =
       Sources.getDecomposedLoc(Start);
   const FileEntry *Entry = Sources.getFileEntryForID(DecomposedLocation.first);
-  this->FilePath = Entry != NULL ? Entry->getName() : InvalidLocation;
+  if (Entry != NULL) {
+    // The file manager of a compile command run in its own directory
+    // resolves relative paths against it; the replacements are applied
+    // elsewhere, so record the path they resolved to.
+    SmallString<256> Path(Entry->getName());
+    Sources.getFileManager().FixupRelativePath(Path);
+    this->FilePath = Path.str();
+  } else {
+    this->FilePath = InvalidLocation;
+  }
   this->ReplacementRange = Range(DecomposedLocation.second, Length);
   this->ReplacementText = ReplacementText;
 }
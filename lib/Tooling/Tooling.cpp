@@ -17,22 +17,25 @@
 #include "clang/Driver/Driver.h"
 #include "clang/Driver/Tool.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendAction.h"
 #include "clang/Frontend/FrontendDiagnostic.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Tooling/ArgumentsAdjusters.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/PreambleCache.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Config/config.h"
 #include "llvm/Option/Option.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
-// For chdir, see the comment in ClangTool::run for more information.
-#ifdef _WIN32
-#  include <direct.h>
-#else
-#  include <unistd.h>
+#if HAVE_PTHREAD_H
+#include <pthread.h>
 #endif
 
 namespace clang {
@@ -40,6 +43,8 @@ namespace tooling {
 
 FrontendActionFactory::~FrontendActionFactory() {}
 
+ToolResultCallback::~ToolResultCallback() {}
+
 // FIXME: This file contains structural duplication with other parts of the
 // code that sets up a compiler to run tools on it, and we should refactor
 // it to be based on the same framework.
@@ -142,7 +147,8 @@ std::string getAbsolutePath(StringRef File) {
 ToolInvocation::ToolInvocation(
     ArrayRef<std::string> CommandLine, FrontendAction *ToolAction,
     FileManager *Files)
-    : CommandLine(CommandLine.vec()), ToolAction(ToolAction), Files(Files) {
+    : CommandLine(CommandLine.vec()), ToolAction(ToolAction), Files(Files),
+      DiagOS(&llvm::errs()), Preambles(NULL) {
 }
 
 void ToolInvocation::mapVirtualFile(StringRef FilePath, StringRef Content) {
@@ -158,7 +164,7 @@ bool ToolInvocation::run() {
   const char *const BinaryName = Argv[0];
   IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
   TextDiagnosticPrinter DiagnosticPrinter(
-      llvm::errs(), &*DiagOpts);
+      *DiagOS, &*DiagOpts);
   DiagnosticsEngine Diagnostics(
     IntrusiveRefCntPtr<clang::DiagnosticIDs>(new DiagnosticIDs()),
     &*DiagOpts, &DiagnosticPrinter, false);
@@ -179,15 +185,72 @@ bool ToolInvocation::run() {
   return runInvocation(BinaryName, Compilation.get(), Invocation.take());
 }
 
+/// \brief Returns the contents of \p File as the compiler will see them.
+static llvm::MemoryBuffer *
+getFileContents(StringRef File, FileManager &Files,
+                const llvm::StringMap<StringRef> &MappedFileContents) {
+  SmallString<1024> PathStorage;
+  llvm::sys::path::native(File, PathStorage);
+  llvm::StringMap<StringRef>::const_iterator Mapped =
+      MappedFileContents.find(PathStorage);
+  if (Mapped != MappedFileContents.end())
+    return llvm::MemoryBuffer::getMemBuffer(Mapped->getValue(), File);
+  return Files.getBufferForFile(File);
+}
+
+namespace {
+/// \brief Runs an action on a translation unit that loads a shared preamble,
+/// reporting the diagnostics of building the preamble first.
+class ReportPreambleDiagnosticsAction : public WrapperFrontendAction {
+  std::vector<StoredDiagnostic> Diagnostics;
+
+public:
+  /// Takes ownership of \p Action, and the contents of \p Diagnostics.
+  ReportPreambleDiagnosticsAction(FrontendAction *Action,
+                                  std::vector<StoredDiagnostic> &Diagnostics)
+      : WrapperFrontendAction(Action) {
+    this->Diagnostics.swap(Diagnostics);
+  }
+
+protected:
+  virtual bool BeginSourceFileAction(CompilerInstance &CI,
+                                     StringRef Filename) {
+    PreambleCache::reportDiagnostics(CI, Diagnostics);
+    return WrapperFrontendAction::BeginSourceFileAction(CI, Filename);
+  }
+};
+} // end anonymous namespace
+
 bool ToolInvocation::runInvocation(
     const char *BinaryName,
     clang::driver::Compilation *Compilation,
     clang::CompilerInvocation *Invocation) {
   // Show the invocation, with -v.
   if (Invocation->getHeaderSearchOpts().Verbose) {
-    llvm::errs() << "clang Invocation:\n";
-    Compilation->PrintJob(llvm::errs(), Compilation->getJobs(), "\n", true);
-    llvm::errs() << "\n";
+    *DiagOS << "clang Invocation:\n";
+    Compilation->PrintJob(*DiagOS, Compilation->getJobs(), "\n", true);
+    *DiagOS << "\n";
+  }
+
+  // Relative paths must be resolved against the invocation's working
+  // directory.  It has to outlive the compiler, which does not own it.
+  OwningPtr<FileManager> InvocationFiles;
+  FileManager *Files = this->Files;
+  if (Invocation->getFileSystemOpts().WorkingDir !=
+      Files->getFileSystemOptions().WorkingDir) {
+    InvocationFiles.reset(new FileManager(Invocation->getFileSystemOpts()));
+    Files = InvocationFiles.get();
+  }
+
+  std::vector<StoredDiagnostic> PreambleDiagnostics;
+  if (Preambles && Invocation->getFrontendOpts().Inputs.size() == 1 &&
+      Invocation->getFrontendOpts().Inputs[0].isFile()) {
+    OwningPtr<llvm::MemoryBuffer> MainBuffer(getFileContents(
+        Invocation->getFrontendOpts().Inputs[0].getFile(), *Files,
+        MappedFileContents));
+    if (MainBuffer)
+      Preambles->usePreamble(*Invocation, MainBuffer.get(), *Files,
+                             MappedFileContents, PreambleDiagnostics);
   }
 
   // Create a compiler instance to handle the actual work.
@@ -200,14 +263,21 @@ bool ToolInvocation::runInvocation(
   // we need to ensure it's deleted earlier than Compiler. So we pass it to an
   // OwningPtr declared after the Compiler variable.
   OwningPtr<FrontendAction> ScopedToolAction(ToolAction.take());
+  if (!PreambleDiagnostics.empty())
+    ScopedToolAction.reset(new ReportPreambleDiagnosticsAction(
+        ScopedToolAction.take(), PreambleDiagnostics));
 
   // Create the compilers actual diagnostics engine.
-  Compiler.createDiagnostics();
+  if (DiagOS == &llvm::errs())
+    Compiler.createDiagnostics();
+  else
+    Compiler.createDiagnostics(
+        new TextDiagnosticPrinter(*DiagOS, &Compiler.getDiagnosticOpts()));
   if (!Compiler.hasDiagnostics())
     return false;
 
   Compiler.createSourceManager(*Files);
-  addFileMappingsTo(Compiler.getSourceManager());
+  addFileMappingsTo(Compiler.getSourceManager(), *Files);
 
   const bool Success = Compiler.ExecuteAction(*ScopedToolAction);
 
@@ -216,7 +286,8 @@ bool ToolInvocation::runInvocation(
   return Success;
 }
 
-void ToolInvocation::addFileMappingsTo(SourceManager &Sources) {
+void ToolInvocation::addFileMappingsTo(SourceManager &Sources,
+                                       FileManager &Files) {
   for (llvm::StringMap<StringRef>::const_iterator
            It = MappedFileContents.begin(), End = MappedFileContents.end();
        It != End; ++It) {
@@ -224,7 +295,7 @@ void ToolInvocation::addFileMappingsTo(SourceManager &Sources) {
     const llvm::MemoryBuffer *Input =
         llvm::MemoryBuffer::getMemBuffer(It->getValue());
     // FIXME: figure out what '0' stands for.
-    const FileEntry *FromFile = Files->getVirtualFile(
+    const FileEntry *FromFile = Files.getVirtualFile(
         It->getKey(), Input->getBufferSize(), 0);
     Sources.overrideFileContents(FromFile, Input);
   }
@@ -232,7 +303,7 @@ void ToolInvocation::addFileMappingsTo(SourceManager &Sources) {
 
 ClangTool::ClangTool(const CompilationDatabase &Compilations,
                      ArrayRef<std::string> SourcePaths)
-    : Files((FileSystemOptions())) {
+    : Files((FileSystemOptions())), Preambles(NULL) {
   ArgsAdjusters.push_back(new ClangStripOutputAdjuster());
   ArgsAdjusters.push_back(new ClangSyntaxOnlyAdjuster());
   for (unsigned I = 0, E = SourcePaths.size(); I != E; ++I) {
@@ -275,7 +346,9 @@ void ClangTool::clearArgumentsAdjusters() {
   ArgsAdjusters.clear();
 }
 
-int ClangTool::run(FrontendActionFactory *ActionFactory) {
+/// \brief Returns the path of the running tool, from which the driver finds
+/// the builtin headers.
+static std::string getMainExecutable() {
   // Exists solely for the purpose of lookup of the resource path.
   // This just needs to be some symbol in the binary.
   static int StaticSymbol;
@@ -284,33 +357,62 @@ int ClangTool::run(FrontendActionFactory *ActionFactory) {
   // FIXME: On linux, GetMainExecutable is independent of the value of the
   // first argument, thus allowing ClangTool and runToolOnCode to just
   // pass in made-up names here. Make sure this works on other platforms.
-  std::string MainExecutable =
-      llvm::sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
+  return llvm::sys::fs::getMainExecutable("clang_tool", &StaticSymbol);
+}
+
+/// \brief Returns a file manager resolving relative paths against
+/// \p Directory: \p Files, if it does, or else a new one stored in \p Files.
+static FileManager &getFileManagerFor(StringRef Directory,
+                                      OwningPtr<FileManager> &Files) {
+  if (!Files || Files->getFileSystemOptions().WorkingDir != Directory) {
+    FileSystemOptions FileSystemOpts;
+    FileSystemOpts.WorkingDir = Directory;
+    Files.reset(new FileManager(FileSystemOpts));
+  }
+  return *Files;
+}
+
+std::vector<std::string>
+ClangTool::getCommandLine(unsigned I, StringRef MainExecutable) const {
+  const CompileCommand &Command = CompileCommands[I].second;
+  std::vector<std::string> CommandLine = Command.CommandLine;
+  for (unsigned I = 0, E = ArgsAdjusters.size(); I != E; ++I)
+    CommandLine = ArgsAdjusters[I]->Adjust(CommandLine);
+  assert(!CommandLine.empty());
+  CommandLine[0] = MainExecutable;
+  // Rather than changing the working directory of the process, have the
+  // compiler resolve relative paths against the command's directory.
+  if (!Command.Directory.empty()) {
+    CommandLine.insert(CommandLine.begin() + 1, Command.Directory);
+    CommandLine.insert(CommandLine.begin() + 1, "-working-directory");
+  }
+  return CommandLine;
+}
+
+int ClangTool::run(FrontendActionFactory *ActionFactory) {
+  std::string MainExecutable = getMainExecutable();
+
+  // The file manager for the commands run in a directory other than the one
+  // Files resolves relative paths against.  Consecutive commands usually
+  // share a directory, and so the file manager.
+  OwningPtr<FileManager> DirectoryFiles;
 
   bool ProcessingFailed = false;
   for (unsigned I = 0; I < CompileCommands.size(); ++I) {
     std::string File = CompileCommands[I].first;
-    // FIXME: chdir is thread hostile; on the other hand, creating the same
-    // behavior as chdir is complex: chdir resolves the path once, thus
-    // guaranteeing that all subsequent relative path operations work
-    // on the same path the original chdir resulted in. This makes a difference
-    // for example on network filesystems, where symlinks might be switched
-    // during runtime of the tool. Fixing this depends on having a file system
-    // abstraction that allows openat() style interactions.
-    if (chdir(CompileCommands[I].second.Directory.c_str()))
-      llvm::report_fatal_error("Cannot chdir into \"" +
-                               CompileCommands[I].second.Directory + "\n!");
-    std::vector<std::string> CommandLine = CompileCommands[I].second.CommandLine;
-    for (unsigned I = 0, E = ArgsAdjusters.size(); I != E; ++I)
-      CommandLine = ArgsAdjusters[I]->Adjust(CommandLine);
-    assert(!CommandLine.empty());
-    CommandLine[0] = MainExecutable;
+    StringRef Directory = CompileCommands[I].second.Directory;
+    std::vector<std::string> CommandLine = getCommandLine(I, MainExecutable);
+    FileManager &CommandFiles =
+        Directory.empty() ? Files
+                          : getFileManagerFor(Directory, DirectoryFiles);
     // FIXME: We need a callback mechanism for the tool writer to output a
     // customized message for each file.
     DEBUG({
       llvm::dbgs() << "Processing: " << File << ".\n";
     });
-    ToolInvocation Invocation(CommandLine, ActionFactory->create(), &Files);
+    ToolInvocation Invocation(CommandLine, ActionFactory->create(),
+                              &CommandFiles);
+    Invocation.setPreambleCache(Preambles);
     for (int I = 0, E = MappedFileContents.size(); I != E; ++I) {
       Invocation.mapVirtualFile(MappedFileContents[I].first,
                                 MappedFileContents[I].second);
@@ -324,5 +426,144 @@ int ClangTool::run(FrontendActionFactory *ActionFactory) {
   return ProcessingFailed ? 1 : 0;
 }
 
+namespace {
+/// \brief A compile command of a parallel run, and what running it produced.
+struct ParallelToolJob {
+  std::string File;
+  std::string Directory;
+  std::vector<std::string> CommandLine;
+  std::string Diagnostics;
+  bool Done;
+  bool Success;
+};
+
+struct ParallelToolRun {
+  std::vector<ParallelToolJob> Jobs;
+  FrontendActionFactory *ActionFactory;
+  ArrayRef<std::pair<StringRef, StringRef> > MappedFileContents;
+  ToolResultCallback *Callback;
+  PreambleCache *Preambles;
+  llvm::sys::Mutex Lock;
+  // The jobs below are guarded by Lock.
+  unsigned NextJob;
+  unsigned NextToReport;
+  bool ProcessingFailed;
+};
+} // end anonymous namespace
+
+/// Threads running the parser and Sema need as much stack as the main
+/// thread usually gets.
+static const size_t ToolThreadStackSize = 8 << 20;
+
+/// \brief Hands the results of the finished jobs whose turn it is to the
+/// callback.  Must be called with the run locked.
+static void reportFinishedJobs(ParallelToolRun &Run) {
+  for (; Run.NextToReport != Run.Jobs.size() &&
+         Run.Jobs[Run.NextToReport].Done; ++Run.NextToReport) {
+    ParallelToolJob &Job = Run.Jobs[Run.NextToReport];
+    if (!Job.Success)
+      Run.ProcessingFailed = true;
+    if (Run.Callback) {
+      Run.Callback->handleResult(Job.File, Job.Success, Job.Diagnostics);
+    } else {
+      llvm::errs() << Job.Diagnostics;
+      if (!Job.Success)
+        llvm::errs() << "Error while processing " << Job.File << ".\n";
+    }
+    std::string().swap(Job.Diagnostics);
+  }
+}
+
+static void *runToolJobs(void *Arg) {
+  ParallelToolRun &Run = *static_cast<ParallelToolRun *>(Arg);
+  // Each thread has a file manager of its own.
+  OwningPtr<FileManager> Files;
+  for (;;) {
+    unsigned I;
+    FrontendAction *Action;
+    {
+      llvm::sys::ScopedLock Guard(Run.Lock);
+      if (Run.NextJob == Run.Jobs.size())
+        return NULL;
+      I = Run.NextJob++;
+      Action = Run.ActionFactory->create();
+    }
+
+    ParallelToolJob &Job = Run.Jobs[I];
+    DEBUG({
+      llvm::sys::ScopedLock Guard(Run.Lock);
+      llvm::dbgs() << "Processing: " << Job.File << ".\n";
+    });
+    bool Success;
+    {
+      llvm::raw_string_ostream DiagOS(Job.Diagnostics);
+      ToolInvocation Invocation(Job.CommandLine, Action,
+                                &getFileManagerFor(Job.Directory, Files));
+      Invocation.setDiagnosticStream(DiagOS);
+      Invocation.setPreambleCache(Run.Preambles);
+      for (unsigned I = 0, E = Run.MappedFileContents.size(); I != E; ++I)
+        Invocation.mapVirtualFile(Run.MappedFileContents[I].first,
+                                  Run.MappedFileContents[I].second);
+      Success = Invocation.run();
+    }
+
+    llvm::sys::ScopedLock Guard(Run.Lock);
+    Job.Success = Success;
+    Job.Done = true;
+    reportFinishedJobs(Run);
+  }
+}
+
+int ClangTool::runInParallel(FrontendActionFactory *ActionFactory,
+                             unsigned NumThreads,
+                             ToolResultCallback *Callback) {
+  std::string MainExecutable = getMainExecutable();
+
+  ParallelToolRun Run;
+  Run.ActionFactory = ActionFactory;
+  Run.MappedFileContents = MappedFileContents;
+  Run.Callback = Callback;
+  Run.Preambles = Preambles;
+  Run.NextJob = 0;
+  Run.NextToReport = 0;
+  Run.ProcessingFailed = false;
+  Run.Jobs.resize(CompileCommands.size());
+  for (unsigned I = 0, E = CompileCommands.size(); I != E; ++I) {
+    ParallelToolJob &Job = Run.Jobs[I];
+    Job.File = CompileCommands[I].first;
+    Job.Directory = CompileCommands[I].second.Directory;
+    Job.CommandLine = getCommandLine(I, MainExecutable);
+    Job.Done = false;
+    Job.Success = false;
+  }
+
+  if (NumThreads > Run.Jobs.size())
+    NumThreads = Run.Jobs.size();
+#if HAVE_PTHREAD_H
+  std::vector<pthread_t> Threads;
+  if (NumThreads > 1) {
+    if (!llvm::llvm_is_multithreaded())
+      llvm::llvm_start_multithreaded();
+    pthread_attr_t Attr;
+    pthread_attr_init(&Attr);
+    pthread_attr_setstacksize(&Attr, ToolThreadStackSize);
+    // This thread is one of the workers.
+    for (unsigned I = 1; I != NumThreads; ++I) {
+      pthread_t Thread;
+      if (pthread_create(&Thread, &Attr, runToolJobs, &Run) == 0)
+        Threads.push_back(Thread);
+    }
+    pthread_attr_destroy(&Attr);
+  }
+  runToolJobs(&Run);
+  for (unsigned I = 0, E = Threads.size(); I != E; ++I)
+    pthread_join(Threads[I], NULL);
+#else
+  runToolJobs(&Run);
+#endif
+
+  return Run.ProcessingFailed ? 1 : 0;
+}
+
 } // end namespace tooling
 } // end namespace clang
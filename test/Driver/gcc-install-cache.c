@@ -0,0 +1,42 @@
+// Check that --gcc-install-cache saves the detected GCC installation and
+// that later drivers reuse it.
+//
+// RUN: rm -f %t.cache
+// RUN: %clang -no-canonical-prefixes %s -### -v -o %t.o 2>&1 \
+// RUN:     --target=i386-unknown-linux -m32 \
+// RUN:     -ccc-install-dir %S/Inputs/gcc_version_parsing1/bin \
+// RUN:     --sysroot=%S/Inputs/basic_linux_tree \
+// RUN:     --gcc-install-cache=%t.cache \
+// RUN:   | FileCheck --check-prefix=CHECK-MISS %s
+// CHECK-MISS: Selected GCC installation: {{.*}}/Inputs/gcc_version_parsing1/bin/../lib/gcc/i386-unknown-linux/4.7
+// CHECK-MISS: GCC installation cache: miss, made {{[0-9]+}} filesystem queries
+// CHECK-MISS: "{{.*}}/Inputs/gcc_version_parsing1/bin/../lib/gcc/i386-unknown-linux/4.7{{/|\\\\}}crtbegin.o"
+//
+// RUN: %clang -no-canonical-prefixes %s -### -v -o %t.o 2>&1 \
+// RUN:     --target=i386-unknown-linux -m32 \
+// RUN:     -ccc-install-dir %S/Inputs/gcc_version_parsing1/bin \
+// RUN:     --sysroot=%S/Inputs/basic_linux_tree \
+// RUN:     --gcc-install-cache=%t.cache \
+// RUN:   | FileCheck --check-prefix=CHECK-HIT %s
+// CHECK-HIT: Selected GCC installation: {{.*}}/Inputs/gcc_version_parsing1/bin/../lib/gcc/i386-unknown-linux/4.7
+// CHECK-HIT: GCC installation cache: hit, checked {{[0-9]+}} directories instead of making {{[0-9]+}} filesystem queries
+// CHECK-HIT: "{{.*}}/Inputs/gcc_version_parsing1/bin/../lib/gcc/i386-unknown-linux/4.7{{/|\\\\}}crtbegin.o"
+// CHECK-HIT: "-L{{.*}}/Inputs/gcc_version_parsing1/bin/../lib/gcc/i386-unknown-linux/4.7"
+//
+// A driver looking for another installation does not use the cached one.
+// RUN: %clang -no-canonical-prefixes %s -### -v -o %t.o 2>&1 \
+// RUN:     --target=i386-unknown-linux -m32 \
+// RUN:     -ccc-install-dir %S/Inputs/gcc_version_parsing2/bin \
+// RUN:     --sysroot=%S/Inputs/basic_linux_tree \
+// RUN:     --gcc-install-cache=%t.cache \
+// RUN:   | FileCheck --check-prefix=CHECK-OTHER %s
+// CHECK-OTHER: Selected GCC installation: {{.*}}/Inputs/gcc_version_parsing2/bin/../lib/gcc/i386-unknown-linux/4.7.x
+// CHECK-OTHER: GCC installation cache: miss
+//
+// Both installations stay in the cache.
+// RUN: %clang -no-canonical-prefixes %s -### -v -o %t.o 2>&1 \
+// RUN:     --target=i386-unknown-linux -m32 \
+// RUN:     -ccc-install-dir %S/Inputs/gcc_version_parsing1/bin \
+// RUN:     --sysroot=%S/Inputs/basic_linux_tree \
+// RUN:     --gcc-install-cache=%t.cache \
+// RUN:   | FileCheck --check-prefix=CHECK-HIT %s
@@ -0,0 +1,5 @@
+// RUN: %clang -### -fheader-search-listings -c %s 2>&1 | FileCheck %s
+// RUN: %clang -### -fheader-search-listings -fno-header-search-listings -c %s 2>&1 | FileCheck -check-prefix=NO %s
+// CHECK: "-cc1"
+// CHECK: "-fheader-search-listings"
+// NO-NOT: "-fheader-search-listings"
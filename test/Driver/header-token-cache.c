@@ -0,0 +1,3 @@
+// RUN: %clang -### -fheader-token-cache=%t/cache -c %s 2>&1 | FileCheck %s
+// CHECK: "-cc1"
+// CHECK: "-fheader-token-cache={{.*}}cache"
@@ -0,0 +1,29 @@
+// Check -fintegrated-cc1: the compiler runs in the driver's process and its
+// diagnostics and result come through as they would from a child process.
+//
+// RUN: not %clang -fintegrated-cc1 -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck %s
+// CHECK: error: integrated cc1
+// CHECK-NOT: error:
+//
+// RUN: %clang -fintegrated-cc1 -fsyntax-only -DOK %s
+// RUN: %clang -fintegrated-cc1 -fno-integrated-cc1 -fsyntax-only -DOK %s
+//
+// RUN: %clang -fintegrated-cc1 -### -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-CLAIMED %s
+// CHECK-CLAIMED-NOT: argument unused
+//
+// Options that end up in LLVM's global options, like the -backend-option of
+// -gsplit-dwarf or -ftime-report, may only be given once per process, so each
+// input must still be compiled in a process of its own.
+//
+// RUN: rm -rf %t && mkdir %t
+// RUN: cp %s %t/a.c && cp %s %t/b.c
+// RUN: cd %t && %clang -target x86_64-unknown-linux-gnu -fintegrated-cc1 \
+// RUN:   -gsplit-dwarf -S -emit-llvm -DOK a.c b.c
+// RUN: cd %t && %clang -target x86_64-unknown-linux-gnu -fintegrated-cc1 \
+// RUN:   -ftime-report -S -emit-llvm -DOK a.c b.c 2>/dev/null
+
+#ifndef OK
+#error integrated cc1
+#endif
@@ -0,0 +1,20 @@
+// Check -j: each input still fails on its own, and the output of the
+// commands is grouped per command, in command line order.
+//
+// RUN: not %clang -j 2 -v -fsyntax-only %s %s 2>&1 \
+// RUN:   | FileCheck %s
+// CHECK: " -cc1 -triple
+// CHECK: error: parallel job
+// CHECK: " -cc1 -triple
+// CHECK: error: parallel job
+// CHECK-NOT: error:
+//
+// RUN: not %clang -j 0 -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-INVALID %s
+// CHECK-INVALID: invalid integral value '0' in '-j 0'
+//
+// RUN: %clang -j3 -### -fsyntax-only %s 2>&1 \
+// RUN:   | FileCheck --check-prefix=CHECK-CLAIMED %s
+// CHECK-CLAIMED-NOT: argument unused
+
+#error parallel job
@@ -0,0 +1,3 @@
+// RUN: %clang -### -fstat-cache=%t.cache -fstat-cache-generation=3 -c %s 2>&1 | FileCheck %s
+// CHECK: "-cc1"
+// CHECK: "-fstat-cache={{.*}}.cache" "-fstat-cache-generation=3"
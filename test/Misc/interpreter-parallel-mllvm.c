@@ -0,0 +1,21 @@
+// REQUIRES: examples
+// RUN: echo 'int helper(void) { return 42; }' > %t-helper.c
+// RUN: clang-interpreter -interp-jobs=2 -mllvm -enable-tbaa=false \
+// RUN:   %s %t-helper.c 2>&1 | FileCheck %s
+// RUN: clang-interpreter -interp-jobs=2 \
+// RUN:   -Xclang -backend-option -Xclang -enable-tbaa=false \
+// RUN:   %s %t-helper.c 2>&1 | FileCheck %s
+
+// LLVM options given for a program of several files are parsed once, and
+// not again for every file that is compiled, on whichever thread.
+
+int printf(const char *, ...);
+int helper(void);
+
+int main(void) {
+  printf("helper returned %d\n", helper());
+  return 0;
+}
+
+// CHECK-NOT: may only occur
+// CHECK: helper returned 42
@@ -0,0 +1,11 @@
+// REQUIRES: examples
+// RUN: printf 'int x = 41;\nprintf("ran %%%%d\\n", x + 1);\nfor (int i = 0; i != 2; ++i) printf("loop %%%%d\\n", i);\n' \
+// RUN:   | clang-interpreter -interp-repl %s | FileCheck %s
+
+// Statements typed at the prompt of a C++ session are run, not only parsed.
+
+extern "C" int printf(const char *, ...);
+
+// CHECK: ran 42
+// CHECK: loop 0
+// CHECK: loop 1
@@ -0,0 +1,22 @@
+// REQUIRES: examples
+// RUN: rm -rf %t.cache
+// RUN: clang-interpreter -fms-extensions -interp-object-cache=%t.cache %s \
+// RUN:   | FileCheck %s
+// RUN: clang-interpreter -fms-extensions -interp-object-cache=%t.cache \
+// RUN:   -interp-startup-report=%t.json %s | FileCheck %s
+// RUN: ls %t.cache | grep '\.entry$' | count 1
+
+// The startup report must not change the code that is generated: the object
+// cache, keyed on the IR, finds the module of the first run in the second.
+// The pragma reaches the code generator through a hook of its own.
+
+#pragma comment(lib, "m")
+
+int printf(const char *, ...);
+
+int main(void) {
+  printf("ran\n");
+  return 0;
+}
+
+// CHECK: ran
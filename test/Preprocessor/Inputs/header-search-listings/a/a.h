@@ -0,0 +1 @@
+#define FROM_A 1
@@ -0,0 +1 @@
+#define FROM_B_SYS 1
@@ -0,0 +1,6 @@
+#define CACHED_VALUE 42
+#ifdef WANT_FUNCTION
+int cached_function(void);
+#else
+int cached_variable = CACHED_VALUE;
+#endif
@@ -0,0 +1,36 @@
+// RUN: %clang_cc1 -fheader-search-listings -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o - | FileCheck %s
+// RUN: %clang_cc1 -fheader-search-listings -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o /dev/null -print-stats 2>&1 | FileCheck -check-prefix=STATS %s
+// RUN: %clang_cc1 -fheader-search-listings -I %S/Inputs/header-search-listings/a -DMISSING -E %s -o /dev/null 2>&1 | FileCheck -check-prefix=MISSING %s
+
+// A directory modified within the last second is not listed, since a file
+// created in it within the same second would go unnoticed.
+// RUN: rm -rf %t && mkdir %t
+// RUN: echo '#define FRESH 1' > %t/fresh.h
+// RUN: echo '#include "fresh.h"' > %t/main.c
+// RUN: touch -t 209901010000 %t
+// RUN: %clang_cc1 -fheader-search-listings -I %t -E %t/main.c -o /dev/null -print-stats 2>&1 | FileCheck -check-prefix=FRESH %s
+// FRESH: 0 directories listed.
+
+// Files are found in whichever search directory has them, even in
+// subdirectories, while the candidates in the other directories are ruled out
+// by their listings.
+
+#include "a.h"
+#include <sys/b-sys.h>
+#include "c.h"
+
+int found = FROM_A + FROM_B_SYS + FROM_C;
+// CHECK: int found = 1 + 1 + 1;
+
+#if __has_include("not-there.h")
+int not_there;
+#endif
+// CHECK-NOT: not_there
+
+#ifdef MISSING
+#include "missing.h"
+// MISSING: 'missing.h' file not found
+#endif
+
+// STATS: {{[0-9]+}} directories listed.
+// STATS-NEXT: {{[1-9][0-9]*}} stat calls avoided by directory listings.
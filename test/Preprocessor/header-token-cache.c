@@ -0,0 +1,39 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 -fheader-token-cache=%t -isystem %S/Inputs/header-token-cache -E %s -o - | FileCheck -check-prefix=VARIABLE %s
+// RUN: %clang_cc1 -fheader-token-cache=%t -isystem %S/Inputs/header-token-cache -E %s -o %t.i -print-stats 2>&1 | FileCheck -check-prefix=HIT %s
+// RUN: FileCheck -check-prefix=VARIABLE -input-file %t.i %s
+// RUN: %clang_cc1 -fheader-token-cache=%t -isystem %S/Inputs/header-token-cache -DWANT_FUNCTION -E %s -o - | FileCheck -check-prefix=FUNCTION %s
+
+// A header that changes after its tokens were cached, in size or only in
+// modification time, misses the cache and is lexed again.
+// RUN: rm -rf %t.cache %t.inc && mkdir %t.inc
+// RUN: cp %S/Inputs/header-token-cache/cached.h %t.inc/cached.h
+// RUN: %clang_cc1 -fheader-token-cache=%t.cache -isystem %t.inc -E %s -o /dev/null
+// RUN: %clang_cc1 -fheader-token-cache=%t.cache -isystem %t.inc -E %s -o /dev/null -print-stats 2>&1 | FileCheck -check-prefix=HIT %s
+// RUN: echo 'int appended_variable;' >> %t.inc/cached.h
+// RUN: %clang_cc1 -fheader-token-cache=%t.cache -isystem %t.inc -E %s -o %t.i -print-stats 2>&1 | FileCheck -check-prefix=MISS %s
+// RUN: FileCheck -check-prefix=APPENDED -input-file %t.i %s
+// RUN: sed -e 's/42/43/' %t.inc/cached.h > %t.h
+// RUN: cat %t.h > %t.inc/cached.h
+// RUN: touch -t 200001010000 %t.inc/cached.h
+// RUN: %clang_cc1 -fheader-token-cache=%t.cache -isystem %t.inc -E %s -o %t.i -print-stats 2>&1 | FileCheck -check-prefix=MISS %s
+// RUN: FileCheck -check-prefix=CHANGED -input-file %t.i %s
+
+// The tokens of a system header are cached the first time it is included,
+// and read back from the cache by later compiles, whatever macros they
+// define.
+
+#include <cached.h>
+
+int main_file_value = CACHED_VALUE;
+
+// VARIABLE: int cached_variable = 42;
+// VARIABLE: int main_file_value = 42;
+// FUNCTION: int cached_function(void);
+// FUNCTION: int main_file_value = 42;
+// HIT: 1 system headers read from the cache, 0 missing from it.
+// MISS: 0 system headers read from the cache, 1 missing from it.
+// APPENDED: int cached_variable = 42;
+// APPENDED: int appended_variable;
+// CHANGED: int cached_variable = 43;
+// CHANGED: int main_file_value = 43;
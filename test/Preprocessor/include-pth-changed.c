@@ -0,0 +1,21 @@
+// RUN: rm -rf %t && mkdir %t
+// RUN: echo 'int from_the_old_header;' > %t/changing.h
+// RUN: %clang_cc1 -I%t -emit-pth %s -o %t/tokens.pth
+// RUN: echo 'int from_a_new_header_of_another_size;' > %t/changing.h
+// RUN: %clang_cc1 -I%t -include-pth %t/tokens.pth %s -E | FileCheck -check-prefix=SIZE %s
+//
+// RUN: echo 'int from_the_old_header;' > %t/changing.h
+// RUN: %clang_cc1 -I%t -emit-pth %s -o %t/tokens.pth
+// RUN: echo 'int from_the_new_header;' > %t/changing.h
+// RUN: touch -t 200001010000 %t/changing.h
+// RUN: %clang_cc1 -I%t -include-pth %t/tokens.pth %s -E | FileCheck -check-prefix=MTIME %s
+
+// A header that changed after its tokens went into the PTH file, in size or
+// only in modification time, is lexed again.
+
+#include "changing.h"
+
+// SIZE-NOT: from_the_old_header
+// SIZE: int from_a_new_header_of_another_size;
+// MTIME-NOT: from_the_old_header
+// MTIME: int from_the_new_header;
@@ -0,0 +1,34 @@
+// RUN: rm -f %t.cache %t.gen-cache %t.ref
+// RUN: %clang_cc1 -fstat-cache=%t.cache -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o - | FileCheck %s
+// RUN: %clang_cc1 -fstat-cache=%t.cache -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o %t.i -print-stats 2>&1 | FileCheck -check-prefix=HITS %s
+// RUN: FileCheck -input-file %t.i %s
+
+// A compile that learns nothing new leaves the cache file alone.
+// RUN: touch -t 200001010000 %t.cache %t.ref
+// RUN: %clang_cc1 -fstat-cache=%t.cache -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o - | FileCheck %s
+// RUN: find %t.cache -newer %t.ref | count 0
+
+// With a generation, every entry is trusted without a stat().
+// RUN: %clang_cc1 -fstat-cache=%t.gen-cache -fstat-cache-generation=7 -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o - | FileCheck %s
+// RUN: %clang_cc1 -fstat-cache=%t.gen-cache -fstat-cache-generation=7 -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o %t.gen.i -print-stats 2>&1 | FileCheck -check-prefix=GENERATION %s
+// RUN: FileCheck -input-file %t.gen.i %s
+// RUN: touch -t 200001010000 %t.gen-cache %t.ref
+// RUN: %clang_cc1 -fstat-cache=%t.gen-cache -fstat-cache-generation=7 -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o - | FileCheck %s
+// RUN: find %t.gen-cache -newer %t.ref | count 0
+
+// A damaged cache file is ignored.
+// RUN: echo garbage > %t.cache
+// RUN: %clang_cc1 -fstat-cache=%t.cache -I %S/Inputs/header-search-listings/a -I %S/Inputs/header-search-listings/b -I %S/Inputs/header-search-listings/c -E %s -o - | FileCheck %s
+
+#include "a.h"
+#include <sys/b-sys.h>
+#include "c.h"
+
+int found = FROM_A + FROM_B_SYS + FROM_C;
+// CHECK: int found = 1 + 1 + 1;
+
+// HITS: *** Persistent Stat Cache Stats:
+// HITS-NEXT: {{[1-9][0-9]*}} stat calls answered from the cache
+// GENERATION: *** Persistent Stat Cache Stats:
+// GENERATION-NEXT: {{[1-9][0-9]*}} stat calls answered from the cache
+// GENERATION-NEXT: 0 directories stat'ed to validate the cache.
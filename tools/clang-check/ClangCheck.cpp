@@ -24,6 +24,7 @@
 #include "clang/Rewrite/Frontend/FixItRewriter.h"
 #include "clang/Rewrite/Frontend/FrontendActions.h"
 #include "clang/Tooling/CommonOptionsParser.h"
+#include "clang/Tooling/PreambleCache.h"
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Path.h"
@@ -79,6 +80,9 @@ static cl::list<std::string> ArgsAfter("extra-arg",
     cl::desc("Additional argument to append to the compiler command line"));
 static cl::list<std::string> ArgsBefore("extra-arg-before",
     cl::desc("Additional argument to prepend to the compiler command line"));
+static cl::opt<bool> SharePreambles("share-preambles",
+    cl::desc("Parse the #includes files start with only once when files\n"
+             "share them, and print how often they were shared"));
 
 namespace {
 
@@ -219,5 +223,12 @@ int main(int argc, const char **argv) {
   else
     FrontendFactory = newFrontendActionFactory(&CheckFactory);
 
-  return Tool.run(FrontendFactory);
+  PreambleCache Preambles;
+  if (SharePreambles)
+    Tool.setPreambleCache(&Preambles);
+
+  int Result = Tool.run(FrontendFactory);
+  if (SharePreambles)
+    Preambles.printStats(llvm::errs());
+  return Result;
 }
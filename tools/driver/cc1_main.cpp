@@ -26,6 +26,7 @@
 #include "llvm/LinkAllPasses.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Option/OptTable.h"
+#include "llvm/Support/CrashRecoveryContext.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Signals.h"
@@ -40,6 +41,9 @@ using namespace llvm::opt;
 // Main driver
 //===----------------------------------------------------------------------===//
 
+/// The status cc1_main_in_process returns after a fatal error.
+static int InProcessFatalErrorStatus;
+
 static void LLVMErrorHandler(void *UserData, const std::string &Message,
                              bool GenCrashDiag) {
   DiagnosticsEngine &Diags = *static_cast<DiagnosticsEngine*>(UserData);
@@ -53,7 +57,15 @@ static void LLVMErrorHandler(void *UserData, const std::string &Message,
   // We cannot recover from llvm errors.  When reporting a fatal error, exit
   // with status 70 to generate crash diagnostics.  For BSD systems this is
   // defined as an internal software error.  Otherwise, exit with status 1.
-  exit(GenCrashDiag ? 70 : 1);
+  int Status = GenCrashDiag ? 70 : 1;
+
+  // Inside the driver's process, return the status to the driver instead.
+  if (llvm::CrashRecoveryContext *CRC =
+        llvm::CrashRecoveryContext::GetCurrent()) {
+    InProcessFatalErrorStatus = Status;
+    CRC->HandleCrash();
+  }
+  exit(Status);
 }
 
 int cc1_main(const char **ArgBegin, const char **ArgEnd,
@@ -122,3 +134,42 @@ int cc1_main(const char **ArgBegin, const char **ArgEnd,
 
   return !Success;
 }
+
+namespace {
+struct InProcessInvocation {
+  const char **ArgBegin;
+  const char **ArgEnd;
+  const char *Argv0;
+  void *MainAddr;
+  int Res;
+};
+}
+
+static void RunInProcessInvocation(void *UserData) {
+  InProcessInvocation *Inv = static_cast<InProcessInvocation*>(UserData);
+  Inv->Res = cc1_main(Inv->ArgBegin, Inv->ArgEnd, Inv->Argv0, Inv->MainAddr);
+}
+
+/// cc1_main_in_process - Run cc1_main for a -cc1 job of the driver, in the
+/// driver's process.  A crash is reported as a negative result, like that of
+/// a compiler process killed by a signal, and a fatal error returns the
+/// status the compiler process would have exited with.
+int cc1_main_in_process(const char **ArgBegin, const char **ArgEnd,
+                        const char *Argv0, void *MainAddr) {
+  InProcessInvocation Inv = { ArgBegin, ArgEnd, Argv0, MainAddr, 1 };
+  InProcessFatalErrorStatus = 0;
+
+  llvm::CrashRecoveryContext::Enable();
+  bool Success;
+  {
+    llvm::CrashRecoveryContext CRC;
+    Success = CRC.RunSafely(RunInProcessInvocation, &Inv);
+  }
+  llvm::CrashRecoveryContext::Disable();
+  if (Success)
+    return Inv.Res;
+
+  // cc1_main did not get to remove its error handler.
+  llvm::remove_fatal_error_handler();
+  return InProcessFatalErrorStatus ? InProcessFatalErrorStatus : -1;
+}
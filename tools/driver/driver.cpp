@@ -189,6 +189,14 @@ extern int cc1_main(const char **ArgBegin, const char **ArgEnd,
                     const char *Argv0, void *MainAddr);
 extern int cc1as_main(const char **ArgBegin, const char **ArgEnd,
                       const char *Argv0, void *MainAddr);
+extern int cc1_main_in_process(const char **ArgBegin, const char **ArgEnd,
+                               const char *Argv0, void *MainAddr);
+
+static int ExecuteCC1InProcess(const char **ArgBegin, const char **ArgEnd,
+                               const char *Argv0) {
+  return cc1_main_in_process(ArgBegin, ArgEnd, Argv0,
+                             (void*) (intptr_t) GetExecutablePath);
+}
 
 static void ParseProgName(SmallVectorImpl<const char *> &ArgVector,
                           std::set<std::string> &SavedStrings,
@@ -374,6 +382,9 @@ int main(int argc_, const char **argv_) {
   llvm::InitializeAllTargets();
   ParseProgName(argv, SavedStrings, TheDriver);
 
+  // -fintegrated-cc1 runs the compiler by calling cc1_main.
+  TheDriver.CC1Main = ExecuteCC1InProcess;
+
   // Handle CC_PRINT_OPTIONS and CC_PRINT_OPTIONS_FILE.
   TheDriver.CCPrintOptions = !!::getenv("CC_PRINT_OPTIONS");
   if (TheDriver.CCPrintOptions)
@@ -0,0 +1,121 @@
+//===-- lexer-bench/LexerBench.cpp - Lexer throughput benchmark -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Measures how fast the lexer scans source files, in MB/s.
+///
+/// Each file is lexed in raw mode, the way the preprocessor skips excluded
+/// blocks and the way tools like clang-format lex, so that only the scanning
+/// loops of the lexer are measured: no identifier lookup, no macro expansion
+/// and no #include.  Large real headers make good inputs, e.g. those of the
+/// C++ standard library or of LLVM itself:
+///
+///   lexer-bench -n 20 /usr/include/c++/4.8/bits/*.h
+///
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/SourceLocation.h"
+#include "clang/Lex/Lexer.h"
+#include "clang/Lex/Token.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <algorithm>
+
+using namespace llvm;
+using namespace clang;
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::OneOrMore,
+                                        cl::desc("<file> ..."));
+
+static cl::opt<unsigned>
+Repetitions("n", cl::init(10),
+            cl::desc("Number of times to lex each file; the fastest run "
+                     "counts (default 10)"));
+
+static cl::opt<bool>
+LexAsC("c", cl::desc("Lex the files as C rather than C++11"));
+
+/// Lex \p Buffer in raw mode, returning the number of tokens.
+static unsigned lexBuffer(const MemoryBuffer &Buffer,
+                          const LangOptions &LangOpts) {
+  Lexer L(SourceLocation(), LangOpts, Buffer.getBufferStart(),
+          Buffer.getBufferStart(), Buffer.getBufferEnd());
+  Token Tok;
+  unsigned NumTokens = 0;
+  do {
+    L.LexFromRawLexer(Tok);
+    ++NumTokens;
+  } while (Tok.isNot(tok::eof));
+  return NumTokens;
+}
+
+static double getMBPerSecond(uint64_t Bytes, double Seconds) {
+  return Seconds > 0 ? Bytes / Seconds / (1024 * 1024) : 0;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  cl::ParseCommandLineOptions(argc, argv, "clang lexer throughput benchmark\n");
+
+  LangOptions LangOpts;
+  LangOpts.LineComment = 1;
+  if (!LexAsC) {
+    LangOpts.CPlusPlus = 1;
+    LangOpts.CPlusPlus11 = 1;
+    LangOpts.Bool = 1;
+  }
+
+  unsigned NumRuns = std::max(1U, unsigned(Repetitions));
+  uint64_t TotalBytes = 0, TotalTokens = 0;
+  double TotalSeconds = 0;
+  bool HadError = false;
+
+  outs() << format("%-40s %10s %10s %10s\n", "file", "bytes", "tokens",
+                   "MB/s");
+  for (unsigned i = 0, e = InputFiles.size(); i != e; ++i) {
+    OwningPtr<MemoryBuffer> Buffer;
+    if (error_code EC = MemoryBuffer::getFile(InputFiles[i], Buffer)) {
+      errs() << "error: cannot read '" << InputFiles[i] << "': "
+             << EC.message() << "\n";
+      HadError = true;
+      continue;
+    }
+
+    double Fastest = 0;
+    unsigned NumTokens = 0;
+    for (unsigned Run = 0; Run != NumRuns; ++Run) {
+      double Start = TimeRecord::getCurrentTime(true).getWallTime();
+      NumTokens = lexBuffer(*Buffer, LangOpts);
+      double Seconds = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+      if (Run == 0 || Seconds < Fastest)
+        Fastest = Seconds;
+    }
+
+    uint64_t Bytes = Buffer->getBufferSize();
+    outs() << format("%-40s %10llu %10u %10.1f\n", InputFiles[i].c_str(),
+                     (unsigned long long)Bytes, NumTokens,
+                     getMBPerSecond(Bytes, Fastest));
+    TotalBytes += Bytes;
+    TotalTokens += NumTokens;
+    TotalSeconds += Fastest;
+  }
+
+  outs() << format("%-40s %10llu %10llu %10.1f\n", "total",
+                   (unsigned long long)TotalBytes,
+                   (unsigned long long)TotalTokens,
+                   getMBPerSecond(TotalBytes, TotalSeconds));
+  return HadError;
+}
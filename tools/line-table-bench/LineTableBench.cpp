@@ -0,0 +1,159 @@
+//===-- line-table-bench/LineTableBench.cpp - Line number lookup benchmark ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief Measures what the first line number lookups in a large file cost.
+///
+/// The SourceManager builds the line table of a file the first time a line
+/// number in it is asked for, e.g. by a diagnostic or by debug info.  This
+/// times a few lookups, spread over the start of each file, with the table
+/// built in one go and built incrementally.  With no input files, a large
+/// source file is generated:
+///
+///   line-table-bench -generate-mb 64 -queries 10 -span 5
+///
+//===----------------------------------------------------------------------===//
+
+#include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/DiagnosticOptions.h"
+#include "clang/Basic/FileManager.h"
+#include "clang/Basic/FileSystemOptions.h"
+#include "clang/Basic/SourceManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <string>
+
+using namespace llvm;
+using namespace clang;
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::ZeroOrMore,
+                                        cl::desc("[<file> ...]"));
+
+static cl::opt<unsigned>
+GenerateMB("generate-mb", cl::init(32),
+           cl::desc("Size in MB of the file generated when no input file is "
+                    "given (default 32)"));
+
+static cl::opt<unsigned>
+NumQueries("queries", cl::init(10),
+           cl::desc("Number of line numbers to look up in each file "
+                    "(default 10)"));
+
+static cl::opt<unsigned>
+SpanPercent("span", cl::init(10),
+            cl::desc("Percentage of each file, from its start, that the "
+                     "lookups are spread over (default 10)"));
+
+static cl::opt<unsigned>
+Repetitions("n", cl::init(5),
+            cl::desc("Number of times to run the lookups; the fastest run "
+                     "counts (default 5)"));
+
+/// Generate about \p Size bytes of C code, with lines of varied length.
+static std::string generateSource(uint64_t Size) {
+  std::string Source;
+  Source.reserve(Size + 128);
+  unsigned Seed = 1;
+  for (unsigned i = 0; Source.size() < Size; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    Source += "int generated_";
+    Source += std::string(1 + (Seed >> 16) % 40, 'x');
+    Source += "_" + utostr(i) + " = " + utostr(Seed >> 20) + ";";
+    if ((Seed >> 8) % 8 == 0)
+      Source += " // comment";
+    Source += "\n";
+  }
+  return Source;
+}
+
+/// Look up the line numbers of -queries offsets into \p Data, spread over
+/// the -span percent of it at its start.  Returns the wall time taken by the
+/// first lookup, in \p TotalSeconds that of all of them, and in \p LastLine
+/// the line number of the last one.
+static double lookUpLines(StringRef Data, bool Incremental,
+                          double &TotalSeconds, unsigned &LastLine) {
+  FileSystemOptions FileMgrOpts;
+  FileManager FileMgr(FileMgrOpts);
+  IntrusiveRefCntPtr<DiagnosticIDs> DiagID(new DiagnosticIDs());
+  DiagnosticsEngine Diags(DiagID, new DiagnosticOptions,
+                          new IgnoringDiagConsumer());
+  SourceManager SourceMgr(Diags, FileMgr);
+  SourceMgr.setIncrementalLineTables(Incremental);
+  FileID FID = SourceMgr.createFileIDForMemBuffer(
+    MemoryBuffer::getMemBuffer(Data, "<bench>"));
+
+  uint64_t Span = Data.size() * uint64_t(std::min(100U, unsigned(SpanPercent)))
+                  / 100;
+  unsigned Queries = std::max(1U, unsigned(NumQueries));
+  double Start = TimeRecord::getCurrentTime(true).getWallTime();
+  double First = 0;
+  for (unsigned i = 0; i != Queries; ++i) {
+    LastLine = SourceMgr.getLineNumber(FID, Span * i / Queries);
+    if (i == 0)
+      First = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+  }
+  TotalSeconds = TimeRecord::getCurrentTime(false).getWallTime() - Start;
+  return First;
+}
+
+static void runBenchmark(StringRef Name, StringRef Data) {
+  unsigned NumRuns = std::max(1U, unsigned(Repetitions));
+  for (unsigned Incremental = 0; Incremental != 2; ++Incremental) {
+    double FastestFirst = 0, FastestTotal = 0;
+    unsigned LastLine = 0;
+    for (unsigned Run = 0; Run != NumRuns; ++Run) {
+      double Total;
+      double First = lookUpLines(Data, Incremental, Total, LastLine);
+      if (Run == 0 || First < FastestFirst)
+        FastestFirst = First;
+      if (Run == 0 || Total < FastestTotal)
+        FastestTotal = Total;
+    }
+    outs() << format("%-32s %-12s %10llu %10u %12.3f %12.3f\n",
+                     Name.str().c_str(),
+                     Incremental ? "incremental" : "whole",
+                     (unsigned long long)Data.size(), LastLine,
+                     FastestFirst * 1000, FastestTotal * 1000);
+  }
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  cl::ParseCommandLineOptions(argc, argv,
+                              "clang line number lookup benchmark\n");
+
+  outs() << format("%-32s %-12s %10s %10s %12s %12s\n", "file", "table",
+                   "bytes", "last line", "first (ms)", "all (ms)");
+  if (InputFiles.empty()) {
+    std::string Source = generateSource(uint64_t(GenerateMB) * 1024 * 1024);
+    runBenchmark("<generated>", Source);
+    return 0;
+  }
+
+  bool HadError = false;
+  for (unsigned i = 0, e = InputFiles.size(); i != e; ++i) {
+    OwningPtr<MemoryBuffer> Buffer;
+    if (error_code EC = MemoryBuffer::getFile(InputFiles[i], Buffer)) {
+      errs() << "error: cannot read '" << InputFiles[i] << "': "
+             << EC.message() << "\n";
+      HadError = true;
+      continue;
+    }
+    runBenchmark(InputFiles[i], Buffer->getBuffer());
+  }
+  return HadError;
+}
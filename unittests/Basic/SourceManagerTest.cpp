@@ -19,6 +19,7 @@
 #include "clang/Lex/ModuleLoader.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Config/config.h"
 #include "gtest/gtest.h"
@@ -164,6 +165,56 @@ TEST_F(SourceManagerTest, getColumnNumber) {
   EXPECT_EQ(1U, SourceMgr.getColumnNumber(MainFileID, 0, NULL));
 }
 
+TEST_F(SourceManagerTest, incrementalLineTables) {
+  // Several chunks worth of lines, of varied length and with every kind of
+  // line ending.
+  const char *const LineEnds[] = { "\n", "\r\n", "\r", "\n\r" };
+  std::string Source;
+  for (unsigned i = 0; i != 40000; ++i)
+    Source += std::string(1 + i % 23, 'x') + LineEnds[i % 4];
+  Source += "int last;";
+
+  // The same buffer, with its line table computed in one go.
+  IntrusiveRefCntPtr<DiagnosticIDs> WholeDiagID(new DiagnosticIDs());
+  DiagnosticsEngine WholeDiags(WholeDiagID, new DiagnosticOptions,
+                               new IgnoringDiagConsumer());
+  SourceManager WholeSourceMgr(WholeDiags, FileMgr);
+  WholeSourceMgr.setIncrementalLineTables(false);
+
+  FileID FID = SourceMgr.createMainFileIDForMemBuffer(
+    MemoryBuffer::getMemBuffer(Source));
+  FileID WholeFID = WholeSourceMgr.createMainFileIDForMemBuffer(
+    MemoryBuffer::getMemBuffer(Source));
+
+  // Sparse queries, going back and forth through the file.
+  unsigned Size = Source.size();
+  const unsigned Offsets[] = { 10, 5000, 200000, 100, 150000, 390000, 1,
+                               Size - 1, 70000, Size };
+  for (unsigned i = 0; i != llvm::array_lengthof(Offsets); ++i) {
+    unsigned Offs = Offsets[i];
+    bool Invalid = true;
+    EXPECT_EQ(WholeSourceMgr.getLineNumber(WholeFID, Offs),
+              SourceMgr.getLineNumber(FID, Offs, &Invalid)) << Offs;
+    EXPECT_FALSE(Invalid);
+    EXPECT_EQ(WholeSourceMgr.getColumnNumber(WholeFID, Offs),
+              SourceMgr.getColumnNumber(FID, Offs)) << Offs;
+  }
+  EXPECT_EQ(40001U, SourceMgr.getLineNumber(FID, Size));
+
+  // Lines asked for by number rather than by offset, in a copy of the buffer
+  // with no line table yet.
+  FileID LinesFID = SourceMgr.createFileIDForMemBuffer(
+    MemoryBuffer::getMemBuffer(Source));
+  const unsigned Lines[] = { 39000, 2, 40001, 25000 };
+  for (unsigned i = 0; i != llvm::array_lengthof(Lines); ++i) {
+    SourceLocation Loc = SourceMgr.translateLineCol(LinesFID, Lines[i], 3);
+    SourceLocation WholeLoc = WholeSourceMgr.translateLineCol(WholeFID,
+                                                              Lines[i], 3);
+    EXPECT_EQ(WholeSourceMgr.getFileOffset(WholeLoc),
+              SourceMgr.getFileOffset(Loc)) << Lines[i];
+  }
+}
+
 #if defined(LLVM_ON_UNIX)
 
 TEST_F(SourceManagerTest, getMacroArgExpandedLocation) {
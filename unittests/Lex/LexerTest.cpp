@@ -20,6 +20,7 @@
 #include "clang/Lex/ModuleLoader.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/PreprocessorOptions.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/config.h"
 #include "gtest/gtest.h"
 
@@ -87,6 +88,31 @@ protected:
     return toks;
   }
 
+  /// Lex \p Source in raw mode, keeping comments, from a buffer that ends
+  /// right after it.
+  std::vector<Token> RawLex(StringRef Source) {
+    MemoryBuffer *Buf = MemoryBuffer::getMemBufferCopy(Source);
+    FileID FID = SourceMgr.createFileIDForMemBuffer(Buf);
+    Lexer L(FID, Buf, SourceMgr, LangOpts);
+    L.SetCommentRetentionState(true);
+
+    std::vector<Token> Toks;
+    Token Tok;
+    while (!L.LexFromRawLexer(Tok))
+      Toks.push_back(Tok);
+    if (Tok.isNot(tok::eof))
+      Toks.push_back(Tok);
+    return Toks;
+  }
+
+  std::string getSpelling(const Token &Tok) {
+    return Lexer::getSpelling(Tok, SourceMgr, LangOpts);
+  }
+
+  unsigned getOffset(const Token &Tok) {
+    return SourceMgr.getFileOffset(Tok.getLocation());
+  }
+
   std::string getSourceText(Token Begin, Token End) {
     bool Invalid;
     StringRef Str =
@@ -355,4 +381,121 @@ TEST_F(LexerTest, LexAPI) {
   EXPECT_EQ("N", Lexer::getImmediateMacroName(idLoc4, SourceMgr, LangOpts));
 }
 
+// The lexer scans identifiers, whitespace, line comments and string literals
+// 16 characters at a time where it can.  Check tokens that start, end or
+// straddle such chunks, or end the buffer.
+
+/// An identifier of \p Length characters, using every kind of character
+/// allowed in one.
+static std::string makeIdentifier(unsigned Length) {
+  static const char Chars[] = "aZ_09zA";
+  std::string Ident;
+  for (unsigned I = 0; I != Length; ++I)
+    Ident += Chars[I % (sizeof(Chars) - 1)];
+  return Ident;
+}
+
+static const unsigned ChunkLengths[] = { 1, 14, 15, 16, 17, 31, 32, 33 };
+
+TEST_F(LexerTest, RawLexIdentifiersAndWhitespaceAcrossChunks) {
+  for (unsigned Indent = 0; Indent != 36; ++Indent) {
+    for (unsigned I = 0; I != llvm::array_lengthof(ChunkLengths); ++I) {
+      std::string Ident = makeIdentifier(ChunkLengths[I]);
+      std::string Spaces(Indent, Indent % 2 ? ' ' : '\t');
+
+      std::vector<Token> Toks = RawLex(Spaces + Ident + Spaces + "+");
+      ASSERT_EQ(2u, Toks.size());
+      EXPECT_TRUE(Toks[0].is(tok::raw_identifier));
+      EXPECT_EQ(Ident, getSpelling(Toks[0]));
+      EXPECT_EQ(Indent, getOffset(Toks[0]));
+      EXPECT_TRUE(Toks[1].is(tok::plus));
+      EXPECT_EQ(2 * Indent + Ident.size(), getOffset(Toks[1]));
+
+      // The identifier ends the buffer.
+      Toks = RawLex(Spaces + Ident);
+      ASSERT_EQ(1u, Toks.size());
+      EXPECT_EQ(Ident, getSpelling(Toks[0]));
+    }
+  }
+}
+
+TEST_F(LexerTest, RawLexLineCommentsAcrossChunks) {
+  for (unsigned Start = 0; Start != 18; ++Start) {
+    for (unsigned I = 0; I != llvm::array_lengthof(ChunkLengths); ++I) {
+      std::string Comment = "//" + std::string(ChunkLengths[I], 'c');
+      std::string Source = std::string(Start, ' ') + Comment;
+
+      std::vector<Token> Toks = RawLex(Source + "\nx");
+      ASSERT_EQ(2u, Toks.size());
+      EXPECT_TRUE(Toks[0].is(tok::comment));
+      EXPECT_EQ(Comment, getSpelling(Toks[0]));
+      EXPECT_TRUE(Toks[1].is(tok::raw_identifier));
+      EXPECT_EQ(Source.size() + 1, getOffset(Toks[1]));
+
+      Toks = RawLex(Source + "\r\nx");
+      ASSERT_EQ(2u, Toks.size());
+      EXPECT_EQ(Comment, getSpelling(Toks[0]));
+
+      // The comment ends the buffer.
+      Toks = RawLex(Source);
+      ASSERT_EQ(1u, Toks.size());
+      EXPECT_EQ(Comment, getSpelling(Toks[0]));
+    }
+  }
+}
+
+TEST_F(LexerTest, RawLexStringLiteralsAcrossChunks) {
+  for (unsigned Start = 0; Start != 18; ++Start) {
+    for (unsigned I = 0; I != llvm::array_lengthof(ChunkLengths); ++I) {
+      std::string Body(ChunkLengths[I], 's');
+      // Escapes stop the fast scan; put one at each position in turn.
+      for (unsigned Escape = 0; Escape <= Body.size(); ++Escape) {
+        std::string Literal =
+          "\"" + Body.substr(0, Escape) + "\\\"" + Body.substr(Escape) + "\"";
+
+        std::vector<Token> Toks =
+          RawLex(std::string(Start, ' ') + Literal + ";");
+        ASSERT_EQ(2u, Toks.size());
+        EXPECT_TRUE(Toks[0].is(tok::string_literal));
+        EXPECT_EQ(Literal, getSpelling(Toks[0]));
+        EXPECT_TRUE(Toks[1].is(tok::semi));
+
+        // The literal ends the buffer.
+        Toks = RawLex(std::string(Start, ' ') + Literal);
+        ASSERT_EQ(1u, Toks.size());
+        EXPECT_EQ(Literal, getSpelling(Toks[0]));
+      }
+    }
+  }
+}
+
+TEST_F(LexerTest, RawLexEscapedNewlineAtEndOfChunk) {
+  // In each case, the backslash is the 16th character of the buffer.
+  std::vector<Token> Toks = RawLex("abcdefghijklmno\\\npq x");
+  ASSERT_EQ(2u, Toks.size());
+  EXPECT_TRUE(Toks[0].is(tok::raw_identifier));
+  EXPECT_TRUE(Toks[0].needsCleaning());
+  EXPECT_EQ("abcdefghijklmnopq", getSpelling(Toks[0]));
+  EXPECT_EQ("x", getSpelling(Toks[1]));
+
+  Toks = RawLex("// comment text\\\nstill the comment\nx");
+  ASSERT_EQ(2u, Toks.size());
+  EXPECT_TRUE(Toks[0].is(tok::comment));
+  EXPECT_EQ(strlen("// comment text\\\nstill the comment"),
+            Toks[0].getLength());
+  EXPECT_EQ("x", getSpelling(Toks[1]));
+
+  Toks = RawLex("\"abcdefghijklmn\\\nop\" x");
+  ASSERT_EQ(2u, Toks.size());
+  EXPECT_TRUE(Toks[0].is(tok::string_literal));
+  EXPECT_EQ("\"abcdefghijklmnop\"", getSpelling(Toks[0]));
+  EXPECT_EQ("x", getSpelling(Toks[1]));
+
+  // Whitespace up to an escaped newline at the end of a chunk.
+  Toks = RawLex("a              \\\n  b");
+  ASSERT_EQ(2u, Toks.size());
+  EXPECT_EQ("a", getSpelling(Toks[0]));
+  EXPECT_EQ("b", getSpelling(Toks[1]));
+}
+
 } // anonymous namespace
@@ -14,7 +14,9 @@
 #include "clang/Tooling/FileMatchTrie.h"
 #include "clang/Tooling/JSONCompilationDatabase.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 namespace clang {
@@ -291,6 +293,87 @@ TEST(findCompileArgsInJsonDatabase, FindsEntry) {
   EXPECT_EQ("command4", FoundCommand.CommandLine[0]) << ErrorMessage;
 }
 
+TEST(findCompileArgsInJsonDatabase, UnescapesJSONStrings) {
+  std::string ErrorMessage;
+  CompileCommand FoundCommand = findCompileArgsInJsonDatabase(
+    "//net/dir/file",
+    "[{\"directory\":\"\\/\\/net\\/dir\","
+      "\"command\":\"cc \\u0041\\\"\\\\\\\"\\\"\","
+      "\"f\\u0069le\":\"fil\\u0065\"}]",
+    ErrorMessage);
+  EXPECT_EQ("//net/dir", FoundCommand.Directory) << ErrorMessage;
+  ASSERT_EQ(2u, FoundCommand.CommandLine.size()) << ErrorMessage;
+  EXPECT_EQ("cc", FoundCommand.CommandLine[0]);
+  EXPECT_EQ("A\"", FoundCommand.CommandLine[1]);
+}
+
+static std::string writeTemporaryDatabase(StringRef Contents) {
+  SmallString<128> Path;
+  int FD;
+  llvm::error_code EC =
+    llvm::sys::fs::createTemporaryFile("compile_commands", "json", FD, Path);
+  EXPECT_FALSE(EC);
+  llvm::raw_fd_ostream OS(FD, true);
+  OS << Contents;
+  return Path.str();
+}
+
+TEST(JSONCompilationDatabase, LoadsFromSavedIndex) {
+  std::string Path = writeTemporaryDatabase(
+    "[{\"directory\":\"//net/dir\",\"command\":\"cc -c file1\","
+      "\"file\":\"file1\"},"
+    " {\"directory\":\"//net/dir\",\"command\":\"cc -c \\\"file 2\\\"\","
+      "\"file\":\"file 2\"}]");
+  std::string IndexPath = JSONCompilationDatabase::getIndexPath(Path);
+  std::string ErrorMessage;
+  OwningPtr<JSONCompilationDatabase> Database(
+    JSONCompilationDatabase::loadFromFile(Path, ErrorMessage));
+  ASSERT_TRUE(Database.get() != NULL) << ErrorMessage;
+  EXPECT_FALSE(Database->wasLoadedFromIndex());
+  ASSERT_TRUE(Database->writeIndex(IndexPath, ErrorMessage)) << ErrorMessage;
+
+  Database.reset(JSONCompilationDatabase::loadFromFile(Path, ErrorMessage));
+  ASSERT_TRUE(Database.get() != NULL) << ErrorMessage;
+  EXPECT_TRUE(Database->wasLoadedFromIndex());
+  EXPECT_EQ(2u, Database->getAllFiles().size());
+  SmallString<16> NativePath;
+  llvm::sys::path::native("//net/dir/file 2", NativePath);
+  std::vector<CompileCommand> Commands =
+    Database->getCompileCommands(NativePath);
+  ASSERT_EQ(1u, Commands.size());
+  EXPECT_EQ("//net/dir", Commands[0].Directory);
+  ASSERT_EQ(3u, Commands[0].CommandLine.size());
+  EXPECT_EQ("file 2", Commands[0].CommandLine[2]);
+
+  // An index written for another version of the database is ignored, even
+  // one of the same size written within the same second.
+  {
+    llvm::raw_fd_ostream OS(Path.c_str(), ErrorMessage);
+    OS << "[{\"directory\":\"//net/dir\",\"command\":\"cc -c file3\","
+            "\"file\":\"file3\"},"
+          " {\"directory\":\"//net/dir\",\"command\":\"cc -c \\\"file 4\\\"\","
+            "\"file\":\"file 4\"}]";
+  }
+  Database.reset(JSONCompilationDatabase::loadFromFile(Path, ErrorMessage));
+  ASSERT_TRUE(Database.get() != NULL) << ErrorMessage;
+  EXPECT_FALSE(Database->wasLoadedFromIndex());
+  ASSERT_EQ(2u, Database->getAllFiles().size());
+  EXPECT_TRUE(Database->getCompileCommands(NativePath).empty());
+
+  {
+    llvm::raw_fd_ostream OS(Path.c_str(), ErrorMessage);
+    OS << "[{\"directory\":\"//net/dir\",\"command\":\"cc\","
+            "\"file\":\"file3\"}]";
+  }
+  Database.reset(JSONCompilationDatabase::loadFromFile(Path, ErrorMessage));
+  ASSERT_TRUE(Database.get() != NULL) << ErrorMessage;
+  EXPECT_FALSE(Database->wasLoadedFromIndex());
+  EXPECT_EQ(1u, Database->getAllFiles().size());
+
+  llvm::sys::fs::remove(Path);
+  llvm::sys::fs::remove(IndexPath);
+}
+
 static std::vector<std::string> unescapeJsonCommandLine(StringRef Command) {
   std::string JsonDatabase =
     ("[{\"directory\":\"//net/root\", \"file\":\"test\", \"command\": \"" +
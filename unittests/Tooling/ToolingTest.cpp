@@ -14,7 +14,15 @@
 #include "clang/Frontend/FrontendAction.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/CompilationDatabase.h"
+#include "clang/Tooling/PreambleCache.h"
+#include "clang/Tooling/Refactoring.h"
 #include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 #include <string>
 
@@ -234,5 +242,176 @@ TEST(ClangToolTest, ArgumentAdjusters) {
   EXPECT_FALSE(Found);
 }
 
+#if !defined(_WIN32)
+struct RecordResults : public ToolResultCallback {
+  std::vector<std::string> Files;
+  std::vector<bool> Successes;
+  std::vector<std::string> Diagnostics;
+
+  virtual void handleResult(StringRef File, bool Success,
+                            StringRef Diags) LLVM_OVERRIDE {
+    Files.push_back(File);
+    Successes.push_back(Success);
+    Diagnostics.push_back(Diags);
+  }
+};
+
+TEST(ClangToolTest, RunsInParallelAndReportsInOrder) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources;
+  Sources.push_back("/a.cc");
+  Sources.push_back("/b.cc");
+  Sources.push_back("/c.cc");
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/a.cc", "void a() {}");
+  Tool.mapVirtualFile("/b.cc", "void b() { an_error_here }");
+  Tool.mapVirtualFile("/c.cc", "#include \"a.cc\"\nvoid c() { a(); }");
+
+  RecordResults Results;
+  EXPECT_EQ(1, Tool.runInParallel(newFrontendActionFactory<SyntaxOnlyAction>(),
+                                  3, &Results));
+  ASSERT_EQ(3u, Results.Files.size());
+  EXPECT_EQ("/a.cc", Results.Files[0]);
+  EXPECT_EQ("/b.cc", Results.Files[1]);
+  EXPECT_EQ("/c.cc", Results.Files[2]);
+  EXPECT_TRUE(Results.Successes[0]);
+  EXPECT_FALSE(Results.Successes[1]);
+  EXPECT_TRUE(Results.Successes[2]);
+  EXPECT_EQ("", Results.Diagnostics[0]);
+  EXPECT_NE(std::string::npos, Results.Diagnostics[1].find("an_error_here"));
+}
+
+TEST(ClangToolTest, SharesPreambles) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources;
+  Sources.push_back("/a.cc");
+  Sources.push_back("/b.cc");
+  Sources.push_back("/c.cc");
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/h.h", "int h();");
+  Tool.mapVirtualFile("/a.cc", "#include \"h.h\"\nint a() { return h(); }");
+  Tool.mapVirtualFile("/b.cc", "#include \"h.h\"\nint b() { return h(); }");
+  Tool.mapVirtualFile("/c.cc", "int c();");
+
+  PreambleCache Preambles;
+  Tool.setPreambleCache(&Preambles);
+  EXPECT_EQ(0, Tool.run(newFrontendActionFactory<SyntaxOnlyAction>()));
+  EXPECT_EQ(1u, Preambles.getNumHits());
+  EXPECT_EQ(1u, Preambles.getNumMisses());
+  EXPECT_EQ(0u, Preambles.getNumFailures());
+}
+
+TEST(ClangToolTest, ReportsPreambleDiagnosticsForEachTranslationUnit) {
+  FixedCompilationDatabase Compilations("/", std::vector<std::string>());
+  std::vector<std::string> Sources;
+  Sources.push_back("/a.cc");
+  Sources.push_back("/b.cc");
+  ClangTool Tool(Compilations, Sources);
+  Tool.mapVirtualFile("/h.h", "#warning in_the_header\nint h();");
+  Tool.mapVirtualFile("/a.cc", "#include \"h.h\"\nint a() { return h(); }");
+  Tool.mapVirtualFile("/b.cc", "#include \"h.h\"\nint b() { return h(); }");
+
+  PreambleCache Preambles;
+  Tool.setPreambleCache(&Preambles);
+  RecordResults Results;
+  EXPECT_EQ(0, Tool.runInParallel(newFrontendActionFactory<SyntaxOnlyAction>(),
+                                  1, &Results));
+  EXPECT_EQ(1u, Preambles.getNumHits());
+  ASSERT_EQ(2u, Results.Diagnostics.size());
+  EXPECT_NE(std::string::npos, Results.Diagnostics[0].find("in_the_header"));
+  EXPECT_NE(std::string::npos, Results.Diagnostics[1].find("in_the_header"));
+  EXPECT_NE(std::string::npos, Results.Diagnostics[1].find("h.h:1:2"));
+}
+
+/// Replaces the name of every top-level declaration called "h" by "g".
+class RenameHConsumer : public ASTConsumer {
+public:
+  RenameHConsumer(SourceManager &Sources, Replacements &Replace)
+      : Sources(Sources), Replace(Replace) {}
+
+  virtual bool HandleTopLevelDecl(DeclGroupRef DeclGroup) {
+    for (DeclGroupRef::iterator I = DeclGroup.begin(), E = DeclGroup.end();
+         I != E; ++I) {
+      NamedDecl *ND = dyn_cast<NamedDecl>(*I);
+      if (ND && ND->getIdentifier() && ND->getName() == "h")
+        Replace.insert(Replacement(Sources, ND->getLocation(), 1, "g"));
+    }
+    return true;
+  }
+
+private:
+  SourceManager &Sources;
+  Replacements &Replace;
+};
+
+class RenameHAction : public ASTFrontendAction {
+public:
+  explicit RenameHAction(Replacements &Replace) : Replace(Replace) {}
+
+protected:
+  virtual ASTConsumer *CreateASTConsumer(CompilerInstance &CI, StringRef) {
+    return new RenameHConsumer(CI.getSourceManager(), Replace);
+  }
+
+private:
+  Replacements &Replace;
+};
+
+class RenameHActionFactory : public FrontendActionFactory {
+public:
+  explicit RenameHActionFactory(Replacements &Replace) : Replace(Replace) {}
+
+  virtual FrontendAction *create() { return new RenameHAction(Replace); }
+
+private:
+  Replacements &Replace;
+};
+
+static void writeFile(StringRef Path, StringRef Content) {
+  std::string ErrorInfo;
+  llvm::raw_fd_ostream OS(Path.str().c_str(), ErrorInfo);
+  ASSERT_EQ("", ErrorInfo);
+  OS << Content;
+}
+
+TEST(RefactoringToolTest, AppliesReplacementsInCommandDirectory) {
+  // A directory other than the current one, with a header found through a
+  // relative include path.
+  SmallString<128> Dir;
+  int FD;
+  ASSERT_FALSE(llvm::sys::fs::createTemporaryFile("tooling-dir", "", FD, Dir));
+  { llvm::raw_fd_ostream Closer(FD, true); }
+  bool Existed;
+  ASSERT_FALSE(llvm::sys::fs::remove(Dir));
+  ASSERT_FALSE(llvm::sys::fs::create_directory(Dir.str(), Existed));
+  SmallString<128> IncDir(Dir);
+  llvm::sys::path::append(IncDir, "inc");
+  ASSERT_FALSE(llvm::sys::fs::create_directory(IncDir.str(), Existed));
+  SmallString<128> Header(IncDir);
+  llvm::sys::path::append(Header, "h.h");
+  writeFile(Header, "int h();\n");
+  SmallString<128> Source(Dir);
+  llvm::sys::path::append(Source, "a.cc");
+  writeFile(Source, "#include \"h.h\"\nint a() { return 0; }\n");
+
+  FixedCompilationDatabase Compilations(Dir.str(),
+                                        std::vector<std::string>(1, "-Iinc"));
+  RefactoringTool Tool(Compilations, std::vector<std::string>(1, Source.str()));
+  RenameHActionFactory Factory(Tool.getReplacements());
+  EXPECT_EQ(0, Tool.runAndSave(&Factory));
+
+  ASSERT_EQ(1u, Tool.getReplacements().size());
+  EXPECT_EQ(Header.str(), Tool.getReplacements().begin()->getFilePath());
+  OwningPtr<llvm::MemoryBuffer> Buffer;
+  ASSERT_FALSE(llvm::MemoryBuffer::getFile(Header.str(), Buffer));
+  EXPECT_EQ("int g();\n", Buffer->getBuffer());
+
+  llvm::sys::fs::remove(Header.str());
+  llvm::sys::fs::remove(IncDir.str());
+  llvm::sys::fs::remove(Source.str());
+  llvm::sys::fs::remove(Dir.str());
+}
+#endif
+
 } // end namespace tooling
 } // end namespace clang
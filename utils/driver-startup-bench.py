@@ -0,0 +1,80 @@
+#!/usr/bin/env python
+
+"""
+Measure the cost of compiling small translation units with the clang driver,
+running the compiler in a new process for each compile (-fno-integrated-cc1)
+and in the driver's own process (-fintegrated-cc1).
+
+The translation units are generated in a temporary directory and range from
+an empty file to one including a few standard headers, so that the process
+startup the integrated mode avoids is a visible part of the total.
+"""
+
+import optparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+SOURCES = [
+    ('empty.c', ''),
+    ('function.c', 'int f(int x) { return x * 2 + 1; }\n'),
+    ('stdio.c', '#include <stdio.h>\n'
+                'int main(void) { printf("hello\\n"); return 0; }\n'),
+    ('headers.c', '#include <stdio.h>\n#include <stdlib.h>\n'
+                  '#include <string.h>\n#include <math.h>\n'
+                  'double g(const char *s) { return sqrt(strlen(s)); }\n'),
+]
+
+MODES = [
+    ('process', '-fno-integrated-cc1'),
+    ('in-process', '-fintegrated-cc1'),
+]
+
+def time_compiles(command, count):
+    times = []
+    devnull = open(os.devnull, 'w')
+    for i in range(count):
+        start = time.time()
+        res = subprocess.call(command, stdout=devnull, stderr=devnull)
+        times.append(time.time() - start)
+        if res:
+            devnull.close()
+            sys.exit('error: compile failed: %s' % ' '.join(command))
+    devnull.close()
+    return sorted(times)
+
+def main():
+    parser = optparse.OptionParser(usage='%prog [options] <clang>')
+    parser.add_option('-n', dest='count', type='int', default=50,
+                      help='compiles per file and mode [%default]')
+    parser.add_option('-O', dest='opt', default='-O0',
+                      help='optimization level to compile at [%default]')
+    (opts, args) = parser.parse_args()
+    if len(args) != 1:
+        parser.error('expected the path of clang')
+    clang = args[0]
+
+    tmpdir = tempfile.mkdtemp(prefix='driver-startup-bench')
+    try:
+        print('%-12s %-12s %10s %10s %10s' % ('file', 'mode', 'min ms',
+                                              'median ms', 'mean ms'))
+        for name, text in SOURCES:
+            path = os.path.join(tmpdir, name)
+            f = open(path, 'w')
+            f.write(text)
+            f.close()
+            output = os.path.join(tmpdir, 'out.o')
+            for mode, flag in MODES:
+                times = time_compiles([clang, flag, opts.opt, '-c', path,
+                                       '-o', output], opts.count)
+                print('%-12s %-12s %10.2f %10.2f %10.2f' % (
+                    name, mode, times[0] * 1000, times[len(times) // 2] * 1000,
+                    sum(times) / len(times) * 1000))
+    finally:
+        shutil.rmtree(tmpdir)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+
+"""
+Compare running scripts through a resident clang-interpreter -interp-server
+against starting a new clang-interpreter for each one.
+
+Runs the same script a number of times in each mode, from several client
+threads at once, and reports requests per second along with the median and
+99th percentile latency.
+"""
+
+import optparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+def percentile(sorted_values, p):
+    index = int(round(p / 100.0 * (len(sorted_values) - 1)))
+    return sorted_values[index]
+
+def run_requests(command, count, jobs):
+    latencies = []
+    failures = [0]
+    lock = threading.Lock()
+    remaining = [count]
+    devnull = open(os.devnull, 'w')
+
+    def worker():
+        while True:
+            with lock:
+                if not remaining[0]:
+                    return
+                remaining[0] -= 1
+            start = time.time()
+            res = subprocess.call(command, stdout=devnull, stderr=devnull)
+            elapsed = time.time() - start
+            with lock:
+                latencies.append(elapsed)
+                if res:
+                    failures[0] += 1
+
+    threads = [threading.Thread(target=worker) for i in range(jobs)]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    total = time.time() - start
+    devnull.close()
+    return total, sorted(latencies), failures[0]
+
+def report(name, total, latencies, failures):
+    print('%-10s %8.1f req/s   p50 %8.2f ms   p99 %8.2f ms   %d failed' % (
+        name, len(latencies) / total, percentile(latencies, 50) * 1000,
+        percentile(latencies, 99) * 1000, failures))
+
+def main():
+    parser = optparse.OptionParser(
+        usage='%prog [options] <clang-interpreter> <script> [args...]')
+    parser.add_option('-n', dest='count', type='int', default=200,
+                      help='number of requests in each mode [%default]')
+    parser.add_option('-j', dest='jobs', type='int', default=4,
+                      help='number of concurrent clients [%default]')
+    parser.add_option('--warmup', dest='warmup', type='int', default=5,
+                      help='requests to run before measuring [%default]')
+    opts, args = parser.parse_args()
+    if len(args) < 2:
+        parser.error('expected an interpreter and a script')
+    interpreter, script = args[0], args[1:]
+
+    tmpdir = tempfile.mkdtemp(prefix='interp-bench-')
+    socket = os.path.join(tmpdir, 'server.sock')
+    pch_cache = os.path.join(tmpdir, 'pch-cache')
+
+    # Both modes get the preamble cache, so that the difference is the
+    # per-process startup the server saves, not header parsing.
+    direct = [interpreter, '-interp-pch-cache=' + pch_cache] + script
+    client = [interpreter, '-interp-connect=' + socket] + script
+
+    server = subprocess.Popen([interpreter, '-interp-server=' + socket,
+                               '-interp-pch-cache=' + pch_cache],
+                              stderr=open(os.devnull, 'w'))
+    try:
+        for i in range(50):
+            if os.path.exists(socket):
+                break
+            time.sleep(0.1)
+        else:
+            sys.exit('error: the server did not start')
+
+        for name, command in (('process', direct), ('server', client)):
+            run_requests(command, opts.warmup, 1)
+            total, latencies, failures = run_requests(command, opts.count,
+                                                      opts.jobs)
+            report(name, total, latencies, failures)
+    finally:
+        server.terminate()
+        server.wait()
+        shutil.rmtree(tmpdir)
+
+if __name__ == '__main__':
+    main()